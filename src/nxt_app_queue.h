@@ -15,6 +15,21 @@
 #define NXT_APP_QUEUE_SIZE      NXT_APP_NNCQ_SIZE
 #define NXT_APP_QUEUE_MSG_SIZE  31
 
+/*
+ * Requests are placed into one of the priority lanes.  Receivers drain
+ * the lanes following a smooth weighted round-robin schedule, so the high
+ * lane gets 4 turns, the normal lane 2 and the low lane 1 out of every 7;
+ * a turn of an empty lane is passed to the others, and no lane that has
+ * requests waiting is ever skipped for a whole round.
+ */
+
+#define NXT_APP_QUEUE_NORMAL    0
+#define NXT_APP_QUEUE_HIGH      1
+#define NXT_APP_QUEUE_LOW       2
+#define NXT_APP_QUEUE_LANES     3
+
+#define NXT_APP_QUEUE_TURNS     7
+
 typedef struct {
     uint8_t   size;
     uint8_t   data[NXT_APP_QUEUE_MSG_SIZE];
@@ -25,7 +40,8 @@ typedef struct {
 typedef struct {
     nxt_app_nncq_atomic_t  notified;
     nxt_app_nncq_t         free_items;
-    nxt_app_nncq_t         queue;
+    nxt_app_nncq_atomic_t  turn;
+    nxt_app_nncq_t         lanes[NXT_APP_QUEUE_LANES];
     nxt_app_queue_item_t   items[NXT_APP_QUEUE_SIZE];
 } nxt_app_queue_t;
 
@@ -36,19 +52,24 @@ nxt_app_queue_init(nxt_app_queue_t volatile *q)
     nxt_app_nncq_atomic_t  i;
 
     nxt_app_nncq_init(&q->free_items);
-    nxt_app_nncq_init(&q->queue);
+
+    for (i = 0; i < NXT_APP_QUEUE_LANES; i++) {
+        nxt_app_nncq_init(&q->lanes[i]);
+    }
 
     for (i = 0; i < NXT_APP_QUEUE_SIZE; i++) {
         nxt_app_nncq_enqueue(&q->free_items, i);
     }
 
+    q->turn = 0;
     q->notified = 0;
 }
 
 
 nxt_inline nxt_int_t
-nxt_app_queue_send(nxt_app_queue_t volatile *q, const void *p,
-    uint8_t size, uint32_t tracking, int *notify, uint32_t *cookie)
+nxt_app_queue_send(nxt_app_queue_t volatile *q, nxt_uint_t lane,
+    const void *p, uint8_t size, uint32_t tracking, int *notify,
+    uint32_t *cookie)
 {
     int                    n;
     nxt_app_queue_item_t   *qi;
@@ -66,7 +87,7 @@ nxt_app_queue_send(nxt_app_queue_t volatile *q, const void *p,
     qi->tracking = tracking;
     *cookie = i;
 
-    nxt_app_nncq_enqueue(&q->queue, i);
+    nxt_app_nncq_enqueue(&q->lanes[lane], i);
 
     n = nxt_atomic_cmp_set(&q->notified, 0, 1);
 
@@ -97,19 +118,66 @@ nxt_app_queue_cancel(nxt_app_queue_t volatile *q, uint32_t cookie,
 }
 
 
+nxt_inline uint32_t
+nxt_app_queue_depth(nxt_app_queue_t volatile *q, nxt_uint_t lane)
+{
+    int32_t                  n;
+    nxt_app_nncq_t volatile  *l;
+
+    l = &q->lanes[lane];
+
+    n = (int32_t) (nxt_app_nncq_tail(l) - nxt_app_nncq_head(l));
+
+    return nxt_max(n, 0);
+}
+
+
 nxt_inline ssize_t
 nxt_app_queue_recv(nxt_app_queue_t volatile *q, void *p, uint32_t *cookie)
 {
-    ssize_t                res;
-    nxt_app_queue_item_t   *qi;
-    nxt_app_nncq_atomic_t  i;
-
-    i = nxt_app_nncq_dequeue(&q->queue);
-    if (i == nxt_app_nncq_empty(&q->queue)) {
-        *cookie = 0;
-        return -1;
+    ssize_t                  res;
+    nxt_uint_t               k, lane, first;
+    nxt_app_queue_item_t     *qi;
+    nxt_app_nncq_atomic_t    i, turn;
+    nxt_app_nncq_t volatile  *l;
+
+    static const uint8_t  schedule[NXT_APP_QUEUE_TURNS] = {
+        NXT_APP_QUEUE_HIGH, NXT_APP_QUEUE_NORMAL, NXT_APP_QUEUE_HIGH,
+        NXT_APP_QUEUE_LOW, NXT_APP_QUEUE_HIGH, NXT_APP_QUEUE_NORMAL,
+        NXT_APP_QUEUE_HIGH,
+    };
+
+    static const uint8_t  fallback[NXT_APP_QUEUE_LANES] = {
+        NXT_APP_QUEUE_HIGH, NXT_APP_QUEUE_NORMAL, NXT_APP_QUEUE_LOW,
+    };
+
+    turn = q->turn;
+    first = schedule[turn % NXT_APP_QUEUE_TURNS];
+    lane = first;
+    k = 0;
+
+    for ( ;; ) {
+        l = &q->lanes[lane];
+
+        i = nxt_app_nncq_dequeue(l);
+        if (i != nxt_app_nncq_empty(l)) {
+            break;
+        }
+
+        do {
+            if (k == NXT_APP_QUEUE_LANES) {
+                *cookie = 0;
+                return -1;
+            }
+
+            lane = fallback[k++];
+
+        } while (lane == first);
     }
 
+    /* A concurrent receiver may have taken the turn already. */
+    (void) nxt_atomic_cmp_set(&q->turn, turn, turn + 1);
+
     qi = (nxt_app_queue_item_t *) &q->items[i];
 
     res = qi->size;
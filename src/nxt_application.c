@@ -576,6 +576,13 @@ nxt_proto_setup(nxt_task_t *task, nxt_process_t *process)
         }
     }
 
+    if (nxt_app->preload != NULL) {
+        ret = nxt_app->preload(task, process, app_conf);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return ret;
+        }
+    }
+
     process->state = NXT_PROCESS_STATE_CREATED;
 
     return NXT_OK;
@@ -645,7 +652,16 @@ nxt_proto_start_process_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
 
     init->siblings = &nxt_proto_children;
 
+    if (nxt_app->before_fork != NULL) {
+        nxt_app->before_fork(task);
+    }
+
     ret = nxt_process_start(task, process);
+
+    if (ret != NXT_AGAIN && nxt_app->after_fork != NULL) {
+        nxt_app->after_fork(task);
+    }
+
     if (nxt_slow_path(ret == NXT_ERROR)) {
         nxt_process_use(task, process, -1);
 
@@ -30,6 +30,7 @@ typedef enum {
 typedef struct nxt_app_module_s  nxt_app_module_t;
 typedef nxt_int_t (*nxt_application_setup_t)(nxt_task_t *task,
     nxt_process_t *process, nxt_common_app_conf_t *conf);
+typedef void (*nxt_application_fork_t)(nxt_task_t *task);
 
 
 typedef struct {
@@ -54,6 +55,7 @@ typedef struct {
     uint32_t                   threads;
     uint32_t                   thread_stack_size;
     nxt_conf_value_t           *targets;
+    uint8_t                    preload;  /* 1 bit */
 } nxt_python_app_conf_t;
 
 
@@ -151,6 +153,20 @@ struct nxt_app_module_s {
 
     nxt_application_setup_t    setup;
     nxt_process_start_t        start;
+
+    /*
+     * Called in the prototype process after isolation and chdir, so the
+     * module can initialize the application once and let the workers
+     * share it with the prototype through copy-on-write.
+     */
+    nxt_application_setup_t    preload;
+
+    /*
+     * Called in the prototype process around forking of each
+     * application process; after_fork is called in the prototype only.
+     */
+    nxt_application_fork_t     before_fork;
+    nxt_application_fork_t     after_fork;
 };
 
 
@@ -7,6 +7,7 @@
 
 #include <nxt_main.h>
 #include <nxt_conf.h>
+#include <nxt_sha1.h>
 
 #include <float.h>
 #include <math.h>
@@ -18,6 +19,15 @@
 
 #define NXT_CONF_MAX_TOKEN_LEN     256
 
+/*
+ * Duplicate names of object members are looked up linearly in small
+ * objects and using a hash in larger ones.
+ */
+#define NXT_CONF_JSON_LINEAR_MEMBERS  16
+
+#define nxt_conf_json_unescaped(ch)                                           \
+    ((ch) > 0x1F && (ch) != '\\' && (ch) != '"')
+
 
 typedef enum {
     NXT_CONF_VALUE_NULL = 0,
@@ -99,22 +109,43 @@ typedef struct {
 } nxt_conf_path_parse_t;
 
 
+/*
+ * Elements of arrays and members of objects are collected in a stack
+ * shared by all nesting levels while a value is parsed, and are copied
+ * to the final array or object once its end is reached.
+ */
+
+typedef struct {
+    u_char                    *stack;
+    size_t                    size;
+    size_t                    top;
+
+    /* The pool for hashes of large objects. */
+    nxt_mp_t                  *mem_pool;
+
+    nxt_conf_json_error_t     *error;
+} nxt_conf_json_parse_t;
+
+
 static nxt_int_t nxt_conf_path_next_token(nxt_conf_path_parse_t *parse,
     nxt_str_t *token);
 
 static u_char *nxt_conf_json_skip_space(u_char *start, const u_char *end);
 static u_char *nxt_conf_json_parse_value(nxt_mp_t *mp, nxt_conf_value_t *value,
-    u_char *start, u_char *end, nxt_conf_json_error_t *error);
+    u_char *start, u_char *end, nxt_conf_json_parse_t *parse);
 static u_char *nxt_conf_json_parse_object(nxt_mp_t *mp, nxt_conf_value_t *value,
-    u_char *start, u_char *end, nxt_conf_json_error_t *error);
-static nxt_int_t nxt_conf_object_hash_add(nxt_mp_t *mp,
-    nxt_lvlhsh_t *lvlhsh, nxt_conf_object_member_t *member);
+    u_char *start, u_char *end, nxt_conf_json_parse_t *parse);
+static nxt_int_t nxt_conf_object_member_unique(nxt_conf_json_parse_t *parse,
+    nxt_lvlhsh_t *lvlhsh, size_t base, nxt_uint_t count);
+static nxt_int_t nxt_conf_object_hash_add(nxt_conf_json_parse_t *parse,
+    nxt_lvlhsh_t *lvlhsh, nxt_conf_value_t *name);
 static nxt_int_t nxt_conf_object_hash_test(nxt_lvlhsh_query_t *lhq,
     void *data);
 static void *nxt_conf_object_hash_alloc(void *data, size_t size);
 static void nxt_conf_object_hash_free(void *data, void *p);
 static u_char *nxt_conf_json_parse_array(nxt_mp_t *mp, nxt_conf_value_t *value,
-    u_char *start, u_char *end, nxt_conf_json_error_t *error);
+    u_char *start, u_char *end, nxt_conf_json_parse_t *parse);
+static void *nxt_conf_json_push(nxt_conf_json_parse_t *parse, size_t size);
 static u_char *nxt_conf_json_parse_string(nxt_mp_t *mp, nxt_conf_value_t *value,
     u_char *start, u_char *end, nxt_conf_json_error_t *error);
 static u_char *nxt_conf_json_parse_number(nxt_mp_t *mp, nxt_conf_value_t *value,
@@ -1242,8 +1273,9 @@ nxt_conf_value_t *
 nxt_conf_json_parse(nxt_mp_t *mp, u_char *start, u_char *end,
     nxt_conf_json_error_t *error)
 {
-    u_char            *p;
-    nxt_conf_value_t  *value;
+    u_char                 *p;
+    nxt_conf_value_t       *value;
+    nxt_conf_json_parse_t  parse;
 
     value = nxt_mp_get(mp, sizeof(nxt_conf_value_t));
     if (nxt_slow_path(value == NULL)) {
@@ -1263,7 +1295,18 @@ nxt_conf_json_parse(nxt_mp_t *mp, u_char *start, u_char *end,
         return NULL;
     }
 
-    p = nxt_conf_json_parse_value(mp, value, p, end, error);
+    nxt_memzero(&parse, sizeof(nxt_conf_json_parse_t));
+    parse.error = error;
+
+    p = nxt_conf_json_parse_value(mp, value, p, end, &parse);
+
+    if (parse.stack != NULL) {
+        nxt_free(parse.stack);
+    }
+
+    if (parse.mem_pool != NULL) {
+        nxt_mp_destroy(parse.mem_pool);
+    }
 
     if (nxt_slow_path(p == NULL)) {
         return NULL;
@@ -1297,6 +1340,10 @@ nxt_conf_json_skip_space(u_char *start, const u_char *end)
         sw_after_asterisk,
     } state;
 
+    if (nxt_fast_path(start != end && *start > ' ' && *start != '/')) {
+        return start;
+    }
+
     state = sw_normal;
 
     for (p = start; nxt_fast_path(p != end); p++) {
@@ -1371,7 +1418,7 @@ nxt_conf_json_skip_space(u_char *start, const u_char *end)
 
 static u_char *
 nxt_conf_json_parse_value(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
-    u_char *end, nxt_conf_json_error_t *error)
+    u_char *end, nxt_conf_json_parse_t *parse)
 {
     u_char  ch, *p;
 
@@ -1379,13 +1426,13 @@ nxt_conf_json_parse_value(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
 
     switch (ch) {
     case '{':
-        return nxt_conf_json_parse_object(mp, value, start, end, error);
+        return nxt_conf_json_parse_object(mp, value, start, end, parse);
 
     case '[':
-        return nxt_conf_json_parse_array(mp, value, start, end, error);
+        return nxt_conf_json_parse_array(mp, value, start, end, parse);
 
     case '"':
-        return nxt_conf_json_parse_string(mp, value, start, end, error);
+        return nxt_conf_json_parse_string(mp, value, start, end, parse->error);
 
     case 't':
         if (nxt_fast_path(end - start >= 4
@@ -1431,7 +1478,7 @@ nxt_conf_json_parse_value(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
     }
 
     if (nxt_fast_path((ch - '0') <= 9)) {
-        p = nxt_conf_json_parse_number(mp, value, start, end, error);
+        p = nxt_conf_json_parse_number(mp, value, start, end, parse->error);
 
         if (nxt_slow_path(p == NULL)) {
             return NULL;
@@ -1459,7 +1506,7 @@ nxt_conf_json_parse_value(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
 
 error:
 
-    nxt_conf_json_parse_error(error, start,
+    nxt_conf_json_parse_error(parse->error, start,
         "A valid JSON value is expected here.  It must be either a literal "
         "(null, true, or false), a number, a string (in double quotes \"\"), "
         "an array (with brackets []), or an object (with braces {})."
@@ -1481,24 +1528,20 @@ static const nxt_lvlhsh_proto_t  nxt_conf_object_hash_proto
 
 static u_char *
 nxt_conf_json_parse_object(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
-    u_char *end, nxt_conf_json_error_t *error)
+    u_char *end, nxt_conf_json_parse_t *parse)
 {
     u_char                    *p, *name;
-    nxt_mp_t                  *mp_temp;
+    size_t                    base, offset;
     nxt_int_t                 rc;
     nxt_uint_t                count;
     nxt_lvlhsh_t              hash;
-    nxt_lvlhsh_each_t         lhe;
+    nxt_conf_value_t          member_value;
     nxt_conf_object_t         *object;
-    nxt_conf_object_member_t  *member, *element;
-
-    mp_temp = nxt_mp_create(1024, 128, 256, 32);
-    if (nxt_slow_path(mp_temp == NULL)) {
-        return NULL;
-    }
+    nxt_conf_object_member_t  *member;
 
     nxt_lvlhsh_init(&hash);
 
+    base = parse->top;
     count = 0;
     p = start;
 
@@ -1507,12 +1550,12 @@ nxt_conf_json_parse_object(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
 
         if (nxt_slow_path(p == end)) {
 
-            nxt_conf_json_parse_error(error, p,
+            nxt_conf_json_parse_error(parse->error, p,
                 "Unexpected end of JSON payload.  There's an object without "
                 "a closing brace (})."
             );
 
-            goto error;
+            return NULL;
         }
 
         if (*p != '"') {
@@ -1520,94 +1563,102 @@ nxt_conf_json_parse_object(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
                 break;
             }
 
-            nxt_conf_json_parse_error(error, p,
+            nxt_conf_json_parse_error(parse->error, p,
                 "A double quote (\") is expected here.  There must be a valid "
                 "JSON object member starts with a name, which is a string "
                 "enclosed in double quotes."
             );
 
-            goto error;
+            return NULL;
         }
 
         name = p;
 
-        count++;
+        offset = parse->top;
 
-        member = nxt_mp_get(mp_temp, sizeof(nxt_conf_object_member_t));
+        member = nxt_conf_json_push(parse, sizeof(nxt_conf_object_member_t));
         if (nxt_slow_path(member == NULL)) {
-            goto error;
+            return NULL;
         }
 
-        p = nxt_conf_json_parse_string(mp, &member->name, p, end, error);
+        p = nxt_conf_json_parse_string(mp, &member->name, p, end,
+                                       parse->error);
 
         if (nxt_slow_path(p == NULL)) {
-            goto error;
+            return NULL;
         }
 
-        rc = nxt_conf_object_hash_add(mp_temp, &hash, member);
+        rc = nxt_conf_object_member_unique(parse, &hash, base, count);
 
         if (nxt_slow_path(rc != NXT_OK)) {
 
             if (rc == NXT_DECLINED) {
-                nxt_conf_json_parse_error(error, name,
+                nxt_conf_json_parse_error(parse->error, name,
                     "Duplicate object member.  All JSON object members must "
                     "have unique names."
                 );
             }
 
-            goto error;
+            return NULL;
         }
 
+        count++;
+
         p = nxt_conf_json_skip_space(p, end);
 
         if (nxt_slow_path(p == end)) {
 
-            nxt_conf_json_parse_error(error, p,
+            nxt_conf_json_parse_error(parse->error, p,
                 "Unexpected end of JSON payload.  There's an object member "
                 "without a value."
             );
 
-            goto error;
+            return NULL;
         }
 
         if (nxt_slow_path(*p != ':')) {
 
-            nxt_conf_json_parse_error(error, p,
+            nxt_conf_json_parse_error(parse->error, p,
                 "A colon (:) is expected here.  There must be a colon after "
                 "a JSON member name."
             );
 
-            goto error;
+            return NULL;
         }
 
         p = nxt_conf_json_skip_space(p + 1, end);
 
         if (nxt_slow_path(p == end)) {
 
-            nxt_conf_json_parse_error(error, p,
+            nxt_conf_json_parse_error(parse->error, p,
                 "Unexpected end of JSON payload.  There's an object member "
                 "without a value."
             );
 
-            goto error;
+            return NULL;
         }
 
-        p = nxt_conf_json_parse_value(mp, &member->value, p, end, error);
+        /* The stack may be reallocated while the value is parsed. */
+
+        p = nxt_conf_json_parse_value(mp, &member_value, p, end, parse);
 
         if (nxt_slow_path(p == NULL)) {
-            goto error;
+            return NULL;
         }
 
+        member = (nxt_conf_object_member_t *) (parse->stack + offset);
+        member->value = member_value;
+
         p = nxt_conf_json_skip_space(p, end);
 
         if (nxt_slow_path(p == end)) {
 
-            nxt_conf_json_parse_error(error, p,
+            nxt_conf_json_parse_error(parse->error, p,
                 "Unexpected end of JSON payload.  There's an object without "
                 "a closing brace (})."
             );
 
-            goto error;
+            return NULL;
         }
 
         if (*p != ',') {
@@ -1615,64 +1666,105 @@ nxt_conf_json_parse_object(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
                 break;
             }
 
-            nxt_conf_json_parse_error(error, p,
+            nxt_conf_json_parse_error(parse->error, p,
                 "Either a closing brace (}) or a comma (,) is expected here.  "
                 "Each JSON object must be enclosed in braces and its members "
                 "must be separated by commas."
             );
 
-            goto error;
+            return NULL;
         }
     }
 
     object = nxt_mp_get(mp, sizeof(nxt_conf_object_t)
                             + count * sizeof(nxt_conf_object_member_t));
     if (nxt_slow_path(object == NULL)) {
-        goto error;
+        return NULL;
     }
 
     value->u.object = object;
     value->type = NXT_CONF_VALUE_OBJECT;
 
     object->count = count;
-    member = object->members;
 
-    nxt_lvlhsh_each_init(&lhe, &nxt_conf_object_hash_proto);
+    nxt_memcpy(object->members, parse->stack + base,
+               count * sizeof(nxt_conf_object_member_t));
 
-    for ( ;; ) {
-        element = nxt_lvlhsh_each(&hash, &lhe);
+    parse->top = base;
 
-        if (element == NULL) {
-            break;
+    return p + 1;
+}
+
+
+static nxt_int_t
+nxt_conf_object_member_unique(nxt_conf_json_parse_t *parse,
+    nxt_lvlhsh_t *lvlhsh, size_t base, nxt_uint_t count)
+{
+    nxt_str_t                 name, str;
+    nxt_int_t                 ret;
+    nxt_uint_t                i;
+    nxt_conf_object_member_t  *members;
+
+    members = (nxt_conf_object_member_t *) (parse->stack + base);
+
+    if (count < NXT_CONF_JSON_LINEAR_MEMBERS) {
+        nxt_conf_get_string(&members[count].name, &name);
+
+        for (i = 0; i < count; i++) {
+            nxt_conf_get_string(&members[i].name, &str);
+
+            if (nxt_strstr_eq(&name, &str)) {
+                return NXT_DECLINED;
+            }
         }
 
-        *member++ = *element;
+        return NXT_OK;
     }
 
-    nxt_mp_destroy(mp_temp);
-
-    return p + 1;
+    if (count == NXT_CONF_JSON_LINEAR_MEMBERS) {
 
-error:
+        for (i = 0; i < count; i++) {
+            ret = nxt_conf_object_hash_add(parse, lvlhsh, &members[i].name);
+            if (nxt_slow_path(ret != NXT_OK)) {
+                return ret;
+            }
+        }
+    }
 
-    nxt_mp_destroy(mp_temp);
-    return NULL;
+    return nxt_conf_object_hash_add(parse, lvlhsh, &members[count].name);
 }
 
 
 static nxt_int_t
-nxt_conf_object_hash_add(nxt_mp_t *mp, nxt_lvlhsh_t *lvlhsh,
-    nxt_conf_object_member_t *member)
+nxt_conf_object_hash_add(nxt_conf_json_parse_t *parse, nxt_lvlhsh_t *lvlhsh,
+    nxt_conf_value_t *name)
 {
+    nxt_conf_value_t    *value;
     nxt_lvlhsh_query_t  lhq;
 
-    nxt_conf_get_string(&member->name, &lhq.key);
+    if (parse->mem_pool == NULL) {
+        parse->mem_pool = nxt_mp_create(1024, 128, 256, 32);
+        if (nxt_slow_path(parse->mem_pool == NULL)) {
+            return NXT_ERROR;
+        }
+    }
+
+    /* A short name is stored in the stack which may be reallocated. */
+
+    value = nxt_mp_get(parse->mem_pool, sizeof(nxt_conf_value_t));
+    if (nxt_slow_path(value == NULL)) {
+        return NXT_ERROR;
+    }
+
+    *value = *name;
+
+    nxt_conf_get_string(value, &lhq.key);
 
     lhq.key_hash = nxt_djb_hash(lhq.key.start, lhq.key.length);
     lhq.replace = 0;
-    lhq.value = member;
+    lhq.value = value;
     lhq.proto = &nxt_conf_object_hash_proto;
-    lhq.pool = mp;
+    lhq.pool = parse->mem_pool;
 
     return nxt_lvlhsh_insert(lvlhsh, &lhq);
 }
@@ -1681,12 +1773,9 @@ nxt_conf_object_hash_add(nxt_mp_t *mp, nxt_lvlhsh_t *lvlhsh,
 static nxt_int_t
 nxt_conf_object_hash_test(nxt_lvlhsh_query_t *lhq, void *data)
 {
-    nxt_str_t                 str;
-    nxt_conf_object_member_t  *member;
-
-    member = data;
+    nxt_str_t  str;
 
-    nxt_conf_get_string(&member->name, &str);
+    nxt_conf_get_string(data, &str);
 
     return nxt_strstr_eq(&lhq->key, &str) ? NXT_OK : NXT_DECLINED;
 }
@@ -1708,25 +1797,15 @@ nxt_conf_object_hash_free(void *data, void *p)
 
 static u_char *
 nxt_conf_json_parse_array(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
-    u_char *end, nxt_conf_json_error_t *error)
+    u_char *end, nxt_conf_json_parse_t *parse)
 {
     u_char            *p;
-    nxt_mp_t          *mp_temp;
+    size_t            base;
     nxt_uint_t        count;
-    nxt_list_t        *list;
     nxt_conf_array_t  *array;
-    nxt_conf_value_t  *element;
-
-    mp_temp = nxt_mp_create(1024, 128, 256, 32);
-    if (nxt_slow_path(mp_temp == NULL)) {
-        return NULL;
-    }
-
-    list = nxt_list_create(mp_temp, 8, sizeof(nxt_conf_value_t));
-    if (nxt_slow_path(list == NULL)) {
-        goto error;
-    }
+    nxt_conf_value_t  element, *elt;
 
+    base = parse->top;
     count = 0;
     p = start;
 
@@ -1735,12 +1814,12 @@ nxt_conf_json_parse_array(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
 
         if (nxt_slow_path(p == end)) {
 
-            nxt_conf_json_parse_error(error, p,
+            nxt_conf_json_parse_error(parse->error, p,
                 "Unexpected end of JSON payload.  There's an array without "
                 "a closing bracket (])."
             );
 
-            goto error;
+            return NULL;
         }
 
         if (*p == ']') {
@@ -1749,27 +1828,29 @@ nxt_conf_json_parse_array(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
 
         count++;
 
-        element = nxt_list_add(list);
-        if (nxt_slow_path(element == NULL)) {
-            goto error;
-        }
-
-        p = nxt_conf_json_parse_value(mp, element, p, end, error);
+        p = nxt_conf_json_parse_value(mp, &element, p, end, parse);
 
         if (nxt_slow_path(p == NULL)) {
-            goto error;
+            return NULL;
+        }
+
+        elt = nxt_conf_json_push(parse, sizeof(nxt_conf_value_t));
+        if (nxt_slow_path(elt == NULL)) {
+            return NULL;
         }
 
+        *elt = element;
+
         p = nxt_conf_json_skip_space(p, end);
 
         if (nxt_slow_path(p == end)) {
 
-            nxt_conf_json_parse_error(error, p,
+            nxt_conf_json_parse_error(parse->error, p,
                 "Unexpected end of JSON payload.  There's an array without "
                 "a closing bracket (])."
             );
 
-            goto error;
+            return NULL;
         }
 
         if (*p != ',') {
@@ -1777,40 +1858,58 @@ nxt_conf_json_parse_array(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
                 break;
             }
 
-            nxt_conf_json_parse_error(error, p,
+            nxt_conf_json_parse_error(parse->error, p,
                 "Either a closing bracket (]) or a comma (,) is expected "
                 "here.  Each array must be enclosed in brackets and its "
                 "members must be separated by commas."
             );
 
-            goto error;
+            return NULL;
         }
     }
 
     array = nxt_mp_get(mp, sizeof(nxt_conf_array_t)
                            + count * sizeof(nxt_conf_value_t));
     if (nxt_slow_path(array == NULL)) {
-        goto error;
+        return NULL;
     }
 
     value->u.array = array;
     value->type = NXT_CONF_VALUE_ARRAY;
 
     array->count = count;
-    element = array->elements;
 
-    nxt_list_each(value, list) {
-        *element++ = *value;
-    } nxt_list_loop;
+    nxt_memcpy(array->elements, parse->stack + base,
+               count * sizeof(nxt_conf_value_t));
 
-    nxt_mp_destroy(mp_temp);
+    parse->top = base;
 
     return p + 1;
+}
 
-error:
 
-    nxt_mp_destroy(mp_temp);
-    return NULL;
+static void *
+nxt_conf_json_push(nxt_conf_json_parse_t *parse, size_t size)
+{
+    void    *p;
+    size_t  new_size;
+
+    if (nxt_slow_path(parse->top + size > parse->size)) {
+        new_size = (parse->size != 0) ? parse->size * 2 : 4096;
+
+        p = nxt_realloc(parse->stack, new_size);
+        if (nxt_slow_path(p == NULL)) {
+            return NULL;
+        }
+
+        parse->stack = p;
+        parse->size = new_size;
+    }
+
+    p = parse->stack + parse->top;
+    parse->top += size;
+
+    return p;
 }
 
 
@@ -1836,9 +1935,19 @@ nxt_conf_json_parse_string(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
     state = 0;
     surplus = 0;
 
+    /* The leading run of characters without escape sequences. */
+
     for (p = start; nxt_fast_path(p != end); p++) {
         ch = *p;
 
+        if (ch == '"' || ch == '\\' || ch < ' ') {
+            break;
+        }
+    }
+
+    for ( /* void */ ; nxt_fast_path(p != end); p++) {
+        ch = *p;
+
         switch (state) {
 
         case sw_usual:
@@ -2178,6 +2287,15 @@ nxt_conf_json_parse_number(nxt_mp_t *mp, nxt_conf_value_t *value, u_char *start,
     nxt_memcpy(value->u.number, start, size);
     value->u.number[size] = '\0';
 
+    if (dot_pos == p && p != s) {
+        /*
+         * Neither a fraction nor an exponent part, the number
+         * is short enough to be in the range of integers.
+         */
+        value->type = NXT_CONF_VALUE_INTEGER;
+        return p;
+    }
+
     nxt_errno = 0;
     end = NULL;
 
@@ -2535,7 +2653,10 @@ nxt_conf_json_escape_length(u_char *p, size_t size)
     while (size) {
         ch = *p++;
 
-        if (ch == '\\' || ch == '"') {
+        if (nxt_conf_json_unescaped(ch)) {
+            /* void */
+
+        } else if (ch == '\\' || ch == '"') {
             len++;
 
         } else if (ch <= 0x1F) {
@@ -2564,22 +2685,30 @@ nxt_conf_json_escape_length(u_char *p, size_t size)
 static u_char *
 nxt_conf_json_escape(u_char *dst, u_char *src, size_t size)
 {
-    u_char  ch;
+    u_char  ch, *s;
 
     while (size) {
-        ch = *src++;
+        s = src;
 
-        if (ch > 0x1F) {
+        while (size != 0 && nxt_conf_json_unescaped(*src)) {
+            src++;
+            size--;
+        }
 
-            if (ch == '\\' || ch == '"') {
-                *dst++ = '\\';
-            }
+        dst = nxt_cpymem(dst, s, src - s);
 
+        if (size == 0) {
+            break;
+        }
+
+        ch = *src++;
+
+        *dst++ = '\\';
+
+        if (ch > 0x1F) {
             *dst++ = ch;
 
         } else {
-            *dst++ = '\\';
-
             switch (ch) {
             case '\n':
                 *dst++ = 'n';
@@ -2645,3 +2774,29 @@ nxt_conf_json_position(u_char *start, const u_char *pos, nxt_uint_t *line,
         *column = 1 + symbols;
     }
 }
+
+
+u_char *
+nxt_conf_digest(u_char *p, const u_char *start, size_t length)
+{
+    size_t      n;
+    u_char      digest[20], ver[NXT_INT_T_LEN];
+    nxt_uint_t  i;
+    nxt_sha1_t  ctx;
+
+    static const u_char  hex[16] = "0123456789abcdef";
+
+    n = nxt_sprintf(ver, ver + NXT_INT_T_LEN, "%d:", NXT_VERNUM) - ver;
+
+    nxt_sha1_init(&ctx);
+    nxt_sha1_update(&ctx, ver, n);
+    nxt_sha1_update(&ctx, start, length);
+    nxt_sha1_final(digest, &ctx);
+
+    for (i = 0; i < sizeof(digest); i++) {
+        *p++ = hex[digest[i] >> 4];
+        *p++ = hex[digest[i] & 0x0F];
+    }
+
+    return p;
+}
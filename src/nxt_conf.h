@@ -114,6 +114,17 @@ void nxt_conf_json_position(u_char *start, const u_char *pos, nxt_uint_t *line,
     nxt_uint_t *column);
 
 nxt_int_t nxt_conf_validate(nxt_conf_validation_t *vldt);
+nxt_int_t nxt_conf_validate_refs(nxt_conf_validation_t *vldt);
+
+/*
+ * The stored configuration is accompanied by its digest, so an unchanged
+ * configuration is not validated again on startup.  The digest includes
+ * the version, so the configuration is validated after an upgrade.
+ */
+
+#define NXT_CONF_DIGEST_LEN  40
+
+u_char *nxt_conf_digest(u_char *p, const u_char *start, size_t length);
 
 NXT_EXPORT void nxt_conf_get_string(nxt_conf_value_t *value, nxt_str_t *str);
 NXT_EXPORT void nxt_conf_set_string(nxt_conf_value_t *value, nxt_str_t *str);
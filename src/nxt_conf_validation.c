@@ -102,6 +102,20 @@ static nxt_int_t nxt_conf_vldt_tls_cache_size(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_tls_timeout(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_tls_handshake_threads(
+    nxt_conf_validation_t *vldt, nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_tls_record_size(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_tls_records_number(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+#if (NXT_HAVE_OPENSSL_EARLY_DATA)
+static nxt_int_t nxt_conf_vldt_tls_early_data_size(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+#endif
+#if (NXT_HAVE_OPENSSL_OCSP)
+static nxt_int_t nxt_conf_vldt_tls_ocsp_refresh(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+#endif
 #if (NXT_HAVE_OPENSSL_TLSEXT)
 static nxt_int_t nxt_conf_vldt_ticket_key(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
@@ -113,6 +127,8 @@ static nxt_int_t nxt_conf_vldt_action(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_pass(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_priority(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_return(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_share(nxt_conf_validation_t *vldt,
@@ -179,6 +195,10 @@ static nxt_int_t nxt_conf_vldt_object(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_processes(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_app_queue_size(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
+static nxt_int_t nxt_conf_vldt_app_queue_wait(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_object_iterator(nxt_conf_validation_t *vldt,
     nxt_conf_value_t *value, void *data);
 static nxt_int_t nxt_conf_vldt_array_iterator(nxt_conf_validation_t *vldt,
@@ -244,8 +264,16 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_static_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_forwarded_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_client_ip_members[];
 #if (NXT_TLS)
+static nxt_conf_vldt_object_t  nxt_conf_vldt_setting_tls_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_tls_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_session_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_tls_records_members[];
+#if (NXT_HAVE_OPENSSL_EARLY_DATA)
+static nxt_conf_vldt_object_t  nxt_conf_vldt_tls_early_data_members[];
+#endif
+#if (NXT_HAVE_OPENSSL_OCSP)
+static nxt_conf_vldt_object_t  nxt_conf_vldt_tls_ocsp_members[];
+#endif
 #endif
 static nxt_conf_vldt_object_t  nxt_conf_vldt_match_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_python_target_members[];
@@ -255,6 +283,7 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_php_target_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_wasm_access_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_common_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_limits_members[];
+static nxt_conf_vldt_object_t  nxt_conf_vldt_app_queue_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_processes_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_isolation_members[];
 static nxt_conf_vldt_object_t  nxt_conf_vldt_app_namespaces_members[];
@@ -308,6 +337,13 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_setting_members[] = {
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_object,
         .u.members  = nxt_conf_vldt_http_members,
+#if (NXT_TLS)
+    }, {
+        .name       = nxt_string("tls"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_setting_tls_members,
+#endif
 #if (NXT_HAVE_NJS)
     }, {
         .name       = nxt_string("js_module"),
@@ -420,6 +456,9 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_listener_members[] = {
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_object,
         .u.members  = nxt_conf_vldt_client_ip_members
+    }, {
+        .name       = nxt_string("reuseport"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
     },
 
 #if (NXT_TLS)
@@ -477,6 +516,17 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_client_ip_members[] = {
 
 #if (NXT_TLS)
 
+static nxt_conf_vldt_object_t  nxt_conf_vldt_setting_tls_members[] = {
+    {
+        .name       = nxt_string("handshake_threads"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_tls_handshake_threads,
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
 static nxt_conf_vldt_object_t  nxt_conf_vldt_tls_members[] = {
     {
         .name       = nxt_string("certificate"),
@@ -497,11 +547,104 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_tls_members[] = {
         .type       = NXT_CONF_VLDT_OBJECT,
         .validator  = nxt_conf_vldt_object,
         .u.members  = nxt_conf_vldt_session_members,
+    }, {
+        .name       = nxt_string("ktls"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
+#if !(NXT_HAVE_OPENSSL_KTLS)
+        .validator  = nxt_conf_vldt_unsupported,
+        .u.string   = "ktls",
+#endif
+    }, {
+        .name       = nxt_string("records"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_tls_records_members,
+    }, {
+        .name       = nxt_string("early_data"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+#if (NXT_HAVE_OPENSSL_EARLY_DATA)
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_tls_early_data_members,
+#else
+        .validator  = nxt_conf_vldt_unsupported,
+        .u.string   = "early_data",
+#endif
+    }, {
+        .name       = nxt_string("ocsp"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+#if (NXT_HAVE_OPENSSL_OCSP)
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_tls_ocsp_members,
+#else
+        .validator  = nxt_conf_vldt_unsupported,
+        .u.string   = "ocsp",
+#endif
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_tls_records_members[] = {
+    {
+        .name       = nxt_string("initial_size"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_tls_record_size,
+        .u.string   = "initial_size",
+    }, {
+        .name       = nxt_string("max_size"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_tls_record_size,
+        .u.string   = "max_size",
+    }, {
+        .name       = nxt_string("threshold"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_tls_records_number,
+        .u.string   = "threshold",
+    }, {
+        .name       = nxt_string("idle_timeout"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_tls_records_number,
+        .u.string   = "idle_timeout",
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+#if (NXT_HAVE_OPENSSL_EARLY_DATA)
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_tls_early_data_members[] = {
+    {
+        .name       = nxt_string("max_size"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_tls_early_data_size,
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+#endif
+
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_tls_ocsp_members[] = {
+    {
+        .name       = nxt_string("responses"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .flags      = NXT_CONF_VLDT_REQUIRED,
+    }, {
+        .name       = nxt_string("refresh"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_tls_ocsp_refresh,
     },
 
     NXT_CONF_VLDT_END
 };
 
+#endif
+
 
 static nxt_conf_vldt_object_t  nxt_conf_vldt_session_members[] = {
     {
@@ -562,6 +705,99 @@ nxt_conf_vldt_tls_timeout(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
     return NXT_OK;
 }
 
+
+static nxt_int_t
+nxt_conf_vldt_tls_record_size(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  size;
+
+    size = nxt_conf_get_number(value);
+
+    if (size < 512 || size > NXT_TLS_RECORD_MAX_SIZE) {
+        return nxt_conf_vldt_error(vldt, "The \"%s\" number must be between "
+                                         "512 and %d.",
+                                         data, NXT_TLS_RECORD_MAX_SIZE);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_tls_records_number(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    if (nxt_conf_get_number(value) < 0) {
+        return nxt_conf_vldt_error(vldt, "The \"%s\" number must not "
+                                         "be negative.", data);
+    }
+
+    return NXT_OK;
+}
+
+
+#if (NXT_HAVE_OPENSSL_EARLY_DATA)
+
+static nxt_int_t
+nxt_conf_vldt_tls_early_data_size(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  size;
+
+    size = nxt_conf_get_number(value);
+
+    if (size < 1 || size > NXT_TLS_EARLY_DATA_MAX_SIZE) {
+        return nxt_conf_vldt_error(vldt, "The \"max_size\" number must be "
+                                         "between 1 and %d.",
+                                         NXT_TLS_EARLY_DATA_MAX_SIZE);
+    }
+
+    return NXT_OK;
+}
+
+#endif
+
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+
+static nxt_int_t
+nxt_conf_vldt_tls_ocsp_refresh(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    if (nxt_conf_get_number(value) < 1) {
+        return nxt_conf_vldt_error(vldt, "The \"refresh\" number must be "
+                                         "greater than 0.");
+    }
+
+    return NXT_OK;
+}
+
+#endif
+
+
+static nxt_int_t
+nxt_conf_vldt_tls_handshake_threads(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  threads;
+
+    threads = nxt_conf_get_number(value);
+
+    if (threads < 0) {
+        return nxt_conf_vldt_error(vldt, "The \"handshake_threads\" number "
+                                         "must not be negative.");
+    }
+
+    if (threads > NXT_TLS_MAX_HANDSHAKE_THREADS) {
+        return nxt_conf_vldt_error(vldt, "The \"handshake_threads\" number "
+                                         "must not exceed %d.",
+                                         NXT_TLS_MAX_HANDSHAKE_THREADS);
+    }
+
+    return NXT_OK;
+}
+
 #endif
 
 #if (NXT_HAVE_OPENSSL_TLSEXT)
@@ -708,6 +944,14 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_pass_action_members[] = {
         .type       = NXT_CONF_VLDT_STRING,
         .validator  = nxt_conf_vldt_pass,
         .flags      = NXT_CONF_VLDT_TSTR,
+    }, {
+        .name       = nxt_string("priority"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .validator  = nxt_conf_vldt_priority,
+    }, {
+        .name       = nxt_string("affinity"),
+        .type       = NXT_CONF_VLDT_STRING,
+        .flags      = NXT_CONF_VLDT_TSTR,
     },
 
     NXT_CONF_VLDT_NEXT(nxt_conf_vldt_action_common_members)
@@ -820,6 +1064,9 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_python_common_members[] = {
         .name       = nxt_string("thread_stack_size"),
         .type       = NXT_CONF_VLDT_INTEGER,
         .validator  = nxt_conf_vldt_thread_stack_size,
+    }, {
+        .name       = nxt_string("preload"),
+        .type       = NXT_CONF_VLDT_BOOLEAN,
     },
 
     NXT_CONF_VLDT_NEXT(nxt_conf_vldt_common_members)
@@ -1158,6 +1405,26 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_app_limits_members[] = {
     }, {
         .name       = nxt_string("shm"),
         .type       = NXT_CONF_VLDT_INTEGER,
+    }, {
+        .name       = nxt_string("queue"),
+        .type       = NXT_CONF_VLDT_OBJECT,
+        .validator  = nxt_conf_vldt_object,
+        .u.members  = nxt_conf_vldt_app_queue_members,
+    },
+
+    NXT_CONF_VLDT_END
+};
+
+
+static nxt_conf_vldt_object_t  nxt_conf_vldt_app_queue_members[] = {
+    {
+        .name       = nxt_string("size"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_app_queue_size,
+    }, {
+        .name       = nxt_string("wait"),
+        .type       = NXT_CONF_VLDT_INTEGER,
+        .validator  = nxt_conf_vldt_app_queue_wait,
     },
 
     NXT_CONF_VLDT_END
@@ -1174,6 +1441,9 @@ static nxt_conf_vldt_object_t  nxt_conf_vldt_app_processes_members[] = {
     }, {
         .name       = nxt_string("idle_timeout"),
         .type       = NXT_CONF_VLDT_INTEGER,
+    }, {
+        .name       = nxt_string("target_latency"),
+        .type       = NXT_CONF_VLDT_INTEGER,
     },
 
     NXT_CONF_VLDT_END
@@ -1405,6 +1675,93 @@ nxt_conf_validate(nxt_conf_validation_t *vldt)
 }
 
 
+/*
+ * The certificates, JS modules, and application modules may be changed
+ * while a valid configuration is stored, so their existence is checked
+ * for the stored configuration that is not validated again.
+ */
+
+nxt_int_t
+nxt_conf_validate_refs(nxt_conf_validation_t *vldt)
+{
+    uint32_t               next;
+    nxt_int_t              ret;
+    nxt_str_t              name, type;
+    nxt_thread_t           *thread;
+    nxt_conf_value_t       *value, *member;
+    nxt_app_lang_module_t  *lang;
+
+    static nxt_str_t  applications_path = nxt_string("/applications");
+    static nxt_str_t  type_path = nxt_string("/type");
+#if (NXT_TLS)
+    static nxt_str_t  listeners_path = nxt_string("/listeners");
+    static nxt_str_t  certificate_path = nxt_string("/tls/certificate");
+#endif
+#if (NXT_HAVE_NJS)
+    static nxt_str_t  js_module_path = nxt_string("/settings/js_module");
+#endif
+
+#if (NXT_TLS)
+    value = nxt_conf_get_path(vldt->conf, &listeners_path);
+
+    if (value != NULL) {
+        next = 0;
+
+        for ( ;; ) {
+            member = nxt_conf_next_object_member(value, &name, &next);
+            if (member == NULL) {
+                break;
+            }
+
+            member = nxt_conf_get_path(member, &certificate_path);
+
+            if (member != NULL) {
+                ret = nxt_conf_vldt_certificate(vldt, member, NULL);
+                if (ret != NXT_OK) {
+                    return ret;
+                }
+            }
+        }
+    }
+#endif
+
+    value = nxt_conf_get_path(vldt->conf, &applications_path);
+
+    if (value != NULL) {
+        thread = nxt_thread();
+        next = 0;
+
+        for ( ;; ) {
+            member = nxt_conf_next_object_member(value, &name, &next);
+            if (member == NULL) {
+                break;
+            }
+
+            member = nxt_conf_get_path(member, &type_path);
+            nxt_conf_get_string(member, &type);
+
+            lang = nxt_app_lang_module(thread->runtime, &type);
+            if (lang == NULL) {
+                return nxt_conf_vldt_error(vldt,
+                                   "The module to run \"%V\" is not found "
+                                   "among the available application modules.",
+                                   &type);
+            }
+        }
+    }
+
+#if (NXT_HAVE_NJS)
+    value = nxt_conf_get_path(vldt->conf, &js_module_path);
+
+    if (value != NULL) {
+        return nxt_conf_vldt_js_module(vldt, value, NULL);
+    }
+#endif
+
+    return NXT_OK;
+}
+
+
 #define NXT_CONF_VLDT_ANY_TYPE_STR                                            \
     "either a null, a boolean, an integer, "                                  \
     "a number, a string, an array, or an object"
@@ -1833,6 +2190,30 @@ nxt_conf_vldt_pass(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
 }
 
 
+static nxt_int_t
+nxt_conf_vldt_priority(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
+    void *data)
+{
+    nxt_str_t  priority;
+
+    static const nxt_str_t  high = nxt_string("high");
+    static const nxt_str_t  normal = nxt_string("normal");
+    static const nxt_str_t  low = nxt_string("low");
+
+    nxt_conf_get_string(value, &priority);
+
+    if (nxt_strstr_eq(&priority, &high)
+        || nxt_strstr_eq(&priority, &normal)
+        || nxt_strstr_eq(&priority, &low))
+    {
+        return NXT_OK;
+    }
+
+    return nxt_conf_vldt_error(vldt, "The \"priority\" can be \"high\", "
+                                     "\"normal\", or \"low\".");
+}
+
+
 static nxt_int_t
 nxt_conf_vldt_return(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
     void *data)
@@ -2755,6 +3136,7 @@ typedef struct {
     int64_t  spare;
     int64_t  max;
     int64_t  idle_timeout;
+    int64_t  target_latency;
 } nxt_conf_vldt_processes_conf_t;
 
 
@@ -2776,6 +3158,12 @@ static nxt_conf_map_t  nxt_conf_vldt_processes_conf_map[] = {
         NXT_CONF_MAP_INT64,
         offsetof(nxt_conf_vldt_processes_conf_t, idle_timeout),
     },
+
+    {
+        nxt_string("target_latency"),
+        NXT_CONF_MAP_INT64,
+        offsetof(nxt_conf_vldt_processes_conf_t, target_latency),
+    },
 };
 
 
@@ -2811,6 +3199,7 @@ nxt_conf_vldt_processes(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
     proc.spare = 0;
     proc.max = 1;
     proc.idle_timeout = 15;
+    proc.target_latency = 0;
 
     ret = nxt_conf_map_object(vldt->pool, value,
                               nxt_conf_vldt_processes_conf_map,
@@ -2855,6 +3244,60 @@ nxt_conf_vldt_processes(nxt_conf_validation_t *vldt, nxt_conf_value_t *value,
                                    "exceed %d.", NXT_INT32_T_MAX / 1000);
     }
 
+    if (proc.target_latency < 0) {
+        return nxt_conf_vldt_error(vldt, "The \"target_latency\" number must "
+                                   "not be negative.");
+    }
+
+    if (proc.target_latency > NXT_INT32_T_MAX) {
+        return nxt_conf_vldt_error(vldt, "The \"target_latency\" number must "
+                                   "not exceed %d.", NXT_INT32_T_MAX);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_app_queue_size(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  size;
+
+    size = nxt_conf_get_number(value);
+
+    if (size < 0) {
+        return nxt_conf_vldt_error(vldt, "The \"size\" number must not "
+                                   "be negative.");
+    }
+
+    if (size > NXT_INT32_T_MAX) {
+        return nxt_conf_vldt_error(vldt, "The \"size\" number must not "
+                                   "exceed %d.", NXT_INT32_T_MAX);
+    }
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_conf_vldt_app_queue_wait(nxt_conf_validation_t *vldt,
+    nxt_conf_value_t *value, void *data)
+{
+    int64_t  wait;
+
+    wait = nxt_conf_get_number(value);
+
+    if (wait < 0) {
+        return nxt_conf_vldt_error(vldt, "The \"wait\" number must not "
+                                   "be negative.");
+    }
+
+    if (wait > NXT_INT32_T_MAX) {
+        return nxt_conf_vldt_error(vldt, "The \"wait\" number must not "
+                                   "exceed %d.", NXT_INT32_T_MAX);
+    }
+
     return NXT_OK;
 }
 
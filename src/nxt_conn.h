@@ -168,6 +168,8 @@ struct nxt_conn_s {
 
     uint8_t                       sendfile;     /* 2 bits */
     uint8_t                       tcp_nodelay;  /* 1 bit */
+    /* The last data read are TLS early data. */
+    uint8_t                       early_data;   /* 1 bit */
 
     nxt_queue_link_t              link;
 };
@@ -178,6 +180,7 @@ struct nxt_conn_s {
         (ev)->work_queue = (wq);                                              \
         (ev)->log = &(c)->log;                                                \
         (ev)->bias = NXT_TIMER_DEFAULT_BIAS;                                  \
+        (ev)->coarse = 1;                                                     \
     } while (0)
 
 
@@ -237,6 +240,8 @@ void nxt_conn_connect_error(nxt_task_t *task, void *obj, void *data);
 
 NXT_EXPORT nxt_listen_event_t *nxt_listen_event(nxt_task_t *task,
     nxt_listen_socket_t *ls);
+NXT_EXPORT nxt_listen_event_t *nxt_listen_shard_event(nxt_task_t *task,
+    nxt_listen_socket_t *ls, nxt_uint_t shard);
 void nxt_conn_io_accept(nxt_task_t *task, void *obj, void *data);
 NXT_EXPORT void nxt_conn_accept(nxt_task_t *task, nxt_listen_event_t *lev,
     nxt_conn_t *c);
@@ -302,7 +307,7 @@ NXT_EXPORT void nxt_event_conn_job_sendfile(nxt_task_t *task,
         nxt_queue_insert_head(&e->idle_connections, &c->link);                \
                                                                               \
         c->idle = 1;                                                          \
-        e->idle_conns_cnt++;                                                  \
+        e->counters->idle_conns++;                                            \
     } while (0)
 
 
@@ -312,7 +317,7 @@ NXT_EXPORT void nxt_event_conn_job_sendfile(nxt_task_t *task,
                                                                               \
         nxt_queue_remove(&c->link);                                           \
                                                                               \
-        e->idle_conns_cnt -= c->idle;                               \
+        e->counters->idle_conns -= c->idle;                                   \
     } while (0)
 
 
@@ -18,6 +18,8 @@
  */
 
 
+static nxt_listen_event_t *nxt_listen_event_create(nxt_task_t *task,
+    nxt_listen_socket_t *ls, nxt_socket_t s);
 static nxt_conn_t *nxt_conn_accept_alloc(nxt_task_t *task,
     nxt_listen_event_t *lev);
 static void nxt_conn_listen_handler(nxt_task_t *task, void *obj,
@@ -36,6 +38,22 @@ static void nxt_conn_listen_timer_handler(nxt_task_t *task, void *obj,
 
 nxt_listen_event_t *
 nxt_listen_event(nxt_task_t *task, nxt_listen_socket_t *ls)
+{
+    return nxt_listen_event_create(task, ls, ls->socket);
+}
+
+
+nxt_listen_event_t *
+nxt_listen_shard_event(nxt_task_t *task, nxt_listen_socket_t *ls,
+    nxt_uint_t shard)
+{
+    return nxt_listen_event_create(task, ls, ls->shards[shard]);
+}
+
+
+static nxt_listen_event_t *
+nxt_listen_event_create(nxt_task_t *task, nxt_listen_socket_t *ls,
+    nxt_socket_t s)
 {
     nxt_listen_event_t  *lev;
     nxt_event_engine_t  *engine;
@@ -43,7 +61,7 @@ nxt_listen_event(nxt_task_t *task, nxt_listen_socket_t *ls)
     lev = nxt_zalloc(sizeof(nxt_listen_event_t));
 
     if (nxt_fast_path(lev != NULL)) {
-        lev->socket.fd = ls->socket;
+        lev->socket.fd = s;
 
         engine = task->thread->engine;
         lev->batch = engine->batch;
@@ -198,7 +216,7 @@ nxt_conn_accept(nxt_task_t *task, nxt_listen_event_t *lev, nxt_conn_t *c)
 
     engine = task->thread->engine;
 
-    engine->accepted_conns_cnt++;
+    engine->counters->accepted_conns++;
 
     nxt_conn_idle(engine, c);
 
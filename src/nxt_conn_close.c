@@ -120,7 +120,7 @@ nxt_conn_close_handler(nxt_task_t *task, void *obj, void *data)
         c->socket.fd = -1;
 
         if (c->idle) {
-            engine->closed_conns_cnt++;
+            engine->counters->closed_conns++;
         }
 
         if (timers_pending == 0) {
@@ -158,7 +158,7 @@ nxt_conn_close_timer_handler(nxt_task_t *task, void *obj, void *data)
         c->socket.fd = -1;
 
         if (c->idle) {
-            engine->closed_conns_cnt++;
+            engine->counters->closed_conns++;
         }
     }
 
@@ -86,11 +86,15 @@ static void nxt_controller_process_request(nxt_task_t *task,
     nxt_controller_request_t *req);
 static void nxt_controller_process_config(nxt_task_t *task,
     nxt_controller_request_t *req, nxt_str_t *path);
+static nxt_conf_value_t *nxt_controller_conf_transaction(nxt_task_t *task,
+    nxt_controller_request_t *req, nxt_mp_t *mp, nxt_conf_value_t *ops,
+    nxt_controller_response_t *resp);
 static nxt_bool_t nxt_controller_check_postpone_request(nxt_task_t *task);
 static void nxt_controller_process_status(nxt_task_t *task,
     nxt_controller_request_t *req);
 static void nxt_controller_status_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, void *data);
+static nxt_bool_t nxt_controller_status_shared(nxt_str_t *path);
 static void nxt_controller_status_response(nxt_task_t *task,
     nxt_controller_request_t *req, nxt_str_t *path);
 #if (NXT_TLS)
@@ -197,6 +201,12 @@ nxt_controller_prefork(nxt_task_t *task, nxt_process_t *process, nxt_mp_t *mp)
     }
 
     if (ret == NXT_OK) {
+        ret = nxt_controller_file_read(task, rt->conf_digest,
+                                       &ctrl_init.conf_digest, mp);
+        if (nxt_slow_path(ret == NXT_ERROR)) {
+            return NXT_ERROR;
+        }
+
         ret = nxt_controller_file_read(task, rt->ver, &ver, mp);
         if (nxt_slow_path(ret == NXT_ERROR)) {
             return NXT_ERROR;
@@ -315,9 +325,11 @@ nxt_controller_start(nxt_task_t *task, nxt_process_data_t *data)
     nxt_mp_t               *mp;
     nxt_int_t              ret;
     nxt_str_t              *json;
+    nxt_bool_t             changed;
     nxt_conf_value_t       *conf;
     nxt_conf_validation_t  vldt;
     nxt_controller_init_t  *init;
+    u_char                 digest[NXT_CONF_DIGEST_LEN];
 
     ret = nxt_http_fields_hash(&nxt_controller_fields_hash,
                                nxt_controller_request_fields,
@@ -365,6 +377,23 @@ nxt_controller_start(nxt_task_t *task, nxt_process_data_t *data)
         return NXT_OK;
     }
 
+    /*
+     * The configuration has been validated before it was stored,
+     * so it is validated again only if it is changed or the stored
+     * digest is missing or belongs to another version.  Otherwise
+     * only the certificates and modules it uses are looked up.
+     */
+
+    changed = 1;
+
+    if (init->conf_digest.length == NXT_CONF_DIGEST_LEN) {
+        (void) nxt_conf_digest(digest, json->start, json->length);
+
+        changed = (memcmp(digest, init->conf_digest.start,
+                          NXT_CONF_DIGEST_LEN)
+                   != 0);
+    }
+
     nxt_memzero(&vldt, sizeof(nxt_conf_validation_t));
 
     vldt.pool = nxt_mp_create(1024, 128, 256, 32);
@@ -377,7 +406,14 @@ nxt_controller_start(nxt_task_t *task, nxt_process_data_t *data)
     vldt.conf_pool = mp;
     vldt.ver = nxt_conf_ver;
 
-    ret = nxt_conf_validate(&vldt);
+    if (changed) {
+        ret = nxt_conf_validate(&vldt);
+
+    } else {
+        nxt_debug(task, "previous configuration is not changed");
+
+        ret = nxt_conf_validate_refs(&vldt);
+    }
 
     if (nxt_slow_path(ret != NXT_OK)) {
 
@@ -1118,11 +1154,6 @@ nxt_controller_process_request(nxt_task_t *task, nxt_controller_request_t *req)
             goto invalid_method;
         }
 
-        if (nxt_controller_status == NULL) {
-            nxt_controller_process_status(task, req);
-            return;
-        }
-
         if (path.length == 7) {
             path.length = 1;
 
@@ -1131,6 +1162,13 @@ nxt_controller_process_request(nxt_task_t *task, nxt_controller_request_t *req)
             path.start += 7;
         }
 
+        if (nxt_controller_status == NULL
+            && !nxt_controller_status_shared(&path))
+        {
+            nxt_controller_process_status(task, req);
+            return;
+        }
+
         nxt_controller_status_response(task, req, &path);
         return;
     }
@@ -1269,7 +1307,7 @@ nxt_controller_process_config(nxt_task_t *task, nxt_controller_request_t *req,
     nxt_mp_t                   *mp;
     nxt_int_t                  rc;
     nxt_conn_t                 *c;
-    nxt_bool_t                 post;
+    nxt_bool_t                 post, patch;
     nxt_buf_mem_t              *mbuf;
     nxt_conf_op_t              *ops;
     nxt_conf_value_t           *value;
@@ -1309,7 +1347,13 @@ nxt_controller_process_config(nxt_task_t *task, nxt_controller_request_t *req,
         post = 0;
     }
 
-    if (post || nxt_str_eq(&req->parser.method, "PUT", 3)) {
+    patch = nxt_str_eq(&req->parser.method, "PATCH", 5);
+
+    if (patch && path->length != 1) {
+        goto not_allowed;
+    }
+
+    if (post || patch || nxt_str_eq(&req->parser.method, "PUT", 3)) {
 
         if (nxt_controller_check_postpone_request(task)) {
             nxt_queue_insert_tail(&nxt_controller_waiting_requests, &req->link);
@@ -1355,7 +1399,18 @@ nxt_controller_process_config(nxt_task_t *task, nxt_controller_request_t *req,
             return;
         }
 
-        if (path->length != 1) {
+        if (patch) {
+            value = nxt_controller_conf_transaction(task, req, mp, value,
+                                                    &resp);
+
+            if (value == NULL) {
+                nxt_mp_destroy(mp);
+
+                nxt_controller_response(task, req, &resp);
+                return;
+            }
+
+        } else if (path->length != 1) {
             rc = nxt_conf_op_compile(c->mem_pool, &ops,
                                      nxt_controller_conf.root,
                                      path, value, post);
@@ -1542,6 +1597,226 @@ nxt_controller_process_config(nxt_task_t *task, nxt_controller_request_t *req,
 }
 
 
+/*
+ * A transaction is an array of operations, each of them is an object
+ * with the "method", "path", and "value" members that are the same as
+ * in a separate PUT, POST, or DELETE request to the /config path.
+ * The operations are applied one by one to intermediate configurations,
+ * and the result is validated and sent to the router only once.
+ */
+
+static nxt_conf_value_t *
+nxt_controller_conf_transaction(nxt_task_t *task, nxt_controller_request_t *req,
+    nxt_mp_t *mp, nxt_conf_value_t *ops, nxt_controller_response_t *resp)
+{
+    nxt_mp_t          *step_mp, *root_mp;
+    nxt_int_t         rc;
+    nxt_str_t         path, method;
+    nxt_bool_t        post;
+    nxt_conn_t        *c;
+    nxt_uint_t        i, n;
+    nxt_conf_op_t     *conf_ops;
+    const char        *detail;
+    nxt_conf_value_t  *op, *root, *value, *member;
+
+    static const nxt_str_t  empty_obj = nxt_string("{}");
+    static nxt_str_t        method_str = nxt_string("method");
+    static nxt_str_t        path_str = nxt_string("path");
+    static nxt_str_t        value_str = nxt_string("value");
+
+    c = req->conn;
+
+    resp->offset = -1;
+
+    if (nxt_conf_type(ops) != NXT_CONF_ARRAY
+        || nxt_conf_array_elements_count(ops) == 0)
+    {
+        resp->status = 400;
+        resp->title = (u_char *) "Invalid transaction.";
+        nxt_str_set(&resp->detail, "A transaction must be a non-empty array "
+                                   "of operations.");
+        return NULL;
+    }
+
+    n = nxt_conf_array_elements_count(ops);
+
+    root = nxt_controller_conf.root;
+    root_mp = NULL;
+
+    for (i = 0; i < n; i++) {
+        op = nxt_conf_get_array_element(ops, i);
+
+        if (nxt_conf_type(op) != NXT_CONF_OBJECT) {
+            goto invalid;
+        }
+
+        member = nxt_conf_get_object_member(op, &method_str, NULL);
+        if (member == NULL || nxt_conf_type(member) != NXT_CONF_STRING) {
+            goto invalid;
+        }
+
+        nxt_conf_get_string(member, &method);
+
+        member = nxt_conf_get_object_member(op, &path_str, NULL);
+        if (member == NULL || nxt_conf_type(member) != NXT_CONF_STRING) {
+            goto invalid;
+        }
+
+        nxt_conf_get_string(member, &path);
+
+        if (path.length == 0 || path.start[0] != '/') {
+            goto invalid;
+        }
+
+        if (path.length > 1 && path.start[path.length - 1] == '/') {
+            path.length--;
+        }
+
+        value = nxt_conf_get_object_member(op, &value_str, NULL);
+
+        if (nxt_conf_object_members_count(op) != 2 + (value != NULL)) {
+            goto invalid;
+        }
+
+        post = 0;
+
+        if (nxt_str_eq(&method, "DELETE", 6)) {
+            if (value != NULL) {
+                goto invalid;
+            }
+
+            if (path.length == 1) {
+                value = nxt_conf_json_parse_str(mp, &empty_obj);
+                if (nxt_slow_path(value == NULL)) {
+                    goto alloc_fail;
+                }
+            }
+
+        } else if (nxt_str_eq(&method, "PUT", 3)
+                   || nxt_str_eq(&method, "POST", 4))
+        {
+            if (value == NULL) {
+                goto invalid;
+            }
+
+            post = (method.length == 4);
+
+            if (post && path.length == 1) {
+                goto not_allowed;
+            }
+
+        } else {
+            goto invalid;
+        }
+
+        if (path.length == 1) {
+            /* The whole configuration is replaced. */
+
+            if (root_mp != NULL) {
+                nxt_mp_destroy(root_mp);
+                root_mp = NULL;
+            }
+
+            root = value;
+            continue;
+        }
+
+        rc = nxt_conf_op_compile(c->mem_pool, &conf_ops, root, &path,
+                                 value, post);
+
+        if (rc != NXT_CONF_OP_OK) {
+            switch (rc) {
+            case NXT_CONF_OP_NOT_FOUND:
+                goto not_found;
+
+            case NXT_CONF_OP_NOT_ALLOWED:
+                goto not_allowed;
+            }
+
+            /* rc == NXT_CONF_OP_ERROR */
+            goto alloc_fail;
+        }
+
+        /*
+         * The values of the operations are kept in the pool of the request
+         * body, the last configuration is created there too.
+         */
+
+        if (i + 1 == n) {
+            step_mp = mp;
+
+        } else {
+            step_mp = nxt_mp_create(1024, 128, 256, 32);
+            if (nxt_slow_path(step_mp == NULL)) {
+                goto alloc_fail;
+            }
+        }
+
+        root = nxt_conf_clone(step_mp, conf_ops, root);
+
+        if (root_mp != NULL) {
+            nxt_mp_destroy(root_mp);
+        }
+
+        root_mp = (step_mp != mp) ? step_mp : NULL;
+
+        if (nxt_slow_path(root == NULL)) {
+            goto alloc_fail;
+        }
+    }
+
+    return root;
+
+invalid:
+
+    resp->status = 400;
+    resp->title = (u_char *) "Invalid transaction.";
+    detail = "The operation must be an object with the \"method\" "
+             "(\"PUT\", \"POST\", or \"DELETE\"), \"path\", "
+             "and \"value\" (except for DELETE) members.";
+    goto error;
+
+not_found:
+
+    resp->status = 404;
+    resp->title = (u_char *) "Value doesn't exist.";
+    detail = "The path of the operation doesn't exist.";
+    goto error;
+
+not_allowed:
+
+    resp->status = 405;
+    resp->title = (u_char *) "Method isn't allowed.";
+    detail = "The method isn't allowed for the path of the operation.";
+    goto error;
+
+alloc_fail:
+
+    resp->status = 500;
+    resp->title = (u_char *) "Memory allocation failed.";
+    detail = NULL;
+
+error:
+
+    if (root_mp != NULL) {
+        nxt_mp_destroy(root_mp);
+    }
+
+    if (detail != NULL) {
+        resp->detail.start = nxt_mp_nget(c->mem_pool, 256);
+
+        if (resp->detail.start != NULL) {
+            resp->detail.length = nxt_sprintf(resp->detail.start,
+                                              resp->detail.start + 256,
+                                              "Operation %ui: %s", i, detail)
+                                  - resp->detail.start;
+        }
+    }
+
+    return NULL;
+}
+
+
 static nxt_bool_t
 nxt_controller_check_postpone_request(nxt_task_t *task)
 {
@@ -1624,6 +1899,7 @@ nxt_controller_status_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
     void *data)
 {
     nxt_conf_value_t           *status;
+    nxt_status_report_t        *report;
     nxt_controller_request_t   *req;
     nxt_controller_response_t  resp;
 
@@ -1632,8 +1908,12 @@ nxt_controller_status_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
     req = data;
 
     if (msg->port_msg.type == NXT_PORT_MSG_RPC_READY) {
-        status = nxt_status_get((nxt_status_report_t *) msg->buf->mem.pos,
-                                req->conn->mem_pool);
+        report = (nxt_status_report_t *) msg->buf->mem.pos;
+
+        nxt_status_counters(report);
+
+        status = nxt_status_get(report, req->conn->mem_pool);
+
     } else {
         status = NULL;
     }
@@ -1658,17 +1938,57 @@ nxt_controller_status_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
 }
 
 
+/*
+ * The connection and request counters are read from the shared memory
+ * directly, without asking the router for the whole status.
+ */
+
+static nxt_bool_t
+nxt_controller_status_shared(nxt_str_t *path)
+{
+    if (nxt_str_start(path, "/connections", 12)) {
+        return (path->length == 12 || path->start[12] == '/');
+    }
+
+    if (nxt_str_start(path, "/requests", 9)) {
+        return (path->length == 9 || path->start[9] == '/');
+    }
+
+    return 0;
+}
+
+
 static void
 nxt_controller_status_response(nxt_task_t *task, nxt_controller_request_t *req,
     nxt_str_t *path)
 {
     nxt_conf_value_t           *status;
+    nxt_status_report_t        report;
     nxt_controller_response_t  resp;
 
-    status = nxt_conf_get_path(nxt_controller_status, path);
-
     nxt_memzero(&resp, sizeof(nxt_controller_response_t));
 
+    status = nxt_controller_status;
+
+    if (status == NULL) {
+        nxt_memzero(&report, sizeof(nxt_status_report_t));
+
+        nxt_status_counters(&report);
+
+        status = nxt_status_get(&report, req->conn->mem_pool);
+
+        if (nxt_slow_path(status == NULL)) {
+            resp.status = 500;
+            resp.title = (u_char *) "Memory allocation failed.";
+            resp.offset = -1;
+
+            nxt_controller_response(task, req, &resp);
+            return;
+        }
+    }
+
+    status = nxt_conf_get_path(status, path);
+
     if (status == NULL) {
         resp.status = 404;
         resp.title = (u_char *) "Invalid path.";
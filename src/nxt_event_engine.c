@@ -62,6 +62,8 @@ nxt_event_engine_create(nxt_task_t *task,
 
     engine->batch = batch;
 
+    engine->counters = &engine->local_counters;
+
 #if 0
     if (flags & NXT_ENGINE_FIBERS) {
         engine->fibers = nxt_fiber_main_create(engine);
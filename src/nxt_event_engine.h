@@ -225,6 +225,58 @@ extern const nxt_event_interface_t  nxt_epoll_level_engine;
 #endif
 
 
+#if (NXT_HAVE_IO_URING)
+
+typedef struct {
+    nxt_fd_event_t                *event;
+    uint32_t                      generation;
+    uint32_t                      events;
+} nxt_io_uring_fd_t;
+
+
+typedef struct {
+    uint8_t                       op;
+    uint32_t                      events;
+    nxt_fd_event_t                *event;
+} nxt_io_uring_change_t;
+
+
+typedef struct {
+    int                           fd;
+
+    nxt_uint_t                    nchanges;
+    nxt_uint_t                    mchanges;
+    nxt_io_uring_change_t         *changes;
+
+    nxt_uint_t                    nfds;
+    nxt_io_uring_fd_t             *fds;
+
+    uint32_t                      nsubmit;
+    uint32_t                      sq_entries;
+    uint32_t                      *sq_tail;
+    uint32_t                      *sq_mask;
+    struct io_uring_sqe           *sqes;
+
+    uint32_t                      *cq_head;
+    uint32_t                      *cq_tail;
+    uint32_t                      *cq_mask;
+    struct io_uring_cqe           *cqes;
+
+    void                          *sq_ring;
+    size_t                        sq_ring_size;
+    void                          *cq_ring;
+    size_t                        cq_ring_size;
+    size_t                        sqes_size;
+} nxt_io_uring_engine_t;
+
+
+extern const nxt_event_interface_t  nxt_io_uring_engine;
+
+nxt_bool_t nxt_io_uring_available(nxt_task_t *task);
+
+#endif
+
+
 #if (NXT_HAVE_EVENTPORT)
 
 typedef struct {
@@ -416,6 +468,14 @@ typedef struct {
 } nxt_event_engine_pipe_t;
 
 
+typedef struct {
+    nxt_atomic_t               accepted_conns;
+    nxt_atomic_t               idle_conns;
+    nxt_atomic_t               closed_conns;
+    nxt_atomic_t               requests;
+} nxt_engine_counters_t;
+
+
 struct nxt_event_engine_s {
     nxt_task_t                 task;
 
@@ -429,6 +489,9 @@ struct nxt_event_engine_s {
 #if (NXT_HAVE_EPOLL)
         nxt_epoll_engine_t     epoll;
 #endif
+#if (NXT_HAVE_IO_URING)
+        nxt_io_uring_engine_t  io_uring;
+#endif
 #if (NXT_HAVE_EVENTPORT)
         nxt_eventport_engine_t eventport;
 #endif
@@ -483,10 +546,15 @@ struct nxt_event_engine_s {
     nxt_queue_t                idle_connections;
     nxt_array_t                *mem_cache;
 
-    nxt_atomic_uint_t          accepted_conns_cnt;
-    nxt_atomic_uint_t          idle_conns_cnt;
-    nxt_atomic_uint_t          closed_conns_cnt;
-    nxt_atomic_uint_t          requests_cnt;
+    /* The cache of HTTP route matching results. */
+    void                       *route_cache;
+
+    /*
+     * The router engines count in the shared memory
+     * read by the controller, other engines use local_counters.
+     */
+    nxt_engine_counters_t      *counters;
+    nxt_engine_counters_t      local_counters;
 
     nxt_queue_link_t           link;
     // STUB: router link
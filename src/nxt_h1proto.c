@@ -31,6 +31,9 @@ static nxt_int_t nxt_h1p_header_process(nxt_task_t *task, nxt_h1proto_t *h1p,
     nxt_http_request_t *r);
 static nxt_int_t nxt_h1p_header_buffer_test(nxt_task_t *task,
     nxt_h1proto_t *h1p, nxt_conn_t *c, nxt_socket_conf_t *skcf);
+#if (NXT_TLS)
+static nxt_int_t nxt_h1p_early_data(nxt_task_t *task, nxt_http_request_t *r);
+#endif
 static nxt_int_t nxt_h1p_connection(void *ctx, nxt_http_field_t *field,
     uintptr_t data);
 static nxt_int_t nxt_h1p_upgrade(void *ctx, nxt_http_field_t *field,
@@ -492,6 +495,7 @@ nxt_h1p_conn_request_init(nxt_task_t *task, void *obj, void *data)
 #if (NXT_TLS)
         r->tls = (c->u.tls != NULL);
 #endif
+        r->sendfile = (c->sendfile == NXT_CONN_SENDFILE_ON);
 
         r->task = c->task;
         task = &r->task;
@@ -595,6 +599,15 @@ nxt_h1p_conn_request_header_parse(nxt_task_t *task, void *obj, void *data)
                 status = NXT_HTTP_TO_HTTPS;
                 goto error;
             }
+
+            if (c->early_data) {
+                ret = nxt_h1p_early_data(task, r);
+
+                if (nxt_slow_path(ret != NXT_OK)) {
+                    status = ret;
+                    goto error;
+                }
+            }
 #endif
 
             r->state->ready_handler(task, r, NULL);
@@ -710,6 +723,55 @@ nxt_h1p_header_process(nxt_task_t *task, nxt_h1proto_t *h1p,
 }
 
 
+#if (NXT_TLS)
+
+/*
+ * A request received in TLS early data can be replayed by an attacker,
+ * so only safe methods are processed and the request is marked with
+ * the "Early-Data" header field for applications as in RFC 8470.
+ */
+
+static nxt_int_t
+nxt_h1p_early_data(nxt_task_t *task, nxt_http_request_t *r)
+{
+    uint32_t          hash;
+    nxt_uint_t        i;
+    nxt_http_field_t  *field;
+
+    static const u_char  name[] = "Early-Data";
+
+    if (!nxt_str_eq(r->method, "GET", 3)
+        && !nxt_str_eq(r->method, "HEAD", 4)
+        && !nxt_str_eq(r->method, "OPTIONS", 7))
+    {
+        nxt_debug(task, "h1p early data request rejected");
+
+        return NXT_HTTP_TOO_EARLY;
+    }
+
+    field = nxt_list_add(r->fields);
+    if (nxt_slow_path(field == NULL)) {
+        return NXT_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    hash = NXT_HTTP_FIELD_HASH_INIT;
+
+    for (i = 0; i < nxt_length(name); i++) {
+        hash = nxt_http_field_hash_char(hash, nxt_lowcase(name[i]));
+    }
+
+    field->hash = nxt_http_field_hash_end(hash);
+    field->skip = 0;
+    field->hopbyhop = 0;
+
+    nxt_http_field_set(field, "Early-Data", "1");
+
+    return NXT_OK;
+}
+
+#endif
+
+
 static nxt_int_t
 nxt_h1p_header_buffer_test(nxt_task_t *task, nxt_h1proto_t *h1p, nxt_conn_t *c,
     nxt_socket_conf_t *skcf)
@@ -1169,7 +1231,7 @@ static const nxt_str_t  nxt_http_client_error[] = {
     nxt_string("HTTP/1.1 422 Unprocessable Entity\r\n"),
     nxt_string("HTTP/1.1 423 Locked\r\n"),
     nxt_string("HTTP/1.1 424 Failed Dependency\r\n"),
-    nxt_string("HTTP/1.1 425 \r\n"),
+    nxt_string("HTTP/1.1 425 Too Early\r\n"),
     nxt_string("HTTP/1.1 426 Upgrade Required\r\n"),
     nxt_string("HTTP/1.1 427 \r\n"),
     nxt_string("HTTP/1.1 428 \r\n"),
@@ -36,6 +36,7 @@ typedef enum {
     NXT_HTTP_LENGTH_REQUIRED = 411,
     NXT_HTTP_PAYLOAD_TOO_LARGE = 413,
     NXT_HTTP_URI_TOO_LONG = 414,
+    NXT_HTTP_TOO_EARLY = 425,
     NXT_HTTP_UPGRADE_REQUIRED = 426,
     NXT_HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE = 431,
 
@@ -184,6 +185,8 @@ struct nxt_http_request_s {
     nxt_buf_t                       *last;
 
     nxt_queue_link_t                app_link;   /* nxt_app_t.ack_waiting_req */
+    nxt_msec_t                      app_queue_start;
+    uint32_t                        app_affinity;
     nxt_event_engine_t              *engine;
     nxt_work_t                      err_work;
 
@@ -197,6 +200,7 @@ struct nxt_http_request_s {
     uint8_t                         app_target;
     nxt_http_protocol_t             protocol:8;   /* 2 bits */
     uint8_t                         tls;          /* 1 bit  */
+    uint8_t                         sendfile;     /* 1 bit  */
     uint8_t                         logged;       /* 1 bit  */
     uint8_t                         header_sent;  /* 1 bit  */
     uint8_t                         inconsistent; /* 1 bit  */
@@ -240,6 +244,8 @@ typedef struct {
     nxt_conf_value_t                *traverse_mounts;
     nxt_conf_value_t                *types;
     nxt_conf_value_t                *fallback;
+    nxt_conf_value_t                *priority;
+    nxt_conf_value_t                *affinity;
 } nxt_http_action_conf_t;
 
 
@@ -259,6 +265,8 @@ struct nxt_http_action_s {
     nxt_tstr_t                      *rewrite;
     nxt_array_t                     *set_headers;  /* of nxt_http_field_t */
     nxt_http_action_t               *fallback;
+    nxt_tstr_t                      *affinity;
+    uint8_t                         priority;      /* NXT_APP_QUEUE_* */
 };
 
 
@@ -325,6 +333,8 @@ void nxt_http_conn_init(nxt_task_t *task, void *obj, void *data);
 nxt_http_request_t *nxt_http_request_create(nxt_task_t *task);
 void nxt_http_request_error(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_status_t status);
+void nxt_http_request_error_retry(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_status_t status, nxt_uint_t retry_after);
 void nxt_http_request_read_body(nxt_task_t *task, nxt_http_request_t *r);
 void nxt_http_request_header_send(nxt_task_t *task, nxt_http_request_t *r,
     nxt_work_handler_t body_handler, void *data);
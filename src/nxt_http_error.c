@@ -28,7 +28,16 @@ void
 nxt_http_request_error(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_status_t status)
 {
-    nxt_http_field_t  *content_type;
+    nxt_http_request_error_retry(task, r, status, 0);
+}
+
+
+void
+nxt_http_request_error_retry(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_status_t status, nxt_uint_t retry_after)
+{
+    u_char            *p;
+    nxt_http_field_t  *content_type, *field;
 
     nxt_debug(task, "http request error: %d", status);
 
@@ -52,6 +61,23 @@ nxt_http_request_error(nxt_task_t *task, nxt_http_request_t *r,
 
     nxt_http_field_set(content_type, "Content-Type", "text/html");
 
+    if (retry_after != 0) {
+        field = nxt_list_zero_add(r->resp.fields);
+        if (nxt_slow_path(field == NULL)) {
+            goto fail;
+        }
+
+        p = nxt_mp_nget(r->mem_pool, NXT_INT_T_LEN);
+        if (nxt_slow_path(p == NULL)) {
+            goto fail;
+        }
+
+        nxt_http_field_name_set(field, "Retry-After");
+        field->value = p;
+        field->value_length = nxt_sprintf(p, p + NXT_INT_T_LEN, "%ui",
+                                          retry_after) - p;
+    }
+
     r->resp.content_length = NULL;
     r->resp.content_length_n = NXT_HTTP_ERROR_LEN;
 
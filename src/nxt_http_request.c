@@ -280,7 +280,7 @@ nxt_http_request_create(nxt_task_t *task)
 
     r->start_time = nxt_thread_monotonic_time(task->thread);
 
-    task->thread->engine->requests_cnt++;
+    task->thread->engine->counters->requests++;
 
     r->tstr_cache.var.pool = mp;
 
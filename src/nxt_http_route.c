@@ -9,6 +9,7 @@
 #include <nxt_sockaddr.h>
 #include <nxt_http_route_addr.h>
 #include <nxt_regex.h>
+#include <nxt_app_queue.h>
 
 
 typedef enum {
@@ -88,10 +89,57 @@ typedef struct {
 } nxt_http_cookie_t;
 
 
+typedef struct nxt_http_route_node_s  nxt_http_route_node_t;
+
+typedef struct {
+    u_char                         c;
+    nxt_http_route_node_t          *node;
+} nxt_http_route_edge_t;
+
+
+/*
+ * A trie node with an array of numbers of route steps or rule patterns.
+ * The failure and output links are used for substring search.
+ */
+
+struct nxt_http_route_node_s {
+    /* The edges are sorted by character. */
+    nxt_array_t                    *edges;
+    nxt_array_t                    *values;
+
+    nxt_http_route_node_t          *fail;
+    nxt_http_route_node_t          *output;
+};
+
+
+/*
+ * Positive patterns of a rule with many patterns are indexed by their
+ * first exact string: prefixes, suffixes, and substrings are kept in
+ * tries, so only the patterns that can match a string are tested.
+ */
+
+#define NXT_HTTP_ROUTE_PATTERN_INDEX  16
+
+
+typedef struct {
+    /* The patterns that are not indexed. */
+    nxt_array_t                    *patterns;
+
+    nxt_http_route_node_t          prefix;
+    nxt_http_route_node_t          suffix;
+    nxt_http_route_node_t          substring;
+
+    /* The number of negative patterns, they are sorted first. */
+    uint32_t                       negative;
+    uint8_t                        case_sensitive;  /* 1 bit */
+} nxt_http_route_pattern_index_t;
+
+
 struct nxt_http_route_rule_s {
     /* The object must be the first field. */
     nxt_http_route_object_t        object:8;
     uint32_t                       items;
+    nxt_http_route_pattern_index_t  *index;
 
     union {
         uintptr_t                  offset;
@@ -125,6 +173,7 @@ struct nxt_http_route_addr_rule_s {
     /* The object must be the first field. */
     nxt_http_route_object_t        object:8;
     uint32_t                       items;
+    nxt_http_route_addr_tree_t     *tree;
     nxt_http_route_addr_pattern_t  addr_pattern[0];
 };
 
@@ -143,8 +192,72 @@ typedef struct {
 } nxt_http_route_match_t;
 
 
+/*
+ * Steps of a route with many steps are indexed by exact "host" values,
+ * "host" suffixes such as "*.example.com", and "uri" prefixes, so a request
+ * is tested only against the steps that can match it.  The steps are still
+ * tested in the route order.
+ */
+
+#define NXT_HTTP_ROUTE_INDEX_STEPS  8
+
+
+typedef struct {
+    nxt_str_t                      name;
+    nxt_array_t                    *steps;
+} nxt_http_route_host_t;
+
+
+typedef struct {
+    /* The steps that are not indexed. */
+    nxt_array_t                    *steps;
+
+    nxt_lvlhsh_t                   hosts;
+
+    /* The trie of reversed host suffixes. */
+    nxt_http_route_node_t          host_suffix;
+
+    nxt_http_route_node_t          uri;
+} nxt_http_route_index_t;
+
+
+/*
+ * Results of matching routes with many steps that test only "host",
+ * "method", and "uri" are cached per engine.  The cache is set associative
+ * with the least recently used entry replaced in a set.  The entries are
+ * bound to a route by its unique number, so they are never used after
+ * the configuration has been changed.
+ */
+
+#define NXT_HTTP_ROUTE_CACHE_SETS     64
+#define NXT_HTTP_ROUTE_CACHE_WAYS     4
+#define NXT_HTTP_ROUTE_CACHE_KEY_LEN  96
+
+
+typedef struct {
+    uint64_t                       route;
+    nxt_http_action_t              *action;
+    uint32_t                       hash;
+    uint16_t                       host_length;
+    uint8_t                        method_length;
+    uint8_t                        length;
+    u_char                         key[NXT_HTTP_ROUTE_CACHE_KEY_LEN];
+} nxt_http_route_cache_entry_t;
+
+
+typedef struct {
+    nxt_http_route_cache_entry_t   entry[NXT_HTTP_ROUTE_CACHE_SETS
+                                         * NXT_HTTP_ROUTE_CACHE_WAYS];
+} nxt_http_route_cache_t;
+
+
 struct nxt_http_route_s {
     nxt_str_t                      name;
+    nxt_http_route_index_t         *index;
+
+    /* A unique number of a cached route, or 0. */
+    uint64_t                       cache;
+
     uint32_t                       items;
     nxt_http_route_match_t         *match[0];
 };
@@ -160,6 +273,27 @@ static nxt_http_route_t *nxt_http_route_create(nxt_task_t *task,
     nxt_router_temp_conf_t *tmcf, nxt_conf_value_t *cv);
 static nxt_http_route_match_t *nxt_http_route_match_create(nxt_task_t *task,
     nxt_router_temp_conf_t *tmcf, nxt_conf_value_t *cv);
+static nxt_int_t nxt_http_route_index_create(nxt_mp_t *mp,
+    nxt_http_route_t *route);
+static uint64_t nxt_http_route_cache_create(nxt_http_route_t *route);
+static nxt_http_route_rule_t *nxt_http_route_index_rule(
+    nxt_http_route_match_t *match, nxt_http_route_object_t object,
+    uintptr_t offset, nxt_http_route_pattern_type_t type);
+static nxt_http_route_pattern_slice_t *nxt_http_route_index_slice(
+    nxt_http_route_pattern_t *pattern, nxt_http_route_pattern_type_t type);
+static nxt_int_t nxt_http_route_index_host(nxt_mp_t *mp,
+    nxt_http_route_index_t *index, nxt_str_t *name, uint32_t step);
+static nxt_int_t nxt_http_route_host_test(nxt_lvlhsh_query_t *lhq, void *data);
+static nxt_int_t nxt_http_route_index_trie(nxt_mp_t *mp,
+    nxt_http_route_node_t *node, nxt_str_t *str, nxt_bool_t reverse,
+    uint32_t step);
+static nxt_http_route_node_t *nxt_http_route_node_add(nxt_mp_t *mp,
+    nxt_http_route_node_t *node, u_char c);
+static nxt_int_t nxt_http_route_value_add(nxt_mp_t *mp, nxt_array_t **values,
+    uint32_t value);
+static nxt_int_t nxt_http_route_index_merge(nxt_mp_t *mp,
+    nxt_http_route_node_t *node, nxt_array_t *parent);
+static nxt_uint_t nxt_http_action_priority(nxt_conf_value_t *cv);
 static nxt_http_route_table_t *nxt_http_route_table_create(nxt_task_t *task,
     nxt_mp_t *mp, nxt_conf_value_t *table_cv, nxt_http_route_object_t object,
     nxt_bool_t case_sensitive, nxt_http_uri_encoding_t encoding);
@@ -173,6 +307,13 @@ static nxt_http_route_rule_t *nxt_http_route_rule_create(nxt_task_t *task,
     nxt_mp_t *mp, nxt_conf_value_t *cv, nxt_bool_t case_sensitive,
     nxt_http_route_pattern_case_t pattern_case,
     nxt_http_uri_encoding_t encoding);
+static nxt_int_t nxt_http_route_pattern_index_create(nxt_mp_t *mp,
+    nxt_http_route_rule_t *rule);
+static nxt_int_t nxt_http_route_pattern_index_add(nxt_mp_t *mp,
+    nxt_http_route_node_t *node, nxt_http_route_pattern_slice_t *slice,
+    nxt_bool_t reverse, nxt_bool_t case_sensitive, uint32_t n);
+static nxt_int_t nxt_http_route_substring_links(nxt_mp_t *mp,
+    nxt_http_route_node_t *root);
 static int nxt_http_pattern_compare(const void *one, const void *two);
 static int nxt_http_addr_pattern_compare(const void *one, const void *two);
 static nxt_int_t nxt_http_route_pattern_create(nxt_task_t *task, nxt_mp_t *mp,
@@ -202,6 +343,14 @@ static nxt_int_t nxt_http_route_find(nxt_http_routes_t *routes, nxt_str_t *name,
 
 static nxt_http_action_t *nxt_http_route_handler(nxt_task_t *task,
     nxt_http_request_t *r, nxt_http_action_t *start);
+static nxt_http_action_t *nxt_http_route_steps(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_route_t *route);
+static nxt_http_action_t *nxt_http_route_cache_handler(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_route_t *route);
+static nxt_http_action_t *nxt_http_route_index_handler(nxt_task_t *task,
+    nxt_http_request_t *r, nxt_http_route_t *route);
+static nxt_http_route_node_t *nxt_http_route_node_find(
+    nxt_http_route_node_t *node, u_char c, nxt_uint_t *pos);
 static nxt_http_action_t *nxt_http_route_match(nxt_task_t *task,
     nxt_http_request_t *r, nxt_http_route_match_t *match);
 static nxt_int_t nxt_http_route_table(nxt_http_request_t *r,
@@ -224,6 +373,11 @@ static nxt_int_t nxt_http_route_cookies(nxt_http_request_t *r,
     nxt_http_route_rule_t *rule);
 static nxt_int_t nxt_http_route_test_cookie(nxt_http_request_t *r,
     nxt_http_route_rule_t *rule, nxt_array_t *array);
+static nxt_int_t nxt_http_route_test_rule_index(nxt_http_request_t *r,
+    nxt_http_route_rule_t *rule, u_char *start, size_t length);
+static nxt_int_t nxt_http_route_test_patterns(nxt_http_request_t *r,
+    nxt_http_route_rule_t *rule, nxt_array_t *values, u_char *start,
+    size_t length);
 static nxt_int_t nxt_http_route_pattern(nxt_http_request_t *r,
     nxt_http_route_pattern_t *pattern, u_char *start, size_t length);
 static nxt_int_t nxt_http_route_memcmp(u_char *start, u_char *test,
@@ -385,10 +539,451 @@ nxt_http_route_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
         *m++ = match;
     }
 
+    if (nxt_slow_path(nxt_http_route_index_create(tmcf->router_conf->mem_pool,
+                                                  route)
+                      != NXT_OK))
+    {
+        return NULL;
+    }
+
+    route->cache = nxt_http_route_cache_create(route);
+
     return route;
 }
 
 
+/*
+ * A route is cached if its steps test only the request line and
+ * the "Host" header.  Routes are created in the router main thread.
+ */
+
+static uint64_t
+nxt_http_route_cache_create(nxt_http_route_t *route)
+{
+    uint32_t                i, j;
+    nxt_http_route_rule_t   *rule;
+    nxt_http_route_match_t  *match;
+
+    static uint64_t  routes;
+
+    if (route->items < NXT_HTTP_ROUTE_INDEX_STEPS) {
+        return 0;
+    }
+
+    for (i = 0; i < route->items; i++) {
+        match = route->match[i];
+
+        for (j = 0; j < match->items; j++) {
+            rule = match->test[j].rule;
+
+            if (rule->object != NXT_HTTP_ROUTE_STRING
+                && rule->object != NXT_HTTP_ROUTE_STRING_PTR)
+            {
+                return 0;
+            }
+        }
+    }
+
+    return ++routes;
+}
+
+
+static nxt_int_t
+nxt_http_route_index_create(nxt_mp_t *mp, nxt_http_route_t *route)
+{
+    uint32_t                        i, j;
+    nxt_int_t                       ret;
+    nxt_str_t                       str;
+    nxt_bool_t                      indexed;
+    nxt_http_route_rule_t           *rule;
+    nxt_http_route_index_t          *index;
+    nxt_http_route_pattern_t        *pattern;
+    nxt_http_route_pattern_slice_t  *slice;
+
+    route->index = NULL;
+
+    if (route->items < NXT_HTTP_ROUTE_INDEX_STEPS) {
+        return NXT_OK;
+    }
+
+    index = nxt_mp_zget(mp, sizeof(nxt_http_route_index_t));
+    if (nxt_slow_path(index == NULL)) {
+        return NXT_ERROR;
+    }
+
+    indexed = 0;
+
+    for (i = 0; i < route->items; i++) {
+
+        rule = nxt_http_route_index_rule(route->match[i], NXT_HTTP_ROUTE_STRING,
+                                         offsetof(nxt_http_request_t, host),
+                                         NXT_HTTP_ROUTE_PATTERN_END);
+
+        if (rule == NULL) {
+            rule = nxt_http_route_index_rule(route->match[i],
+                                             NXT_HTTP_ROUTE_STRING_PTR,
+                                             offsetof(nxt_http_request_t, path),
+                                             NXT_HTTP_ROUTE_PATTERN_BEGIN);
+        }
+
+        if (rule == NULL) {
+            ret = nxt_http_route_value_add(mp, &index->steps, i);
+            if (nxt_slow_path(ret != NXT_OK)) {
+                return NXT_ERROR;
+            }
+
+            continue;
+        }
+
+        indexed = 1;
+
+        for (j = 0; j < rule->items; j++) {
+            pattern = &rule->pattern[j];
+            slice = pattern->u.pattern_slices->elts;
+
+            if (rule->object == NXT_HTTP_ROUTE_STRING
+                && slice->type != NXT_HTTP_ROUTE_PATTERN_EXACT)
+            {
+                slice = nxt_http_route_index_slice(pattern,
+                                                   NXT_HTTP_ROUTE_PATTERN_END);
+            }
+
+            str.length = slice->length;
+            str.start = slice->start;
+
+            if (rule->object != NXT_HTTP_ROUTE_STRING) {
+                ret = nxt_http_route_index_trie(mp, &index->uri, &str, 0, i);
+
+            } else if (slice->type == NXT_HTTP_ROUTE_PATTERN_EXACT) {
+                ret = nxt_http_route_index_host(mp, index, &str, i);
+
+            } else {
+                ret = nxt_http_route_index_trie(mp, &index->host_suffix, &str,
+                                                1, i);
+            }
+
+            if (nxt_slow_path(ret != NXT_OK)) {
+                return NXT_ERROR;
+            }
+        }
+    }
+
+    if (!indexed) {
+        return NXT_OK;
+    }
+
+    ret = nxt_http_route_index_merge(mp, &index->host_suffix, NULL);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    ret = nxt_http_route_index_merge(mp, &index->uri, NULL);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    route->index = index;
+
+    return NXT_OK;
+}
+
+
+/*
+ * A step can be indexed by a rule if every pattern of the rule is
+ * an exact string or, for prefixes, starts with an exact string, or,
+ * for suffixes, ends with an exact string.
+ */
+
+static nxt_http_route_rule_t *
+nxt_http_route_index_rule(nxt_http_route_match_t *match,
+    nxt_http_route_object_t object, uintptr_t offset,
+    nxt_http_route_pattern_type_t type)
+{
+    uint32_t                        i, j;
+    nxt_http_route_rule_t           *rule;
+    nxt_http_route_pattern_t        *pattern;
+    nxt_http_route_pattern_slice_t  *slice;
+
+    for (i = 0; i < match->items; i++) {
+        rule = match->test[i].rule;
+
+        if (rule->object != object || rule->u.offset != offset) {
+            continue;
+        }
+
+        if (rule->items == 0) {
+            return NULL;
+        }
+
+        for (j = 0; j < rule->items; j++) {
+            pattern = &rule->pattern[j];
+
+#if (NXT_HAVE_REGEX)
+            if (pattern->regex) {
+                return NULL;
+            }
+#endif
+
+            if (pattern->negative || pattern->u.pattern_slices->nelts == 0) {
+                return NULL;
+            }
+
+            slice = pattern->u.pattern_slices->elts;
+
+            if (slice->type != NXT_HTTP_ROUTE_PATTERN_EXACT
+                && nxt_http_route_index_slice(pattern, type) == NULL)
+            {
+                return NULL;
+            }
+        }
+
+        return rule;
+    }
+
+    return NULL;
+}
+
+
+/*
+ * The slices of a pattern are ordered as the beginning, the end,
+ * and the substrings.
+ */
+
+static nxt_http_route_pattern_slice_t *
+nxt_http_route_index_slice(nxt_http_route_pattern_t *pattern,
+    nxt_http_route_pattern_type_t type)
+{
+    nxt_uint_t                      n;
+    nxt_http_route_pattern_slice_t  *slice;
+
+    slice = pattern->u.pattern_slices->elts;
+    n = pattern->u.pattern_slices->nelts;
+
+    if (type == NXT_HTTP_ROUTE_PATTERN_END
+        && n > 1 && slice[0].type == NXT_HTTP_ROUTE_PATTERN_BEGIN)
+    {
+        slice++;
+    }
+
+    return (slice->type == type) ? slice : NULL;
+}
+
+
+static const nxt_lvlhsh_proto_t  nxt_http_route_host_hash_proto
+    nxt_aligned(64) =
+{
+    NXT_LVLHSH_DEFAULT,
+    nxt_http_route_host_test,
+    nxt_mp_lvlhsh_alloc,
+    nxt_mp_lvlhsh_free,
+};
+
+
+static nxt_int_t
+nxt_http_route_index_host(nxt_mp_t *mp, nxt_http_route_index_t *index,
+    nxt_str_t *name, uint32_t step)
+{
+    nxt_int_t              ret;
+    nxt_lvlhsh_query_t     lhq;
+    nxt_http_route_host_t  *host;
+
+    lhq.key_hash = nxt_djb_hash(name->start, name->length);
+    lhq.key = *name;
+    lhq.proto = &nxt_http_route_host_hash_proto;
+    lhq.pool = mp;
+
+    ret = nxt_lvlhsh_find(&index->hosts, &lhq);
+
+    if (ret == NXT_OK) {
+        host = lhq.value;
+
+    } else {
+        host = nxt_mp_zget(mp, sizeof(nxt_http_route_host_t));
+        if (nxt_slow_path(host == NULL)) {
+            return NXT_ERROR;
+        }
+
+        host->name = *name;
+
+        lhq.replace = 0;
+        lhq.value = host;
+
+        ret = nxt_lvlhsh_insert(&index->hosts, &lhq);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+    }
+
+    return nxt_http_route_value_add(mp, &host->steps, step);
+}
+
+
+static nxt_int_t
+nxt_http_route_host_test(nxt_lvlhsh_query_t *lhq, void *data)
+{
+    nxt_http_route_host_t  *host;
+
+    host = data;
+
+    return nxt_strstr_eq(&lhq->key, &host->name) ? NXT_OK : NXT_DECLINED;
+}
+
+
+static nxt_int_t
+nxt_http_route_index_trie(nxt_mp_t *mp, nxt_http_route_node_t *node,
+    nxt_str_t *str, nxt_bool_t reverse, uint32_t step)
+{
+    size_t  i;
+
+    for (i = 0; i < str->length; i++) {
+        node = nxt_http_route_node_add(mp, node,
+                                       reverse ? str->start[str->length - 1 - i]
+                                               : str->start[i]);
+        if (nxt_slow_path(node == NULL)) {
+            return NXT_ERROR;
+        }
+    }
+
+    return nxt_http_route_value_add(mp, &node->values, step);
+}
+
+
+static nxt_http_route_node_t *
+nxt_http_route_node_add(nxt_mp_t *mp, nxt_http_route_node_t *node, u_char c)
+{
+    nxt_uint_t             pos;
+    nxt_http_route_edge_t  *edge;
+    nxt_http_route_node_t  *next;
+
+    next = nxt_http_route_node_find(node, c, &pos);
+    if (next != NULL) {
+        return next;
+    }
+
+    if (node->edges == NULL) {
+        node->edges = nxt_array_create(mp, 1, sizeof(nxt_http_route_edge_t));
+        if (nxt_slow_path(node->edges == NULL)) {
+            return NULL;
+        }
+    }
+
+    next = nxt_mp_zget(mp, sizeof(nxt_http_route_node_t));
+    if (nxt_slow_path(next == NULL)) {
+        return NULL;
+    }
+
+    if (nxt_slow_path(nxt_array_add(node->edges) == NULL)) {
+        return NULL;
+    }
+
+    edge = node->edges->elts;
+
+    nxt_memmove(&edge[pos + 1], &edge[pos],
+                (node->edges->nelts - 1 - pos) * sizeof(nxt_http_route_edge_t));
+
+    edge[pos].c = c;
+    edge[pos].node = next;
+
+    return next;
+}
+
+
+static nxt_int_t
+nxt_http_route_value_add(nxt_mp_t *mp, nxt_array_t **values, uint32_t value)
+{
+    uint32_t  *p;
+
+    if (*values == NULL) {
+        *values = nxt_array_create(mp, 4, sizeof(uint32_t));
+        if (nxt_slow_path(*values == NULL)) {
+            return NXT_ERROR;
+        }
+    }
+
+    /* Values are added in ascending order, so an array is sorted. */
+
+    p = (*values)->elts;
+
+    if ((*values)->nelts != 0 && p[(*values)->nelts - 1] == value) {
+        return NXT_OK;
+    }
+
+    p = nxt_array_add(*values);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    *p = value;
+
+    return NXT_OK;
+}
+
+
+/*
+ * A request URI can match all prefixes on the path to the deepest node
+ * found, so the node step lists are merged with the lists of ancestors.
+ */
+
+static nxt_int_t
+nxt_http_route_index_merge(nxt_mp_t *mp, nxt_http_route_node_t *node,
+    nxt_array_t *parent)
+{
+    uint32_t               *a, *b, *p, *a_end, *b_end;
+    nxt_int_t              ret;
+    nxt_uint_t             i;
+    nxt_array_t            *steps;
+    nxt_http_route_edge_t  *edge;
+
+    if (node->values == NULL) {
+        node->values = parent;
+
+    } else if (parent != NULL) {
+        steps = nxt_array_create(mp, parent->nelts + node->values->nelts,
+                                 sizeof(uint32_t));
+        if (nxt_slow_path(steps == NULL)) {
+            return NXT_ERROR;
+        }
+
+        a = parent->elts;
+        a_end = a + parent->nelts;
+        b = node->values->elts;
+        b_end = b + node->values->nelts;
+        p = steps->elts;
+
+        while (a < a_end || b < b_end) {
+            if (b == b_end || (a < a_end && *a < *b)) {
+                *p++ = *a++;
+
+            } else if (a == a_end || *b < *a) {
+                *p++ = *b++;
+
+            } else {
+                *p++ = *a++;
+                b++;
+            }
+        }
+
+        steps->nelts = p - (uint32_t *) steps->elts;
+        node->values = steps;
+    }
+
+    if (node->edges == NULL) {
+        return NXT_OK;
+    }
+
+    edge = node->edges->elts;
+
+    for (i = 0; i < node->edges->nelts; i++) {
+        ret = nxt_http_route_index_merge(mp, edge[i].node, node->values);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+    }
+
+    return NXT_OK;
+}
+
+
 static nxt_http_route_match_t *
 nxt_http_route_match_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     nxt_conf_value_t *cv)
@@ -643,16 +1238,45 @@ static nxt_conf_map_t  nxt_http_route_action_conf[] = {
         NXT_CONF_MAP_PTR,
         offsetof(nxt_http_action_conf_t, fallback)
     },
+    {
+        nxt_string("priority"),
+        NXT_CONF_MAP_PTR,
+        offsetof(nxt_http_action_conf_t, priority)
+    },
+    {
+        nxt_string("affinity"),
+        NXT_CONF_MAP_PTR,
+        offsetof(nxt_http_action_conf_t, affinity)
+    },
 };
 
 
+static nxt_uint_t
+nxt_http_action_priority(nxt_conf_value_t *cv)
+{
+    nxt_str_t  priority;
+
+    nxt_conf_get_string(cv, &priority);
+
+    if (nxt_str_eq(&priority, "high", 4)) {
+        return NXT_APP_QUEUE_HIGH;
+    }
+
+    if (nxt_str_eq(&priority, "low", 3)) {
+        return NXT_APP_QUEUE_LOW;
+    }
+
+    return NXT_APP_QUEUE_NORMAL;
+}
+
+
 nxt_int_t
 nxt_http_action_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     nxt_conf_value_t *cv, nxt_http_action_t *action)
 {
     nxt_mp_t                *mp;
     nxt_int_t               ret;
-    nxt_str_t               pass;
+    nxt_str_t               pass, affinity;
     nxt_router_conf_t       *rtcf;
     nxt_http_action_conf_t  acf;
 
@@ -695,6 +1319,19 @@ nxt_http_action_init(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
         return nxt_http_proxy_init(mp, action, &acf);
     }
 
+    if (acf.priority != NULL) {
+        action->priority = nxt_http_action_priority(acf.priority);
+    }
+
+    if (acf.affinity != NULL) {
+        nxt_conf_get_string(acf.affinity, &affinity);
+
+        action->affinity = nxt_tstr_compile(rtcf->tstr_state, &affinity, 0);
+        if (nxt_slow_path(action->affinity == NULL)) {
+            return NXT_ERROR;
+        }
+    }
+
     nxt_conf_get_string(acf.pass, &pass);
 
     action->u.tstr = nxt_tstr_compile(rtcf->tstr_state, &pass, 0);
@@ -821,45 +1458,248 @@ nxt_http_route_rule_name_create(nxt_task_t *task, nxt_mp_t *mp,
 }
 
 
-static nxt_http_route_rule_t *
-nxt_http_route_rule_create(nxt_task_t *task, nxt_mp_t *mp,
-    nxt_conf_value_t *cv, nxt_bool_t case_sensitive,
-    nxt_http_route_pattern_case_t pattern_case,
-    nxt_http_uri_encoding_t encoding)
-{
-    size_t                    size;
-    uint32_t                  i, n;
-    nxt_int_t                 ret;
-    nxt_conf_value_t          *value;
-    nxt_http_route_rule_t     *rule;
-    nxt_http_route_pattern_t  *pattern;
+static nxt_http_route_rule_t *
+nxt_http_route_rule_create(nxt_task_t *task, nxt_mp_t *mp,
+    nxt_conf_value_t *cv, nxt_bool_t case_sensitive,
+    nxt_http_route_pattern_case_t pattern_case,
+    nxt_http_uri_encoding_t encoding)
+{
+    size_t                    size;
+    uint32_t                  i, n;
+    nxt_int_t                 ret;
+    nxt_conf_value_t          *value;
+    nxt_http_route_rule_t     *rule;
+    nxt_http_route_pattern_t  *pattern;
+
+    n = nxt_conf_array_elements_count_or_1(cv);
+    size = sizeof(nxt_http_route_rule_t) + n * sizeof(nxt_http_route_pattern_t);
+
+    rule = nxt_mp_alloc(mp, size);
+    if (nxt_slow_path(rule == NULL)) {
+        return NULL;
+    }
+
+    rule->items = n;
+
+    pattern = &rule->pattern[0];
+
+    nxt_conf_array_qsort(cv, nxt_http_pattern_compare);
+
+    for (i = 0; i < n; i++) {
+        pattern[i].case_sensitive = case_sensitive;
+        value = nxt_conf_get_array_element_or_itself(cv, i);
+
+        ret = nxt_http_route_pattern_create(task, mp, value, &pattern[i],
+                                            pattern_case, encoding);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NULL;
+        }
+    }
+
+    ret = nxt_http_route_pattern_index_create(mp, rule);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NULL;
+    }
+
+    return rule;
+}
+
+
+static nxt_int_t
+nxt_http_route_pattern_index_create(nxt_mp_t *mp, nxt_http_route_rule_t *rule)
+{
+    uint32_t                        i, j;
+    nxt_int_t                       ret;
+    nxt_bool_t                      reverse;
+    nxt_array_t                     *slices;
+    nxt_http_route_node_t           *root;
+    nxt_http_route_pattern_t        *pattern;
+    nxt_http_route_pattern_slice_t  *slice, *key;
+    nxt_http_route_pattern_index_t  *index;
+
+    rule->index = NULL;
+
+    if (rule->items < NXT_HTTP_ROUTE_PATTERN_INDEX) {
+        return NXT_OK;
+    }
+
+    index = nxt_mp_zget(mp, sizeof(nxt_http_route_pattern_index_t));
+    if (nxt_slow_path(index == NULL)) {
+        return NXT_ERROR;
+    }
+
+    index->case_sensitive = rule->pattern[0].case_sensitive;
+
+    for (i = 0; i < rule->items; i++) {
+        pattern = &rule->pattern[i];
+
+        if (pattern->negative) {
+            index->negative = i + 1;
+            continue;
+        }
+
+#if (NXT_HAVE_REGEX)
+        if (pattern->regex) {
+            ret = nxt_http_route_value_add(mp, &index->patterns, i);
+            if (nxt_slow_path(ret != NXT_OK)) {
+                return NXT_ERROR;
+            }
+
+            continue;
+        }
+#endif
+
+        slices = pattern->u.pattern_slices;
+
+        if (slices->nelts == 0) {
+            ret = nxt_http_route_value_add(mp, &index->patterns, i);
+            if (nxt_slow_path(ret != NXT_OK)) {
+                return NXT_ERROR;
+            }
+
+            continue;
+        }
+
+        slice = slices->elts;
+        key = slice;
+        reverse = 0;
+
+        switch (slice->type) {
+
+        case NXT_HTTP_ROUTE_PATTERN_EXACT:
+        case NXT_HTTP_ROUTE_PATTERN_BEGIN:
+            root = &index->prefix;
+            break;
+
+        case NXT_HTTP_ROUTE_PATTERN_END:
+            root = &index->suffix;
+            reverse = 1;
+            break;
+
+        default:
+            /* NXT_HTTP_ROUTE_PATTERN_SUBSTRING, the longest one is used. */
+
+            for (j = 1; j < slices->nelts; j++) {
+                if (slice[j].length > key->length) {
+                    key = &slice[j];
+                }
+            }
+
+            root = &index->substring;
+            break;
+        }
+
+        ret = nxt_http_route_pattern_index_add(mp, root, key, reverse,
+                                               index->case_sensitive, i);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+    }
+
+    ret = nxt_http_route_substring_links(mp, &index->substring);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    rule->index = index;
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_http_route_pattern_index_add(nxt_mp_t *mp, nxt_http_route_node_t *node,
+    nxt_http_route_pattern_slice_t *slice, nxt_bool_t reverse,
+    nxt_bool_t case_sensitive, uint32_t n)
+{
+    u_char      c;
+    nxt_uint_t  i;
+
+    for (i = 0; i < slice->length; i++) {
+        c = slice->start[reverse ? slice->length - 1 - i : i];
+
+        if (!case_sensitive) {
+            c = nxt_lowcase(c);
+        }
+
+        node = nxt_http_route_node_add(mp, node, c);
+        if (nxt_slow_path(node == NULL)) {
+            return NXT_ERROR;
+        }
+    }
+
+    return nxt_http_route_value_add(mp, &node->values, n);
+}
+
+
+/*
+ * The Aho-Corasick failure links point to the node of the longest
+ * proper suffix of a node string, and the output links point to the
+ * nearest node with values along the failure links.
+ */
+
+static nxt_int_t
+nxt_http_route_substring_links(nxt_mp_t *mp, nxt_http_route_node_t *root)
+{
+    nxt_uint_t             i, k, pos;
+    nxt_array_t            *queue;
+    nxt_http_route_edge_t  *edge;
+    nxt_http_route_node_t  *node, *next, *fail, **p;
+
+    if (root->edges == NULL) {
+        return NXT_OK;
+    }
+
+    queue = nxt_array_create(mp, 16, sizeof(nxt_http_route_node_t *));
+    if (nxt_slow_path(queue == NULL)) {
+        return NXT_ERROR;
+    }
+
+    p = nxt_array_add(queue);
+    if (nxt_slow_path(p == NULL)) {
+        return NXT_ERROR;
+    }
+
+    *p = root;
+
+    for (k = 0; k < queue->nelts; k++) {
+        node = ((nxt_http_route_node_t **) queue->elts)[k];
+
+        if (node->edges == NULL) {
+            continue;
+        }
+
+        edge = node->edges->elts;
 
-    n = nxt_conf_array_elements_count_or_1(cv);
-    size = sizeof(nxt_http_route_rule_t) + n * sizeof(nxt_http_route_pattern_t);
+        for (i = 0; i < node->edges->nelts; i++) {
+            next = edge[i].node;
+            next->fail = root;
 
-    rule = nxt_mp_alloc(mp, size);
-    if (nxt_slow_path(rule == NULL)) {
-        return NULL;
-    }
+            for (fail = node->fail; fail != NULL; fail = fail->fail) {
+                next->fail = nxt_http_route_node_find(fail, edge[i].c, &pos);
 
-    rule->items = n;
+                if (next->fail != NULL) {
+                    break;
+                }
 
-    pattern = &rule->pattern[0];
+                next->fail = root;
+            }
 
-    nxt_conf_array_qsort(cv, nxt_http_pattern_compare);
+            next->output = (next->fail->values != NULL) ? next->fail
+                                                        : next->fail->output;
 
-    for (i = 0; i < n; i++) {
-        pattern[i].case_sensitive = case_sensitive;
-        value = nxt_conf_get_array_element_or_itself(cv, i);
+            p = nxt_array_add(queue);
+            if (nxt_slow_path(p == NULL)) {
+                return NXT_ERROR;
+            }
 
-        ret = nxt_http_route_pattern_create(task, mp, value, &pattern[i],
-                                            pattern_case, encoding);
-        if (nxt_slow_path(ret != NXT_OK)) {
-            return NULL;
+            *p = next;
         }
     }
 
-    return rule;
+    nxt_array_destroy(queue);
+
+    return NXT_OK;
 }
 
 
@@ -900,6 +1740,16 @@ nxt_http_route_addr_rule_create(nxt_task_t *task, nxt_mp_t *mp,
             nxt_http_addr_pattern_compare);
     }
 
+    addr_rule->tree = NULL;
+
+    if (n >= NXT_HTTP_ROUTE_ADDR_TREE_PATTERNS) {
+        addr_rule->tree = nxt_http_route_addr_tree_create(mp,
+                                                  addr_rule->addr_pattern, n);
+        if (nxt_slow_path(addr_rule->tree == NULL)) {
+            return NULL;
+        }
+    }
+
     return addr_rule;
 }
 
@@ -1564,12 +2414,46 @@ static nxt_http_action_t *
 nxt_http_route_handler(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_action_t *start)
 {
-    size_t                  i;
-    nxt_http_route_t        *route;
-    nxt_http_action_t       *action;
+    nxt_http_route_t   *route;
+    nxt_http_action_t  *action;
 
     route = start->u.route;
 
+    /* The cache and the index are not used to log every step tested. */
+
+    if (nxt_slow_path(r->log_route)) {
+        action = nxt_http_route_steps(task, r, route);
+
+    } else if (route->cache != 0) {
+        action = nxt_http_route_cache_handler(task, r, route);
+
+    } else if (route->index != NULL) {
+        action = nxt_http_route_index_handler(task, r, route);
+
+    } else {
+        action = nxt_http_route_steps(task, r, route);
+    }
+
+    if (action == NULL) {
+        nxt_http_request_error(task, r, NXT_HTTP_NOT_FOUND);
+        return NULL;
+    }
+
+    if (action != NXT_HTTP_ACTION_ERROR) {
+        r->action = action;
+    }
+
+    return action;
+}
+
+
+static nxt_http_action_t *
+nxt_http_route_steps(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_route_t *route)
+{
+    size_t             i;
+    nxt_http_action_t  *action;
+
     for (i = 0; i < route->items; i++) {
         action = nxt_http_route_match(task, r, route->match[i]);
 
@@ -1585,16 +2469,254 @@ nxt_http_route_handler(nxt_task_t *task, nxt_http_request_t *r,
         }
 
         if (action != NULL) {
+            return action;
+        }
+    }
+
+    return NULL;
+}
+
+
+static nxt_http_action_t *
+nxt_http_route_cache_handler(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_route_t *route)
+{
+    u_char                        *p, key[NXT_HTTP_ROUTE_CACHE_KEY_LEN];
+    size_t                        length;
+    uint32_t                      hash;
+    nxt_uint_t                    i;
+    nxt_http_action_t             *action;
+    nxt_event_engine_t            *engine;
+    nxt_http_route_cache_t        *cache;
+    nxt_http_route_cache_entry_t  *set, *entry, tmp;
+
+    if (r->method == NULL || r->path == NULL) {
+        goto uncached;
+    }
+
+    length = r->method->length + r->host.length + r->path->length;
+
+    if (length > NXT_HTTP_ROUTE_CACHE_KEY_LEN) {
+        goto uncached;
+    }
+
+    engine = task->thread->engine;
+    cache = engine->route_cache;
+
+    if (nxt_slow_path(cache == NULL)) {
+        cache = nxt_mp_zget(engine->mem_pool, sizeof(nxt_http_route_cache_t));
+        if (nxt_slow_path(cache == NULL)) {
+            goto uncached;
+        }
+
+        engine->route_cache = cache;
+    }
+
+    p = nxt_cpymem(key, r->method->start, r->method->length);
+    p = nxt_cpymem(p, r->host.start, r->host.length);
+    nxt_memcpy(p, r->path->start, r->path->length);
+
+    hash = nxt_murmur_hash2(key, length) ^ (uint32_t) route->cache;
+
+    set = &cache->entry[(hash % NXT_HTTP_ROUTE_CACHE_SETS)
+                        * NXT_HTTP_ROUTE_CACHE_WAYS];
+
+    for (i = 0; i < NXT_HTTP_ROUTE_CACHE_WAYS; i++) {
+        entry = &set[i];
+
+        if (entry->route == route->cache
+            && entry->hash == hash
+            && entry->length == length
+            && entry->method_length == r->method->length
+            && entry->host_length == r->host.length
+            && memcmp(entry->key, key, length) == 0)
+        {
+            action = entry->action;
+
+            if (i != 0) {
+                tmp = *entry;
+                nxt_memmove(&set[1], &set[0],
+                            i * sizeof(nxt_http_route_cache_entry_t));
+                set[0] = tmp;
+            }
+
+            return action;
+        }
+    }
+
+    action = (route->index != NULL)
+             ? nxt_http_route_index_handler(task, r, route)
+             : nxt_http_route_steps(task, r, route);
+
+    if (action != NXT_HTTP_ACTION_ERROR) {
+        /* The least recently used entry is replaced. */
+
+        nxt_memmove(&set[1], &set[0], (NXT_HTTP_ROUTE_CACHE_WAYS - 1)
+                                      * sizeof(nxt_http_route_cache_entry_t));
+
+        entry = &set[0];
+
+        entry->route = route->cache;
+        entry->action = action;
+        entry->hash = hash;
+        entry->host_length = r->host.length;
+        entry->method_length = r->method->length;
+        entry->length = length;
+        nxt_memcpy(entry->key, key, length);
+    }
+
+    return action;
+
+uncached:
+
+    return (route->index != NULL) ? nxt_http_route_index_handler(task, r, route)
+                                  : nxt_http_route_steps(task, r, route);
+}
+
+
+static nxt_http_action_t *
+nxt_http_route_index_handler(nxt_task_t *task, nxt_http_request_t *r,
+    nxt_http_route_t *route)
+{
+    u_char                  *p, *end;
+    uint32_t                i, *step[4], *last[4];
+    nxt_int_t               ret;
+    nxt_uint_t              k, pos;
+    nxt_array_t             *steps[4];
+    nxt_lvlhsh_query_t      lhq;
+    nxt_http_action_t       *action;
+    nxt_http_route_host_t   *host;
+    nxt_http_route_node_t   *node;
+    nxt_http_route_index_t  *index;
+
+    index = route->index;
+
+    steps[0] = index->steps;
+
+    lhq.key_hash = nxt_djb_hash(r->host.start, r->host.length);
+    lhq.key = r->host;
+    lhq.proto = &nxt_http_route_host_hash_proto;
+
+    ret = nxt_lvlhsh_find(&index->hosts, &lhq);
+
+    if (ret == NXT_OK) {
+        host = lhq.value;
+        steps[1] = host->steps;
+
+    } else {
+        steps[1] = NULL;
+    }
+
+    node = &index->host_suffix;
+    steps[2] = node->values;
 
-            if (action != NXT_HTTP_ACTION_ERROR) {
-                r->action = action;
+    p = r->host.start + r->host.length;
+
+    while (p > r->host.start) {
+        p--;
+
+        node = nxt_http_route_node_find(node, *p, &pos);
+        if (node == NULL) {
+            break;
+        }
+
+        steps[2] = node->values;
+    }
+
+    steps[3] = NULL;
+
+    if (r->path != NULL) {
+        node = &index->uri;
+        steps[3] = node->values;
+
+        p = r->path->start;
+        end = p + r->path->length;
+
+        while (p < end) {
+            node = nxt_http_route_node_find(node, *p, &pos);
+            if (node == NULL) {
+                break;
+            }
+
+            steps[3] = node->values;
+            p++;
+        }
+    }
+
+    for (k = 0; k < 4; k++) {
+        if (steps[k] != NULL) {
+            step[k] = steps[k]->elts;
+            last[k] = step[k] + steps[k]->nelts;
+
+        } else {
+            step[k] = NULL;
+            last[k] = NULL;
+        }
+    }
+
+    /* The step lists are merged to test the steps in the route order. */
+
+    for ( ;; ) {
+        i = route->items;
+
+        for (k = 0; k < 4; k++) {
+            if (step[k] < last[k] && *step[k] < i) {
+                i = *step[k];
+            }
+        }
+
+        if (i == route->items) {
+            break;
+        }
+
+        for (k = 0; k < 4; k++) {
+            if (step[k] < last[k] && *step[k] == i) {
+                step[k]++;
             }
+        }
+
+        action = nxt_http_route_match(task, r, route->match[i]);
 
+        if (action != NULL) {
             return action;
         }
     }
 
-    nxt_http_request_error(task, r, NXT_HTTP_NOT_FOUND);
+    return NULL;
+}
+
+
+static nxt_http_route_node_t *
+nxt_http_route_node_find(nxt_http_route_node_t *node, u_char c,
+    nxt_uint_t *pos)
+{
+    nxt_uint_t             n, start, end;
+    nxt_http_route_edge_t  *edge;
+
+    start = 0;
+    end = 0;
+
+    if (node->edges != NULL) {
+        edge = node->edges->elts;
+        end = node->edges->nelts;
+
+        while (start < end) {
+            n = (start + end) / 2;
+
+            if (edge[n].c == c) {
+                return edge[n].node;
+            }
+
+            if (edge[n].c < c) {
+                start = n + 1;
+
+            } else {
+                end = n;
+            }
+        }
+    }
+
+    *pos = start;
 
     return NULL;
 }
@@ -1889,6 +3011,10 @@ nxt_http_route_addr_rule(nxt_http_request_t *r,
         return 0;
     }
 
+    if (addr_rule->tree != NULL) {
+        return nxt_http_route_addr_tree_match(addr_rule->tree, sa);
+    }
+
     p = &addr_rule->addr_pattern[0] - 1;
 
     do {
@@ -2083,6 +3209,10 @@ nxt_http_route_test_rule(nxt_http_request_t *r, nxt_http_route_rule_t *rule,
     nxt_int_t                 ret;
     nxt_http_route_pattern_t  *pattern, *end;
 
+    if (rule->index != NULL) {
+        return nxt_http_route_test_rule_index(r, rule, start, length);
+    }
+
     ret = 1;
     pattern = &rule->pattern[0];
     end = pattern + rule->items;
@@ -2107,6 +3237,136 @@ nxt_http_route_test_rule(nxt_http_request_t *r, nxt_http_route_rule_t *rule,
 }
 
 
+static nxt_int_t
+nxt_http_route_test_rule_index(nxt_http_request_t *r,
+    nxt_http_route_rule_t *rule, u_char *start, size_t length)
+{
+    u_char                          c, *p, *end;
+    uint32_t                        i;
+    nxt_int_t                       ret;
+    nxt_uint_t                      pos;
+    nxt_http_route_node_t           *node, *next;
+    nxt_http_route_pattern_index_t  *index;
+
+    index = rule->index;
+
+    for (i = 0; i < index->negative; i++) {
+        ret = nxt_http_route_pattern(r, &rule->pattern[i], start, length);
+        if (ret != 0) {
+            return (ret == NXT_ERROR) ? NXT_ERROR : 0;
+        }
+    }
+
+    if (index->negative == rule->items) {
+        return 1;
+    }
+
+    ret = nxt_http_route_test_patterns(r, rule, index->patterns, start, length);
+    if (ret != 0) {
+        return ret;
+    }
+
+    end = start + length;
+
+    node = &index->prefix;
+    p = start;
+
+    while (node != NULL) {
+        ret = nxt_http_route_test_patterns(r, rule, node->values, start,
+                                           length);
+        if (ret != 0) {
+            return ret;
+        }
+
+        if (p == end) {
+            break;
+        }
+
+        c = index->case_sensitive ? *p : nxt_lowcase(*p);
+        node = nxt_http_route_node_find(node, c, &pos);
+        p++;
+    }
+
+    node = &index->suffix;
+    p = end;
+
+    while (node != NULL) {
+        ret = nxt_http_route_test_patterns(r, rule, node->values, start,
+                                           length);
+        if (ret != 0) {
+            return ret;
+        }
+
+        if (p == start) {
+            break;
+        }
+
+        p--;
+        c = index->case_sensitive ? *p : nxt_lowcase(*p);
+        node = nxt_http_route_node_find(node, c, &pos);
+    }
+
+    if (index->substring.edges == NULL) {
+        return 0;
+    }
+
+    node = &index->substring;
+
+    for (p = start; p < end; p++) {
+        c = index->case_sensitive ? *p : nxt_lowcase(*p);
+
+        for ( ;; ) {
+            next = nxt_http_route_node_find(node, c, &pos);
+
+            if (next != NULL || node->fail == NULL) {
+                break;
+            }
+
+            node = node->fail;
+        }
+
+        if (next != NULL) {
+            node = next;
+        }
+
+        for (next = node; next != NULL; next = next->output) {
+            ret = nxt_http_route_test_patterns(r, rule, next->values, start,
+                                               length);
+            if (ret != 0) {
+                return ret;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+static nxt_int_t
+nxt_http_route_test_patterns(nxt_http_request_t *r, nxt_http_route_rule_t *rule,
+    nxt_array_t *values, u_char *start, size_t length)
+{
+    uint32_t    *n;
+    nxt_int_t   ret;
+    nxt_uint_t  i;
+
+    if (values == NULL) {
+        return 0;
+    }
+
+    n = values->elts;
+
+    for (i = 0; i < values->nelts; i++) {
+        ret = nxt_http_route_pattern(r, &rule->pattern[n[i]], start, length);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+
 static nxt_int_t
 nxt_http_route_pattern(nxt_http_request_t *r, nxt_http_route_pattern_t *pattern,
     u_char *start, size_t length)
@@ -8,9 +8,70 @@
 #include <nxt_http_route_addr.h>
 
 
+/*
+ * The tree consists of path-compressed binary tries of IPv4 and IPv6
+ * prefixes.  A node keeps ports and negation of the patterns having
+ * the node prefix; ranges are split into prefixes.  So an address is
+ * tested only against the patterns along its path in the trie.
+ */
+
+typedef struct nxt_http_route_addr_entry_s  nxt_http_route_addr_entry_t;
+typedef struct nxt_http_route_addr_node_s   nxt_http_route_addr_node_t;
+
+struct nxt_http_route_addr_entry_s {
+    nxt_http_route_addr_entry_t  *next;
+
+    uint16_t                     port_start;
+    uint16_t                     port_end;
+    uint8_t                      negative;  /* 1 bit */
+};
+
+
+struct nxt_http_route_addr_node_s {
+    nxt_http_route_addr_node_t   *child[2];
+    nxt_http_route_addr_entry_t  *entries;
+
+    /* The prefix length in bits. */
+    uint8_t                      prefix;
+    u_char                       addr[0];
+};
+
+
+struct nxt_http_route_addr_tree_s {
+    nxt_http_route_addr_node_t   *inet;
+#if (NXT_INET6)
+    nxt_http_route_addr_node_t   *inet6;
+#endif
+
+    uint8_t                      positive;       /* 1 bit */
+    uint8_t                      unix_positive;  /* 1 bit */
+    uint8_t                      unix_negative;  /* 1 bit */
+};
+
+
 #if (NXT_INET6)
 static nxt_bool_t nxt_valid_ipv6_blocks(u_char *c, size_t len);
 #endif
+static nxt_int_t nxt_http_route_addr_tree_pattern(nxt_mp_t *mp,
+    nxt_http_route_addr_node_t **root, nxt_http_route_addr_base_t *base,
+    u_char *start, u_char *end, size_t len);
+static nxt_int_t nxt_http_route_addr_tree_range(nxt_mp_t *mp,
+    nxt_http_route_addr_node_t **root, nxt_http_route_addr_base_t *base,
+    u_char *start, u_char *end, size_t len);
+static nxt_int_t nxt_http_route_addr_tree_add(nxt_mp_t *mp,
+    nxt_http_route_addr_node_t **root, nxt_http_route_addr_base_t *base,
+    u_char *addr, nxt_uint_t prefix, size_t len);
+static nxt_http_route_addr_node_t *nxt_http_route_addr_node_insert(
+    nxt_mp_t *mp, nxt_http_route_addr_node_t **link, u_char *addr,
+    nxt_uint_t prefix, size_t len);
+static nxt_http_route_addr_node_t *nxt_http_route_addr_node_alloc(
+    nxt_mp_t *mp, u_char *addr, nxt_uint_t prefix, size_t len);
+static nxt_uint_t nxt_http_route_addr_common(u_char *one, u_char *two,
+    nxt_uint_t bits);
+
+
+#define nxt_http_route_addr_bit(addr, n)                                      \
+    (((addr)[(n) >> 3] >> (7 - ((n) & 7))) & 1)
 
 
 nxt_int_t
@@ -344,3 +405,385 @@ nxt_valid_ipv6_blocks(u_char *c, size_t len)
 }
 
 #endif
+
+
+nxt_http_route_addr_tree_t *
+nxt_http_route_addr_tree_create(nxt_mp_t *mp,
+    nxt_http_route_addr_pattern_t *pattern, nxt_uint_t n)
+{
+    u_char                      any[16];
+    nxt_int_t                   ret;
+    nxt_uint_t                  i;
+    nxt_http_route_addr_base_t  *base;
+    nxt_http_route_addr_tree_t  *tree;
+
+    tree = nxt_mp_zget(mp, sizeof(nxt_http_route_addr_tree_t));
+    if (nxt_slow_path(tree == NULL)) {
+        return NULL;
+    }
+
+    nxt_memzero(any, sizeof(any));
+
+    for (i = 0; i < n; i++) {
+        base = &pattern[i].base;
+
+        if (!base->negative) {
+            tree->positive = 1;
+        }
+
+        switch (base->addr_family) {
+
+        case AF_INET:
+            ret = nxt_http_route_addr_tree_pattern(mp, &tree->inet, base,
+                                       (u_char *) &pattern[i].addr.v4.start,
+                                       (u_char *) &pattern[i].addr.v4.end,
+                                       sizeof(in_addr_t));
+            break;
+
+#if (NXT_INET6)
+        case AF_INET6:
+            ret = nxt_http_route_addr_tree_pattern(mp, &tree->inet6, base,
+                                       pattern[i].addr.v6.start.s6_addr,
+                                       pattern[i].addr.v6.end.s6_addr,
+                                       sizeof(struct in6_addr));
+            break;
+#endif
+
+#if (NXT_HAVE_UNIX_DOMAIN)
+        case AF_UNIX:
+            if (base->negative) {
+                tree->unix_negative = 1;
+
+            } else {
+                tree->unix_positive = 1;
+            }
+
+            ret = NXT_OK;
+            break;
+#endif
+
+        default:
+            /* AF_UNSPEC, any address with a port. */
+
+            ret = nxt_http_route_addr_tree_add(mp, &tree->inet, base, any, 0,
+                                               sizeof(in_addr_t));
+#if (NXT_INET6)
+            if (ret == NXT_OK) {
+                ret = nxt_http_route_addr_tree_add(mp, &tree->inet6, base, any,
+                                                   0, sizeof(struct in6_addr));
+            }
+#endif
+            break;
+        }
+
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NULL;
+        }
+    }
+
+    return tree;
+}
+
+
+static nxt_int_t
+nxt_http_route_addr_tree_pattern(nxt_mp_t *mp,
+    nxt_http_route_addr_node_t **root, nxt_http_route_addr_base_t *base,
+    u_char *start, u_char *end, size_t len)
+{
+    u_char      c;
+    nxt_uint_t  i, prefix;
+
+    switch (base->match_type) {
+
+    case NXT_HTTP_ROUTE_ADDR_ANY:
+        return nxt_http_route_addr_tree_add(mp, root, base, start, 0, len);
+
+    case NXT_HTTP_ROUTE_ADDR_EXACT:
+        return nxt_http_route_addr_tree_add(mp, root, base, start, len * 8,
+                                            len);
+
+    case NXT_HTTP_ROUTE_ADDR_CIDR:
+        /* The end is the network mask. */
+
+        prefix = 0;
+
+        for (i = 0; i < len; i++) {
+            for (c = end[i]; c & 0x80; c <<= 1) {
+                prefix++;
+            }
+
+            if (end[i] != 0xFF) {
+                break;
+            }
+        }
+
+        return nxt_http_route_addr_tree_add(mp, root, base, start, prefix,
+                                            len);
+
+    default:
+        /* NXT_HTTP_ROUTE_ADDR_RANGE */
+        return nxt_http_route_addr_tree_range(mp, root, base, start, end, len);
+    }
+}
+
+
+static nxt_int_t
+nxt_http_route_addr_tree_range(nxt_mp_t *mp, nxt_http_route_addr_node_t **root,
+    nxt_http_route_addr_base_t *base, u_char *start, u_char *end, size_t len)
+{
+    u_char      addr[16], last[16];
+    nxt_int_t   ret;
+    nxt_uint_t  i, k, n, bits;
+
+    bits = len * 8;
+
+    nxt_memcpy(addr, start, len);
+
+    for ( ;; ) {
+        /* The largest prefix starting at the address and within the range. */
+
+        for (k = 0; k < bits; k++) {
+            if (nxt_http_route_addr_bit(addr, bits - 1 - k) != 0) {
+                break;
+            }
+        }
+
+        for ( ;; ) {
+            nxt_memcpy(last, addr, len);
+
+            for (i = len, n = k; n != 0; n -= nxt_min(n, 8)) {
+                i--;
+                last[i] |= (n >= 8) ? 0xFF : (1 << n) - 1;
+            }
+
+            if (memcmp(last, end, len) <= 0) {
+                break;
+            }
+
+            k--;
+        }
+
+        ret = nxt_http_route_addr_tree_add(mp, root, base, addr, bits - k,
+                                           len);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+
+        if (memcmp(last, end, len) == 0) {
+            return NXT_OK;
+        }
+
+        nxt_memcpy(addr, last, len);
+
+        for (i = len; i != 0; i--) {
+            if (++addr[i - 1] != 0) {
+                break;
+            }
+        }
+    }
+}
+
+
+static nxt_int_t
+nxt_http_route_addr_tree_add(nxt_mp_t *mp, nxt_http_route_addr_node_t **root,
+    nxt_http_route_addr_base_t *base, u_char *addr, nxt_uint_t prefix,
+    size_t len)
+{
+    nxt_http_route_addr_node_t   *node;
+    nxt_http_route_addr_entry_t  *entry;
+
+    node = nxt_http_route_addr_node_insert(mp, root, addr, prefix, len);
+    if (nxt_slow_path(node == NULL)) {
+        return NXT_ERROR;
+    }
+
+    entry = nxt_mp_get(mp, sizeof(nxt_http_route_addr_entry_t));
+    if (nxt_slow_path(entry == NULL)) {
+        return NXT_ERROR;
+    }
+
+    entry->port_start = base->port.start;
+    entry->port_end = base->port.end;
+    entry->negative = base->negative;
+
+    entry->next = node->entries;
+    node->entries = entry;
+
+    return NXT_OK;
+}
+
+
+static nxt_http_route_addr_node_t *
+nxt_http_route_addr_node_insert(nxt_mp_t *mp, nxt_http_route_addr_node_t **link,
+    u_char *addr, nxt_uint_t prefix, size_t len)
+{
+    nxt_uint_t                  common;
+    nxt_http_route_addr_node_t  *node, *parent, *leaf;
+
+    for ( ;; ) {
+        node = *link;
+
+        if (node == NULL) {
+            node = nxt_http_route_addr_node_alloc(mp, addr, prefix, len);
+            *link = node;
+
+            return node;
+        }
+
+        common = nxt_http_route_addr_common(addr, node->addr,
+                                            nxt_min(prefix, node->prefix));
+
+        if (common == node->prefix) {
+            if (prefix == node->prefix) {
+                return node;
+            }
+
+            link = &node->child[nxt_http_route_addr_bit(addr, node->prefix)];
+            continue;
+        }
+
+        /* The node is split by a new node with the common prefix. */
+
+        parent = nxt_http_route_addr_node_alloc(mp, addr, common, len);
+        if (nxt_slow_path(parent == NULL)) {
+            return NULL;
+        }
+
+        parent->child[nxt_http_route_addr_bit(node->addr, common)] = node;
+        *link = parent;
+
+        if (common == prefix) {
+            return parent;
+        }
+
+        leaf = nxt_http_route_addr_node_alloc(mp, addr, prefix, len);
+        if (nxt_slow_path(leaf == NULL)) {
+            return NULL;
+        }
+
+        parent->child[nxt_http_route_addr_bit(addr, common)] = leaf;
+
+        return leaf;
+    }
+}
+
+
+static nxt_http_route_addr_node_t *
+nxt_http_route_addr_node_alloc(nxt_mp_t *mp, u_char *addr, nxt_uint_t prefix,
+    size_t len)
+{
+    size_t                      n;
+    nxt_http_route_addr_node_t  *node;
+
+    node = nxt_mp_zget(mp, sizeof(nxt_http_route_addr_node_t) + len);
+    if (nxt_slow_path(node == NULL)) {
+        return NULL;
+    }
+
+    node->prefix = prefix;
+
+    n = prefix / 8;
+    nxt_memcpy(node->addr, addr, n);
+
+    if (prefix % 8 != 0) {
+        node->addr[n] = addr[n] & (0xFF << (8 - prefix % 8));
+    }
+
+    return node;
+}
+
+
+static nxt_uint_t
+nxt_http_route_addr_common(u_char *one, u_char *two, nxt_uint_t bits)
+{
+    u_char      c;
+    nxt_uint_t  n;
+
+    for (n = 0; n < bits; n += 8) {
+        c = one[n / 8] ^ two[n / 8];
+
+        if (c != 0) {
+            while ((c & 0x80) == 0) {
+                c <<= 1;
+                n++;
+            }
+
+            return nxt_min(n, bits);
+        }
+    }
+
+    return bits;
+}
+
+
+nxt_int_t
+nxt_http_route_addr_tree_match(nxt_http_route_addr_tree_t *tree,
+    nxt_sockaddr_t *sa)
+{
+    u_char                       *addr;
+    in_port_t                    port;
+    nxt_uint_t                   bits;
+    nxt_bool_t                   found;
+    nxt_http_route_addr_node_t   *node;
+    nxt_http_route_addr_entry_t  *entry;
+
+    switch (sa->u.sockaddr.sa_family) {
+
+    case AF_INET:
+        node = tree->inet;
+        addr = (u_char *) &sa->u.sockaddr_in.sin_addr;
+        port = ntohs(sa->u.sockaddr_in.sin_port);
+        bits = 32;
+        break;
+
+#if (NXT_INET6)
+    case AF_INET6:
+        node = tree->inet6;
+        addr = sa->u.sockaddr_in6.sin6_addr.s6_addr;
+        port = ntohs(sa->u.sockaddr_in6.sin6_port);
+        bits = 128;
+        break;
+#endif
+
+#if (NXT_HAVE_UNIX_DOMAIN)
+    case AF_UNIX:
+        if (tree->unix_negative) {
+            return 0;
+        }
+
+        return tree->unix_positive || !tree->positive;
+#endif
+
+    default:
+        return !tree->positive;
+    }
+
+    found = 0;
+
+    while (node != NULL) {
+        if (nxt_http_route_addr_common(addr, node->addr, node->prefix)
+            != node->prefix)
+        {
+            break;
+        }
+
+        for (entry = node->entries; entry != NULL; entry = entry->next) {
+            if (port >= entry->port_start && port <= entry->port_end) {
+
+                if (entry->negative) {
+                    return 0;
+                }
+
+                found = 1;
+            }
+        }
+
+        if (node->prefix == bits) {
+            break;
+        }
+
+        node = node->child[nxt_http_route_addr_bit(addr, node->prefix)];
+    }
+
+    return found || !tree->positive;
+}
@@ -60,6 +60,10 @@ static void nxt_http_static_body_handler(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_http_static_buf_completion(nxt_task_t *task, void *obj,
     void *data);
+static void nxt_http_static_sendfile_handler(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_http_static_file_completion(nxt_task_t *task, void *obj,
+    void *data);
 
 static nxt_int_t nxt_http_static_mtypes_hash_test(nxt_lvlhsh_query_t *lhq,
     void *data);
@@ -584,7 +588,8 @@ nxt_http_static_send_ready(nxt_task_t *task, void *obj, void *data)
 
             r->out = fb;
 
-            body_handler = &nxt_http_static_body_handler;
+            body_handler = r->sendfile ? &nxt_http_static_sendfile_handler
+                                       : &nxt_http_static_body_handler;
 
         } else {
             nxt_file_close(task, f);
@@ -932,6 +937,48 @@ nxt_http_static_buf_completion(nxt_task_t *task, void *obj, void *data)
 }
 
 
+/*
+ * The connection is able to send the file itself, so the file buffer
+ * is passed as is and the file is closed once it has been sent.
+ */
+
+static void
+nxt_http_static_sendfile_handler(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t           *fb;
+    nxt_http_request_t  *r;
+
+    r = obj;
+    fb = r->out;
+    r->out = NULL;
+
+    nxt_buf_set_file(fb);
+
+    fb->completion_handler = nxt_http_static_file_completion;
+    fb->parent = r;
+    fb->next = nxt_http_buf_last(r);
+
+    nxt_mp_retain(r->mem_pool);
+
+    nxt_http_request_send(task, r, fb);
+}
+
+
+static void
+nxt_http_static_file_completion(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_buf_t           *fb;
+    nxt_http_request_t  *r;
+
+    fb = obj;
+    r = data;
+
+    nxt_file_close(task, fb->file);
+
+    nxt_mp_release(r->mem_pool);
+}
+
+
 nxt_int_t
 nxt_http_static_mtypes_init(nxt_mp_t *mp, nxt_lvlhsh_t *hash)
 {
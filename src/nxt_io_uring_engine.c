@@ -0,0 +1,819 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_main.h>
+#include <linux/io_uring.h>
+
+
+/*
+ * The io_uring engine uses the ring as a batched readiness interface:
+ * file descriptor interest changes are queued as IORING_OP_POLL_ADD and
+ * IORING_OP_POLL_REMOVE submissions and are passed to the kernel together
+ * with waiting for completions in a single io_uring_enter() call, while
+ * epoll requires an epoll_ctl() call per change.  Poll requests are
+ * one-shot, so they are rearmed after the events have been handled that
+ * provides level-triggered semantics of the nxt_unix_conn_io operations.
+ *
+ * Only polling is submitted to the ring: accept, recv, writev, and
+ * sendfile are still the readiness-based nxt_unix_conn_io operations.
+ * Listening sockets are polled as other descriptors, so there is no
+ * exclusive accept wakeup; each router thread has its own listening
+ * socket if SO_REUSEPORT sharding is used.
+ *
+ * IORING_FEAT_NODROP       Linux 5.5.
+ * IORING_FEAT_EXT_ARG      Linux 5.11.
+ */
+
+
+#define NXT_IO_URING_ADD        0
+#define NXT_IO_URING_CHANGE     1
+#define NXT_IO_URING_DELETE     2
+
+/* The user data of POLL_REMOVE submissions, their completions are ignored. */
+#define NXT_IO_URING_IGNORE     0xffffffffffffffffULL
+
+#define nxt_io_uring_user_data(fd, generation)                                \
+    (((uint64_t) (generation) << 32) | (uint32_t) (fd))
+
+
+static nxt_int_t nxt_io_uring_create(nxt_event_engine_t *engine,
+    nxt_uint_t mchanges, nxt_uint_t mevents);
+static void nxt_io_uring_free(nxt_event_engine_t *engine);
+static void nxt_io_uring_enable(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_disable(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static nxt_bool_t nxt_io_uring_close(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_enable_read(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_enable_write(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_disable_read(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_disable_write(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_block_read(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_block_write(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_oneshot_read(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_oneshot_write(nxt_event_engine_t *engine,
+    nxt_fd_event_t *ev);
+static void nxt_io_uring_change(nxt_event_engine_t *engine, nxt_fd_event_t *ev,
+    nxt_uint_t op, uint32_t events);
+static void nxt_io_uring_commit_changes(nxt_event_engine_t *engine);
+static nxt_int_t nxt_io_uring_fds_grow(nxt_event_engine_t *engine,
+    nxt_fd_t fd);
+static struct io_uring_sqe *nxt_io_uring_sqe(nxt_event_engine_t *engine);
+static int nxt_io_uring_enter(int fd, uint32_t submit, uint32_t wait,
+    uint32_t flags, void *arg, size_t size);
+static void nxt_io_uring_poll(nxt_event_engine_t *engine, nxt_msec_t timeout);
+static void nxt_io_uring_event(nxt_event_engine_t *engine,
+    struct io_uring_cqe *cqe);
+
+
+const nxt_event_interface_t  nxt_io_uring_engine = {
+    "io_uring",
+    nxt_io_uring_create,
+    nxt_io_uring_free,
+    nxt_io_uring_enable,
+    nxt_io_uring_disable,
+    nxt_io_uring_disable,
+    nxt_io_uring_close,
+    nxt_io_uring_enable_read,
+    nxt_io_uring_enable_write,
+    nxt_io_uring_disable_read,
+    nxt_io_uring_disable_write,
+    nxt_io_uring_block_read,
+    nxt_io_uring_block_write,
+    nxt_io_uring_oneshot_read,
+    nxt_io_uring_oneshot_write,
+    nxt_io_uring_enable_read,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    nxt_io_uring_poll,
+
+    &nxt_unix_conn_io,
+
+    NXT_NO_FILE_EVENTS,
+    NXT_NO_SIGNAL_EVENTS,
+};
+
+
+nxt_bool_t
+nxt_io_uring_available(nxt_task_t *task)
+{
+    int                     fd;
+    struct io_uring_params  p;
+
+    nxt_memzero(&p, sizeof(struct io_uring_params));
+
+    fd = syscall(__NR_io_uring_setup, 2, &p);
+
+    if (fd == -1) {
+        nxt_log(task, NXT_LOG_NOTICE, "io_uring_setup() failed %E", nxt_errno);
+        return 0;
+    }
+
+    close(fd);
+
+    if ((p.features & (IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG))
+        != (IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG))
+    {
+        nxt_log(task, NXT_LOG_NOTICE, "io_uring features %08XD "
+                "are not sufficient", p.features);
+        return 0;
+    }
+
+    return 1;
+}
+
+
+static nxt_int_t
+nxt_io_uring_create(nxt_event_engine_t *engine, nxt_uint_t mchanges,
+    nxt_uint_t mevents)
+{
+    int                     fd;
+    void                    *p;
+    uint32_t                i, *array;
+    nxt_io_uring_engine_t   *ur;
+    struct io_uring_params  params;
+
+    ur = &engine->u.io_uring;
+
+    nxt_memzero(ur, sizeof(nxt_io_uring_engine_t));
+
+    ur->fd = -1;
+    ur->mchanges = mchanges;
+
+    ur->changes = nxt_malloc(sizeof(nxt_io_uring_change_t) * mchanges);
+    if (ur->changes == NULL) {
+        goto fail;
+    }
+
+    nxt_memzero(&params, sizeof(struct io_uring_params));
+
+    /* A change may require both POLL_REMOVE and POLL_ADD submissions. */
+
+    fd = syscall(__NR_io_uring_setup, nxt_max(2 * mchanges, mevents),
+                 &params);
+
+    if (fd == -1) {
+        nxt_alert(&engine->task, "io_uring_setup() failed %E", nxt_errno);
+        goto fail;
+    }
+
+    ur->fd = fd;
+
+    nxt_debug(&engine->task, "io_uring_setup(): %d sq:%uD cq:%uD",
+              fd, params.sq_entries, params.cq_entries);
+
+    ur->sq_ring_size = params.sq_off.array
+                       + params.sq_entries * sizeof(uint32_t);
+
+    p = mmap(NULL, ur->sq_ring_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+
+    if (p == MAP_FAILED) {
+        nxt_alert(&engine->task, "mmap(IORING_OFF_SQ_RING) failed %E",
+                  nxt_errno);
+        goto fail;
+    }
+
+    ur->sq_ring = p;
+
+    ur->cq_ring_size = params.cq_off.cqes
+                       + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    p = mmap(NULL, ur->cq_ring_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+
+    if (p == MAP_FAILED) {
+        nxt_alert(&engine->task, "mmap(IORING_OFF_CQ_RING) failed %E",
+                  nxt_errno);
+        goto fail;
+    }
+
+    ur->cq_ring = p;
+
+    ur->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    p = mmap(NULL, ur->sqes_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+    if (p == MAP_FAILED) {
+        nxt_alert(&engine->task, "mmap(IORING_OFF_SQES) failed %E", nxt_errno);
+        goto fail;
+    }
+
+    ur->sqes = p;
+
+    ur->sq_entries = params.sq_entries;
+    ur->sq_tail = nxt_pointer_to(ur->sq_ring, params.sq_off.tail);
+    ur->sq_mask = nxt_pointer_to(ur->sq_ring, params.sq_off.ring_mask);
+
+    /* Submission entries are always used in the order of the ring. */
+
+    array = nxt_pointer_to(ur->sq_ring, params.sq_off.array);
+
+    for (i = 0; i < params.sq_entries; i++) {
+        array[i] = i;
+    }
+
+    ur->cq_head = nxt_pointer_to(ur->cq_ring, params.cq_off.head);
+    ur->cq_tail = nxt_pointer_to(ur->cq_ring, params.cq_off.tail);
+    ur->cq_mask = nxt_pointer_to(ur->cq_ring, params.cq_off.ring_mask);
+    ur->cqes = nxt_pointer_to(ur->cq_ring, params.cq_off.cqes);
+
+    return NXT_OK;
+
+fail:
+
+    nxt_io_uring_free(engine);
+
+    return NXT_ERROR;
+}
+
+
+static void
+nxt_io_uring_free(nxt_event_engine_t *engine)
+{
+    nxt_io_uring_engine_t  *ur;
+
+    ur = &engine->u.io_uring;
+
+    nxt_debug(&engine->task, "io_uring %d free", ur->fd);
+
+    if (ur->sqes != NULL) {
+        (void) munmap(ur->sqes, ur->sqes_size);
+    }
+
+    if (ur->cq_ring != NULL) {
+        (void) munmap(ur->cq_ring, ur->cq_ring_size);
+    }
+
+    if (ur->sq_ring != NULL) {
+        (void) munmap(ur->sq_ring, ur->sq_ring_size);
+    }
+
+    /* Closing the ring cancels all pending poll requests. */
+
+    if (ur->fd != -1 && close(ur->fd) != 0) {
+        nxt_alert(&engine->task, "io_uring close(%d) failed %E",
+                  ur->fd, nxt_errno);
+    }
+
+    nxt_free(ur->fds);
+    nxt_free(ur->changes);
+
+    nxt_memzero(ur, sizeof(nxt_io_uring_engine_t));
+}
+
+
+static void
+nxt_io_uring_enable(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    ev->read = NXT_EVENT_ACTIVE;
+    ev->write = NXT_EVENT_ACTIVE;
+
+    nxt_io_uring_change(engine, ev, NXT_IO_URING_ADD, POLLIN | POLLOUT);
+}
+
+
+static void
+nxt_io_uring_disable(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    if (ev->read != NXT_EVENT_INACTIVE || ev->write != NXT_EVENT_INACTIVE) {
+        ev->read = NXT_EVENT_INACTIVE;
+        ev->write = NXT_EVENT_INACTIVE;
+
+        nxt_io_uring_change(engine, ev, NXT_IO_URING_DELETE, 0);
+    }
+}
+
+
+/*
+ * A pending POLL_REMOVE must be submitted before the file descriptor
+ * is closed, otherwise a new file with the same descriptor may inherit
+ * events of the closed one.
+ */
+
+static nxt_bool_t
+nxt_io_uring_close(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    nxt_io_uring_disable(engine, ev);
+
+    return ev->changing;
+}
+
+
+static void
+nxt_io_uring_enable_read(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    nxt_uint_t  op;
+    uint32_t    events;
+
+    ev->read = NXT_EVENT_ACTIVE;
+
+    if (ev->write == NXT_EVENT_INACTIVE) {
+        op = NXT_IO_URING_ADD;
+        events = POLLIN;
+
+    } else {
+        op = NXT_IO_URING_CHANGE;
+        events = POLLIN | POLLOUT;
+    }
+
+    nxt_io_uring_change(engine, ev, op, events);
+}
+
+
+static void
+nxt_io_uring_enable_write(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    nxt_uint_t  op;
+    uint32_t    events;
+
+    ev->write = NXT_EVENT_ACTIVE;
+
+    if (ev->read == NXT_EVENT_INACTIVE) {
+        op = NXT_IO_URING_ADD;
+        events = POLLOUT;
+
+    } else {
+        op = NXT_IO_URING_CHANGE;
+        events = POLLIN | POLLOUT;
+    }
+
+    nxt_io_uring_change(engine, ev, op, events);
+}
+
+
+static void
+nxt_io_uring_disable_read(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    nxt_uint_t  op;
+    uint32_t    events;
+
+    ev->read = NXT_EVENT_INACTIVE;
+
+    if (ev->write == NXT_EVENT_INACTIVE) {
+        op = NXT_IO_URING_DELETE;
+        events = 0;
+
+    } else {
+        op = NXT_IO_URING_CHANGE;
+        events = POLLOUT;
+    }
+
+    nxt_io_uring_change(engine, ev, op, events);
+}
+
+
+static void
+nxt_io_uring_disable_write(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    nxt_uint_t  op;
+    uint32_t    events;
+
+    ev->write = NXT_EVENT_INACTIVE;
+
+    if (ev->read == NXT_EVENT_INACTIVE) {
+        op = NXT_IO_URING_DELETE;
+        events = 0;
+
+    } else {
+        op = NXT_IO_URING_CHANGE;
+        events = POLLIN;
+    }
+
+    nxt_io_uring_change(engine, ev, op, events);
+}
+
+
+static void
+nxt_io_uring_block_read(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    if (ev->read != NXT_EVENT_INACTIVE) {
+        nxt_io_uring_disable_read(engine, ev);
+    }
+}
+
+
+static void
+nxt_io_uring_block_write(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    if (ev->write != NXT_EVENT_INACTIVE) {
+        nxt_io_uring_disable_write(engine, ev);
+    }
+}
+
+
+static void
+nxt_io_uring_oneshot_read(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    nxt_uint_t  op;
+
+    op = (ev->read == NXT_EVENT_INACTIVE && ev->write == NXT_EVENT_INACTIVE) ?
+             NXT_IO_URING_ADD : NXT_IO_URING_CHANGE;
+
+    ev->read = NXT_EVENT_ONESHOT;
+    ev->write = NXT_EVENT_INACTIVE;
+
+    nxt_io_uring_change(engine, ev, op, POLLIN);
+}
+
+
+static void
+nxt_io_uring_oneshot_write(nxt_event_engine_t *engine, nxt_fd_event_t *ev)
+{
+    nxt_uint_t  op;
+
+    op = (ev->read == NXT_EVENT_INACTIVE && ev->write == NXT_EVENT_INACTIVE) ?
+             NXT_IO_URING_ADD : NXT_IO_URING_CHANGE;
+
+    ev->read = NXT_EVENT_INACTIVE;
+    ev->write = NXT_EVENT_ONESHOT;
+
+    nxt_io_uring_change(engine, ev, op, POLLOUT);
+}
+
+
+/*
+ * io_uring changes are batched and are converted to submission queue
+ * entries just before io_uring_enter() call, so several changes of the
+ * same file descriptor during one event loop iteration are coalesced.
+ */
+
+static void
+nxt_io_uring_change(nxt_event_engine_t *engine, nxt_fd_event_t *ev,
+    nxt_uint_t op, uint32_t events)
+{
+    nxt_io_uring_change_t  *change;
+
+    nxt_debug(ev->task, "io_uring change: fd:%d op:%ui ev:%XD",
+              ev->fd, op, events);
+
+    if (engine->u.io_uring.nchanges >= engine->u.io_uring.mchanges) {
+        nxt_io_uring_commit_changes(engine);
+    }
+
+    ev->changing = 1;
+
+    change = &engine->u.io_uring.changes[engine->u.io_uring.nchanges++];
+    change->op = op;
+    change->events = events;
+    change->event = ev;
+}
+
+
+static void
+nxt_io_uring_commit_changes(nxt_event_engine_t *engine)
+{
+    nxt_fd_t               fd;
+    nxt_fd_event_t         *ev;
+    nxt_io_uring_fd_t      *slot;
+    struct io_uring_sqe    *sqe;
+    nxt_io_uring_engine_t  *ur;
+    nxt_io_uring_change_t  *change, *end;
+
+    ur = &engine->u.io_uring;
+
+    nxt_debug(&engine->task, "io_uring %d changes:%ui", ur->fd, ur->nchanges);
+
+    change = ur->changes;
+    end = change + ur->nchanges;
+
+    do {
+        ev = change->event;
+        ev->changing = 0;
+
+        fd = ev->fd;
+
+        if (nxt_slow_path((nxt_uint_t) fd >= ur->nfds)) {
+
+            if (change->op == NXT_IO_URING_DELETE) {
+                goto next;
+            }
+
+            if (nxt_io_uring_fds_grow(engine, fd) != NXT_OK) {
+                nxt_work_queue_add(&engine->fast_work_queue,
+                                   ev->error_handler, ev->task, ev, ev->data);
+                goto next;
+            }
+        }
+
+        slot = &ur->fds[fd];
+
+        if (change->op != NXT_IO_URING_DELETE
+            && slot->event == ev
+            && slot->events == change->events)
+        {
+            /* The poll request is already armed. */
+            goto next;
+        }
+
+        if (slot->events != 0) {
+            sqe = nxt_io_uring_sqe(engine);
+
+            if (nxt_fast_path(sqe != NULL)) {
+                sqe->opcode = IORING_OP_POLL_REMOVE;
+                sqe->fd = -1;
+                sqe->addr = nxt_io_uring_user_data(fd, slot->generation);
+                sqe->user_data = NXT_IO_URING_IGNORE;
+            }
+
+            slot->events = 0;
+        }
+
+        /* A completion of the previous request will be ignored. */
+        slot->generation++;
+
+        if (change->op == NXT_IO_URING_DELETE || change->events == 0) {
+            slot->event = NULL;
+            goto next;
+        }
+
+        sqe = nxt_io_uring_sqe(engine);
+
+        if (nxt_slow_path(sqe == NULL)) {
+            slot->event = NULL;
+
+            nxt_work_queue_add(&engine->fast_work_queue, ev->error_handler,
+                               ev->task, ev, ev->data);
+            goto next;
+        }
+
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll_events = change->events;
+        sqe->user_data = nxt_io_uring_user_data(fd, slot->generation);
+
+        slot->event = ev;
+        slot->events = change->events;
+
+    next:
+
+        change++;
+
+    } while (change < end);
+
+    ur->nchanges = 0;
+}
+
+
+static nxt_int_t
+nxt_io_uring_fds_grow(nxt_event_engine_t *engine, nxt_fd_t fd)
+{
+    nxt_uint_t             nfds;
+    nxt_io_uring_fd_t      *fds;
+    nxt_io_uring_engine_t  *ur;
+
+    ur = &engine->u.io_uring;
+
+    nfds = nxt_max(2 * ur->nfds, (nxt_uint_t) fd + 256);
+
+    fds = nxt_realloc(ur->fds, sizeof(nxt_io_uring_fd_t) * nfds);
+    if (nxt_slow_path(fds == NULL)) {
+        return NXT_ERROR;
+    }
+
+    nxt_memzero(&fds[ur->nfds], sizeof(nxt_io_uring_fd_t) * (nfds - ur->nfds));
+
+    ur->fds = fds;
+    ur->nfds = nfds;
+
+    return NXT_OK;
+}
+
+
+static struct io_uring_sqe *
+nxt_io_uring_sqe(nxt_event_engine_t *engine)
+{
+    int                    n;
+    uint32_t               tail;
+    struct io_uring_sqe    *sqe;
+    nxt_io_uring_engine_t  *ur;
+
+    ur = &engine->u.io_uring;
+
+    if (ur->nsubmit == ur->sq_entries) {
+        n = nxt_io_uring_enter(ur->fd, ur->nsubmit, 0, 0, NULL, 0);
+
+        if (nxt_slow_path(n <= 0)) {
+            nxt_alert(&engine->task, "io_uring_enter(%d) failed %E",
+                      ur->fd, nxt_errno);
+            return NULL;
+        }
+
+        ur->nsubmit -= n;
+    }
+
+    tail = *ur->sq_tail;
+
+    sqe = &ur->sqes[tail & *ur->sq_mask];
+    nxt_memzero(sqe, sizeof(struct io_uring_sqe));
+
+    __atomic_store_n(ur->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    ur->nsubmit++;
+
+    return sqe;
+}
+
+
+static int
+nxt_io_uring_enter(int fd, uint32_t submit, uint32_t wait, uint32_t flags,
+    void *arg, size_t size)
+{
+    return syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg, size);
+}
+
+
+static void
+nxt_io_uring_poll(nxt_event_engine_t *engine, nxt_msec_t timeout)
+{
+    int                             n;
+    uint32_t                        head, tail, wait, flags;
+    nxt_err_t                       err;
+    nxt_uint_t                      level;
+    struct timespec                 ts;
+    nxt_io_uring_engine_t           *ur;
+    struct io_uring_getevents_arg   arg;
+
+    ur = &engine->u.io_uring;
+
+    if (ur->nchanges != 0) {
+        nxt_io_uring_commit_changes(engine);
+    }
+
+    head = *ur->cq_head;
+
+    if (head != __atomic_load_n(ur->cq_tail, __ATOMIC_ACQUIRE)) {
+        /* Completions are left after io_uring_enter() on a full ring. */
+        timeout = 0;
+    }
+
+    nxt_memzero(&arg, sizeof(struct io_uring_getevents_arg));
+
+    wait = 0;
+    flags = IORING_ENTER_EXT_ARG;
+
+    if (timeout != 0) {
+        wait = 1;
+        flags |= IORING_ENTER_GETEVENTS;
+
+        if (timeout != NXT_INFINITE_MSEC) {
+            ts.tv_sec = timeout / 1000;
+            ts.tv_nsec = (timeout % 1000) * 1000000;
+            arg.ts = (uint64_t) (uintptr_t) &ts;
+        }
+    }
+
+    nxt_debug(&engine->task, "io_uring_enter(%d) submit:%uD timeout:%M",
+              ur->fd, ur->nsubmit, timeout);
+
+    n = nxt_io_uring_enter(ur->fd, ur->nsubmit, wait, flags, &arg,
+                           sizeof(struct io_uring_getevents_arg));
+
+    err = (n == -1) ? nxt_errno : 0;
+
+    nxt_thread_time_update(engine->task.thread);
+
+    nxt_debug(&engine->task, "io_uring_enter(%d): %d", ur->fd, n);
+
+    if (n == -1) {
+        if (err != NXT_ETIME && err != NXT_EINTR && err != NXT_EBUSY) {
+            nxt_alert(&engine->task, "io_uring_enter(%d) failed %E",
+                      ur->fd, err);
+            return;
+        }
+
+        level = (err == NXT_EINTR) ? NXT_LOG_INFO : NXT_LOG_DEBUG;
+
+        nxt_log(&engine->task, level, "io_uring_enter(%d) failed %E",
+                ur->fd, err);
+
+    } else {
+        ur->nsubmit -= n;
+    }
+
+    tail = __atomic_load_n(ur->cq_tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        nxt_io_uring_event(engine, &ur->cqes[head & *ur->cq_mask]);
+        head++;
+    }
+
+    __atomic_store_n(ur->cq_head, head, __ATOMIC_RELEASE);
+}
+
+
+static void
+nxt_io_uring_event(nxt_event_engine_t *engine, struct io_uring_cqe *cqe)
+{
+    nxt_fd_t               fd;
+    uint32_t               events;
+    nxt_bool_t             error;
+    nxt_fd_event_t         *ev;
+    nxt_io_uring_fd_t      *slot;
+    nxt_io_uring_engine_t  *ur;
+
+    if (cqe->user_data == NXT_IO_URING_IGNORE) {
+        return;
+    }
+
+    ur = &engine->u.io_uring;
+
+    fd = (uint32_t) cqe->user_data;
+
+    if ((nxt_uint_t) fd >= ur->nfds) {
+        return;
+    }
+
+    slot = &ur->fds[fd];
+
+    if (slot->generation != (uint32_t) (cqe->user_data >> 32)
+        || slot->event == NULL)
+    {
+        /* A stale completion of a removed or changed poll request. */
+        return;
+    }
+
+    ev = slot->event;
+
+    /* Poll requests are one-shot. */
+    slot->events = 0;
+
+    nxt_debug(ev->task, "io_uring: fd:%d res:%d rd:%d wr:%d",
+              fd, cqe->res, ev->read, ev->write);
+
+    if (nxt_slow_path(cqe->res < 0)) {
+        nxt_alert(ev->task, "io_uring poll(%d) failed %E", fd, -cqe->res);
+
+        slot->event = NULL;
+
+        nxt_work_queue_add(&engine->fast_work_queue, ev->error_handler,
+                           ev->task, ev, ev->data);
+        return;
+    }
+
+    events = cqe->res;
+
+    /*
+     * On error Linux sets POLLHUP and POLLERR only, so the "error"
+     * variable enqueues only one active handler.
+     */
+
+    error = (((events & (POLLERR | POLLHUP)) != 0)
+             && ((events & (POLLIN | POLLOUT)) == 0));
+
+    if ((events & POLLIN) || (error && ev->read_handler != NULL)) {
+        error = 0;
+        ev->read_ready = 1;
+
+        if (ev->read == NXT_EVENT_ONESHOT) {
+            ev->read = NXT_EVENT_INACTIVE;
+        }
+
+        nxt_work_queue_add(ev->read_work_queue, ev->read_handler,
+                           ev->task, ev, ev->data);
+    }
+
+    if ((events & POLLOUT) || (error && ev->write_handler != NULL)) {
+        ev->write_ready = 1;
+
+        if (ev->write == NXT_EVENT_ONESHOT) {
+            ev->write = NXT_EVENT_INACTIVE;
+        }
+
+        nxt_work_queue_add(ev->write_work_queue, ev->write_handler,
+                           ev->task, ev, ev->data);
+    }
+
+    /*
+     * Rearm the request.  The change is committed after the handlers
+     * have been run and may be overridden by their own changes.
+     */
+
+    events = 0;
+
+    if (ev->read != NXT_EVENT_INACTIVE) {
+        events |= POLLIN;
+    }
+
+    if (ev->write != NXT_EVENT_INACTIVE) {
+        events |= POLLOUT;
+    }
+
+    nxt_io_uring_change(engine, ev,
+                        (events != 0) ? NXT_IO_URING_CHANGE
+                                      : NXT_IO_URING_DELETE,
+                        events);
+}
@@ -115,6 +115,8 @@ nxt_job_start(nxt_task_t *task, nxt_job_t *job, nxt_work_handler_t handler)
 
         job->engine = task->thread->engine;
 
+        job->work.next = NULL;
+
         nxt_work_set(&job->work, nxt_job_thread_trampoline,
                      job->task, job, (void *) handler);
 
@@ -161,6 +163,12 @@ nxt_job_return(nxt_task_t *task, nxt_job_t *job, nxt_work_handler_t handler)
     if (job->engine != NULL) {
         /* A return function is called in thread pool thread context. */
 
+        /*
+         * The work may still point to the next work of the thread pool
+         * queue, so it must be unlinked before posting to the engine.
+         */
+        job->work.next = NULL;
+
         nxt_work_set(&job->work, nxt_job_thread_return_handler,
                      job->task, job, (void *) handler);
 
@@ -18,6 +18,10 @@ typedef struct {
 
     nxt_sockaddr_t            *sockaddr;
 
+    /* SO_REUSEPORT sockets, one per router thread. */
+    nxt_socket_t              *shards;
+    uint32_t                  nshards;
+
     uint32_t                  count;
 
     uint8_t                   flags;
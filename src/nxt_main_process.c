@@ -26,6 +26,7 @@ typedef struct {
     nxt_socket_error_t  error;
     u_char              *start;
     u_char              *end;
+    uint8_t             reuseport;  /* 1 bit */
 } nxt_listening_socket_t;
 
 
@@ -230,6 +231,12 @@ static nxt_conf_map_t  nxt_python_app_conf[] = {
         NXT_CONF_MAP_INT32,
         offsetof(nxt_common_app_conf_t, u.python.thread_stack_size),
     },
+
+    {
+        nxt_string("preload"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_common_app_conf_t, u.python.preload),
+    },
 };
 
 
@@ -1125,6 +1132,11 @@ nxt_main_port_socket_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     ls.error = NXT_SOCKET_ERROR_SYSTEM;
     ls.start = message;
     ls.end = message + sizeof(message);
+    ls.reuseport = 0;
+
+    if ((size_t) (b->mem.free - b->mem.pos) > nxt_sockaddr_size(sa)) {
+        ls.reuseport = b->mem.pos[nxt_sockaddr_size(sa)];
+    }
 
     nxt_debug(task, "listening socket \"%*s\"",
               (size_t) sa->length, nxt_sockaddr_start(sa));
@@ -1197,6 +1209,20 @@ nxt_main_listening_socket(nxt_sockaddr_t *sa, nxt_listening_socket_t *ls)
         goto fail;
     }
 
+#ifdef SO_REUSEPORT
+
+    if (ls->reuseport
+        && setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &enable, length) != 0)
+    {
+        ls->end = nxt_sprintf(ls->start, ls->end,
+                              "setsockopt(\\\"%*s\\\", SO_REUSEPORT) failed %E",
+                              (size_t) sa->length, nxt_sockaddr_start(sa),
+                              nxt_errno);
+        goto fail;
+    }
+
+#endif
+
 #if (NXT_INET6)
 
     if (sa->u.sockaddr.sa_family == AF_INET6) {
@@ -1574,6 +1600,7 @@ nxt_main_port_conf_store_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     nxt_port_t     *ctl_port;
     nxt_runtime_t  *rt;
     u_char         ver[NXT_INT_T_LEN];
+    u_char         digest[NXT_CONF_DIGEST_LEN];
 
     rt = task->thread->runtime;
 
@@ -1630,6 +1657,19 @@ nxt_main_port_conf_store_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     ret = nxt_main_file_store(task, rt->conf_tmp, rt->conf, p, size);
 
     if (nxt_fast_path(ret == NXT_OK)) {
+        n = nxt_conf_digest(digest, p, size) - digest;
+
+        /*
+         * If the digest is not stored, the previous digest does not match
+         * the configuration, which is validated then on startup.
+         */
+
+        ret = nxt_main_file_store(task, rt->conf_digest_tmp, rt->conf_digest,
+                                  digest, n);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            nxt_alert(task, "failed to store configuration digest");
+        }
+
         goto cleanup;
     }
 
@@ -16,6 +16,9 @@
 #include <openssl/x509v3.h>
 #include <openssl/bio.h>
 #include <openssl/evp.h>
+#if (NXT_HAVE_OPENSSL_OCSP)
+#include <openssl/ocsp.h>
+#endif
 
 
 typedef struct {
@@ -25,12 +28,33 @@ typedef struct {
     int               ssl_error;
     uint8_t           times;      /* 2 bits */
     uint8_t           handshake;  /* 1 bit  */
+    uint8_t           job;        /* 1 bit  */
+    uint8_t           shutdown;   /* 1 bit  */
+    uint8_t           early;      /* 1 bit  */
+
+    /* Early data read before the handshake has been completed. */
+    nxt_buf_mem_t     early_data;
+
+    /* Dynamic record sizing state. */
+    nxt_uint_t        records;
+    nxt_msec_t        last_write;
+    size_t            write_size;
 
     nxt_tls_conf_t    *conf;
     nxt_buf_mem_t     buffer;
 } nxt_openssl_conn_t;
 
 
+/* The maximum DNS host name length. */
+#define NXT_TLS_SERVERNAME_LEN  255
+
+
+#if OPENSSL_VERSION_NUMBER < 0x10100003L
+#define SSL_CTX_up_ref(ctx)                                                   \
+    CRYPTO_add(&(ctx)->references, 1, CRYPTO_LOCK_SSL_CTX)
+#endif
+
+
 struct nxt_tls_ticket_s {
     u_char            name[16];
     u_char            hmac_key[32];
@@ -45,6 +69,48 @@ struct nxt_tls_tickets_s {
 };
 
 
+#if (NXT_HAVE_OPENSSL_OCSP)
+
+/*
+ * The OCSP response of a certificate is shared by all listeners with
+ * the same responses directory and is kept by the router across
+ * reconfigurations while the certificate is used.
+ */
+
+typedef struct {
+    nxt_queue_link_t       link;
+
+    /* The number of certificate bundles using the response. */
+    nxt_atomic_t           count;
+
+    nxt_thread_spinlock_t  lock;
+
+    /* The response is replaced under the lock. */
+    u_char                 *response;
+    size_t                 length;
+    nxt_time_t             expire;
+    nxt_time_t             mtime;
+
+    nxt_time_t             refresh;
+    nxt_time_t             interval;
+
+    OCSP_CERTID            *id;
+    nxt_file_name_t        *file;
+    nxt_str_t              name;
+} nxt_openssl_ocsp_t;
+
+#endif
+
+
+typedef struct {
+    nxt_job_t         job;
+    nxt_task_t        task;
+
+    void              *data;
+    nxt_int_t         n;
+} nxt_openssl_handshake_job_t;
+
+
 typedef enum {
     NXT_OPENSSL_HANDSHAKE = 0,
     NXT_OPENSSL_READ,
@@ -65,6 +131,14 @@ static nxt_int_t nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
     nxt_tls_init_t *tls_init, nxt_bool_t last);
 static nxt_int_t nxt_openssl_chain_file(nxt_task_t *task, SSL_CTX *ctx,
     nxt_tls_conf_t *conf, nxt_mp_t *mp, nxt_bool_t single);
+static nxt_int_t nxt_openssl_chain(nxt_task_t *task, SSL_CTX *ctx, BIO *bio,
+    nxt_tls_bundle_conf_t *bundle, nxt_tls_conf_t *conf, nxt_mp_t *mp);
+static nxt_int_t nxt_openssl_bundle_load(nxt_task_t *task,
+    nxt_tls_init_t *tls_init, nxt_mp_t *mp);
+static SSL_CTX *nxt_openssl_bundle_ctx(nxt_task_t *task, nxt_tls_conf_t *conf,
+    nxt_tls_bundle_conf_t *bundle);
+static nxt_int_t nxt_openssl_ca_certificate(nxt_task_t *task, SSL_CTX *ctx,
+    nxt_tls_conf_t *conf);
 #if (NXT_HAVE_OPENSSL_CONF_CMD)
 static nxt_int_t nxt_ssl_conf_commands(nxt_task_t *task, SSL_CTX *ctx,
     nxt_conf_value_t *value, nxt_mp_t *mp);
@@ -75,8 +149,33 @@ static nxt_int_t nxt_tls_ticket_keys(nxt_task_t *task, SSL_CTX *ctx,
 static int nxt_tls_ticket_key_callback(SSL *s, unsigned char *name,
     unsigned char *iv, EVP_CIPHER_CTX *ectx,HMAC_CTX *hctx, int enc);
 #endif
-static void nxt_ssl_session_cache(SSL_CTX *ctx, size_t cache_size,
-    time_t timeout);
+static nxt_int_t nxt_ssl_session_cache(nxt_task_t *task, SSL_CTX *ctx,
+    nxt_tls_init_t *tls_init);
+static nxt_tls_session_cache_t *nxt_ssl_session_conn_cache(SSL *s);
+static int nxt_ssl_session_new(SSL *s, SSL_SESSION *sess);
+#if OPENSSL_VERSION_NUMBER >= 0x10100003L
+static SSL_SESSION *nxt_ssl_session_get(SSL *s, const unsigned char *id,
+    int len, int *copy);
+#else
+static SSL_SESSION *nxt_ssl_session_get(SSL *s, unsigned char *id, int len,
+    int *copy);
+#endif
+static void nxt_ssl_session_remove(SSL_CTX *ctx, SSL_SESSION *sess);
+#if (NXT_HAVE_OPENSSL_OCSP)
+static nxt_int_t nxt_openssl_ocsp_create(nxt_task_t *task,
+    nxt_tls_init_t *tls_init, nxt_tls_bundle_conf_t *bundle, X509 *cert,
+    X509 *issuer);
+static void nxt_openssl_ocsp_timer(nxt_event_engine_t *engine);
+static void nxt_openssl_ocsp_refresh(nxt_task_t *task, void *obj, void *data);
+static void nxt_openssl_ocsp_update(nxt_task_t *task, nxt_openssl_ocsp_t *ocsp,
+    nxt_time_t now);
+static int nxt_openssl_ocsp_status(SSL *s, void *arg);
+static void nxt_openssl_ocsp_free(nxt_openssl_ocsp_t *ocsp);
+#endif
+#if (NXT_HAVE_OPENSSL_EARLY_DATA)
+static int nxt_openssl_early_data_allow(SSL *s, void *arg);
+static nxt_int_t nxt_openssl_conn_early_data(nxt_task_t *task, nxt_conn_t *c);
+#endif
 static nxt_uint_t nxt_openssl_cert_get_names(nxt_task_t *task, X509 *cert,
     nxt_tls_conf_t *conf, nxt_mp_t *mp);
 static nxt_int_t nxt_openssl_bundle_hash_test(nxt_lvlhsh_query_t *lhq,
@@ -90,6 +189,14 @@ static void nxt_openssl_server_free(nxt_task_t *task, nxt_tls_conf_t *conf);
 static void nxt_openssl_conn_init(nxt_task_t *task, nxt_tls_conf_t *conf,
     nxt_conn_t *c);
 static void nxt_openssl_conn_handshake(nxt_task_t *task, void *obj, void *data);
+static void nxt_openssl_conn_handshake_result(nxt_task_t *task, nxt_conn_t *c,
+    void *data, nxt_int_t n);
+static nxt_int_t nxt_openssl_conn_handshake_job(nxt_task_t *task,
+    nxt_conn_t *c, void *data);
+static void nxt_openssl_conn_handshake_thread(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_openssl_conn_handshake_return(nxt_task_t *task, void *obj,
+    void *data);
 static ssize_t nxt_openssl_conn_io_recvbuf(nxt_conn_t *c, nxt_buf_t *b);
 static ssize_t nxt_openssl_conn_io_sendbuf(nxt_task_t *task, nxt_sendbuf_t *sb);
 static ssize_t nxt_openssl_conn_io_send(nxt_task_t *task, nxt_sendbuf_t *sb,
@@ -98,6 +205,10 @@ static void nxt_openssl_conn_io_shutdown(nxt_task_t *task, void *obj,
     void *data);
 static nxt_int_t nxt_openssl_conn_test_error(nxt_task_t *task, nxt_conn_t *c,
     int ret, nxt_err_t sys_err, nxt_openssl_io_t io);
+static nxt_int_t nxt_openssl_conn_ssl_error(nxt_task_t *task, nxt_conn_t *c,
+    int ret, nxt_err_t sys_err);
+static void nxt_openssl_conn_io_wait(nxt_task_t *task, nxt_conn_t *c,
+    nxt_openssl_io_t io);
 static void nxt_openssl_conn_io_shutdown_timeout(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_cdecl nxt_openssl_conn_error(nxt_task_t *task,
@@ -125,8 +236,37 @@ static nxt_conn_io_t  nxt_openssl_conn_io = {
 };
 
 
+#if (NXT_HAVE_OPENSSL_KTLS)
+
+/*
+ * Once the kernel encrypts TLS records on its own, the response is sent
+ * with plain writev() and sendfile().  The reading side still goes through
+ * SSL_read(), which uses the kernel decryption if it was enabled too, and
+ * handles TLS alerts and post-handshake messages anyway.
+ */
+
+static nxt_conn_io_t  nxt_openssl_ktls_conn_io = {
+    .read = nxt_conn_io_read,
+    .recvbuf = nxt_openssl_conn_io_recvbuf,
+
+    .write = nxt_conn_io_write,
+    .sendbuf = nxt_conn_io_sendbuf,
+
+    .shutdown = nxt_openssl_conn_io_shutdown,
+};
+
+#endif
+
+
 static long  nxt_openssl_version;
 static int   nxt_openssl_connection_index;
+static int   nxt_openssl_session_cache_index;
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+/* The OCSP responses are used and refreshed by the router only. */
+static nxt_queue_t  nxt_openssl_ocsps;
+static nxt_timer_t  nxt_openssl_ocsp_refresh_timer;
+#endif
 
 
 static nxt_int_t
@@ -198,6 +338,20 @@ nxt_openssl_library_init(nxt_task_t *task)
 
     nxt_openssl_connection_index = index;
 
+    index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+
+    if (index == -1) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "SSL_CTX_get_ex_new_index() failed");
+        return NXT_ERROR;
+    }
+
+    nxt_openssl_session_cache_index = index;
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+    nxt_queue_init(&nxt_openssl_ocsps);
+#endif
+
     return NXT_OK;
 }
 
@@ -295,10 +449,26 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
     nxt_tls_init_t *tls_init, nxt_bool_t last)
 {
     SSL_CTX                *ctx;
-    const char             *ca_certificate;
     nxt_tls_conf_t         *conf;
-    STACK_OF(X509_NAME)    *list;
     nxt_tls_bundle_conf_t  *bundle;
+#if (NXT_HAVE_OPENSSL_OCSP)
+    X509                   *issuer;
+    STACK_OF(X509)         *chain;
+#endif
+
+    conf = tls_init->conf;
+
+    bundle = conf->bundle;
+    nxt_assert(bundle != NULL);
+
+    if (!last) {
+        /*
+         * A certificate selected by SNI, the connection settings are taken
+         * from the default certificate context, so the certificate context
+         * is created on first use.
+         */
+        return nxt_openssl_bundle_load(task, tls_init, mp);
+    }
 
     ctx = SSL_CTX_new(SSLv23_server_method());
     if (ctx == NULL) {
@@ -306,11 +476,6 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
         return NXT_ERROR;
     }
 
-    conf = tls_init->conf;
-
-    bundle = conf->bundle;
-    nxt_assert(bundle != NULL);
-
     bundle->ctx = ctx;
 
 #ifdef SSL_OP_NO_RENEGOTIATION
@@ -344,12 +509,29 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
 
 #endif
 
-    if (nxt_openssl_chain_file(task, ctx, conf, mp,
-                               last && bundle->next == NULL)
+    if (nxt_openssl_chain_file(task, ctx, conf, mp, bundle->next == NULL)
         != NXT_OK)
     {
         goto fail;
     }
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+    if (tls_init->ocsp_responses.length != 0) {
+        SSL_CTX_get0_chain_certs(ctx, &chain);
+
+        issuer = (sk_X509_num(chain) > 0) ? sk_X509_value(chain, 0) : NULL;
+
+        if (nxt_openssl_ocsp_create(task, tls_init, bundle,
+                                    SSL_CTX_get0_certificate(ctx), issuer)
+            != NXT_OK)
+        {
+            goto fail;
+        }
+
+        SSL_CTX_set_tlsext_status_cb(ctx, nxt_openssl_ocsp_status);
+        SSL_CTX_set_tlsext_status_arg(ctx, bundle->ocsp);
+    }
+#endif
 /*
     key = conf->certificate_key;
 
@@ -378,7 +560,33 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
     }
 #endif
 
-    nxt_ssl_session_cache(ctx, tls_init->cache_size, tls_init->timeout);
+    if (nxt_ssl_session_cache(task, ctx, tls_init) != NXT_OK) {
+        goto fail;
+    }
+
+#if (NXT_HAVE_OPENSSL_KTLS)
+    if (tls_init->ktls) {
+        /* kTLS is used only if the kernel supports the negotiated cipher. */
+        SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+    }
+#endif
+
+#if (NXT_HAVE_OPENSSL_EARLY_DATA)
+    if (tls_init->early_data != 0) {
+        /*
+         * The OpenSSL replay protection relies on its internal session
+         * cache, which is local to a router thread, so the shared window
+         * of ClientHello randoms is used instead.
+         */
+
+        SSL_CTX_set_options(ctx, SSL_OP_NO_ANTI_REPLAY);
+
+        SSL_CTX_set_max_early_data(ctx, tls_init->early_data);
+        SSL_CTX_set_recv_max_early_data(ctx, tls_init->early_data);
+        SSL_CTX_set_allow_early_data_cb(ctx, nxt_openssl_early_data_allow,
+                                        tls_init->early_data_hellos);
+    }
+#endif
 
 #if (NXT_HAVE_OPENSSL_TLSEXT)
     if (nxt_tls_ticket_keys(task, ctx, tls_init, mp) != NXT_OK) {
@@ -388,47 +596,25 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
 
     SSL_CTX_set_options(ctx, SSL_OP_CIPHER_SERVER_PREFERENCE);
 
-    if (conf->ca_certificate != NULL) {
-
-        /* TODO: verify callback */
-        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, NULL);
-
-        /* TODO: verify depth */
-        SSL_CTX_set_verify_depth(ctx, 1);
-
-        ca_certificate = conf->ca_certificate;
+    if (nxt_openssl_ca_certificate(task, ctx, conf) != NXT_OK) {
+        goto fail;
+    }
 
-        if (SSL_CTX_load_verify_locations(ctx, ca_certificate, NULL) == 0) {
-            nxt_openssl_log_error(task, NXT_LOG_ALERT,
-                              "SSL_CTX_load_verify_locations(\"%s\") failed",
-                              ca_certificate);
-            goto fail;
-        }
+    conf->conn_init = nxt_openssl_conn_init;
 
-        list = SSL_load_client_CA_file(ca_certificate);
+    if (bundle->next != NULL) {
+        nxt_queue_init(&conf->contexts);
 
-        if (list == NULL) {
-            nxt_openssl_log_error(task, NXT_LOG_ALERT,
-                              "SSL_load_client_CA_file(\"%s\") failed",
-                              ca_certificate);
-            goto fail;
+#if (NXT_HAVE_OPENSSL_CONF_CMD)
+        if (tls_init->conf_cmds != NULL) {
+            conf->conf_cmds = nxt_conf_clone(mp, NULL, tls_init->conf_cmds);
+            if (nxt_slow_path(conf->conf_cmds == NULL)) {
+                goto fail;
+            }
         }
+#endif
 
-        /*
-         * SSL_load_client_CA_file() in OpenSSL prior to 0.9.7h and
-         * 0.9.8 versions always leaves an error in the error queue.
-         */
-        ERR_clear_error();
-
-        SSL_CTX_set_client_CA_list(ctx, list);
-    }
-
-    if (last) {
-        conf->conn_init = nxt_openssl_conn_init;
-
-        if (bundle->next != NULL) {
-            SSL_CTX_set_tlsext_servername_callback(ctx, nxt_openssl_servername);
-        }
+        SSL_CTX_set_tlsext_servername_callback(ctx, nxt_openssl_servername);
     }
 
     return NXT_OK;
@@ -436,6 +622,7 @@ nxt_openssl_server_init(nxt_task_t *task, nxt_mp_t *mp,
 fail:
 
     SSL_CTX_free(ctx);
+    bundle->ctx = NULL;
 
 #if (OPENSSL_VERSION_NUMBER >= 0x1010100fL \
      && OPENSSL_VERSION_NUMBER < 0x1010101fL)
@@ -451,24 +638,38 @@ nxt_openssl_chain_file(nxt_task_t *task, SSL_CTX *ctx, nxt_tls_conf_t *conf,
     nxt_mp_t *mp, nxt_bool_t single)
 {
     BIO                    *bio;
-    X509                   *cert, *ca;
-    long                   reason;
-    EVP_PKEY               *key;
     nxt_int_t              ret;
     nxt_tls_bundle_conf_t  *bundle;
 
-    ret = NXT_ERROR;
-    cert = NULL;
+    bundle = conf->bundle;
 
     bio = BIO_new(BIO_s_fd());
     if (bio == NULL) {
-        goto end;
+        nxt_openssl_log_error(task, NXT_LOG_ALERT, "BIO_new() failed");
+        return NXT_ERROR;
     }
 
-    bundle = conf->bundle;
-
     BIO_set_fd(bio, bundle->chain_file, BIO_CLOSE);
 
+    ret = nxt_openssl_chain(task, ctx, bio, bundle, single ? NULL : conf, mp);
+
+    BIO_free(bio);
+
+    return ret;
+}
+
+
+static nxt_int_t
+nxt_openssl_chain(nxt_task_t *task, SSL_CTX *ctx, BIO *bio,
+    nxt_tls_bundle_conf_t *bundle, nxt_tls_conf_t *conf, nxt_mp_t *mp)
+{
+    X509       *cert, *ca;
+    long       reason;
+    EVP_PKEY   *key;
+    nxt_int_t  ret;
+
+    ret = NXT_ERROR;
+
     cert = PEM_read_bio_X509_AUX(bio, NULL, NULL, NULL);
     if (cert == NULL) {
         goto end;
@@ -478,7 +679,9 @@ nxt_openssl_chain_file(nxt_task_t *task, SSL_CTX *ctx, nxt_tls_conf_t *conf,
         goto end;
     }
 
-    if (!single && nxt_openssl_cert_get_names(task, cert, conf, mp) != NXT_OK) {
+    if (conf != NULL
+        && nxt_openssl_cert_get_names(task, cert, conf, mp) != NXT_OK)
+    {
         goto clean;
     }
 
@@ -510,7 +713,9 @@ nxt_openssl_chain_file(nxt_task_t *task, SSL_CTX *ctx, nxt_tls_conf_t *conf,
         }
     }
 
-    if (BIO_reset(bio) != 0) {
+    /* BIO_reset() returns 0 for file descriptor BIOs and 1 for memory BIOs. */
+
+    if (BIO_reset(bio) < 0) {
         goto end;
     }
 
@@ -529,125 +734,390 @@ nxt_openssl_chain_file(nxt_task_t *task, SSL_CTX *ctx, nxt_tls_conf_t *conf,
 
     if (ret != NXT_OK) {
         nxt_openssl_log_error(task, NXT_LOG_ALERT,
-                              "nxt_openssl_chain_file() failed");
+                              "loading certificate \"%V\" failed",
+                              &bundle->name);
     }
 
 clean:
 
-    BIO_free(bio);
     X509_free(cert);
 
     return ret;
 }
 
 
-#if (NXT_HAVE_OPENSSL_CONF_CMD)
+/*
+ * The chain of a certificate selected by SNI is kept in memory, only its
+ * names are extracted here, the context is created by nxt_openssl_bundle_ctx().
+ */
 
 static nxt_int_t
-nxt_ssl_conf_commands(nxt_task_t *task, SSL_CTX *ctx, nxt_conf_value_t *conf,
+nxt_openssl_bundle_load(nxt_task_t *task, nxt_tls_init_t *tls_init,
     nxt_mp_t *mp)
 {
-    int               ret;
-    char              *zcmd, *zvalue;
-    uint32_t          index;
-    nxt_str_t         cmd, value;
-    SSL_CONF_CTX      *cctx;
-    nxt_conf_value_t  *member;
+    BIO                    *bio;
+    X509                   *cert;
+    ssize_t                n;
+    nxt_int_t              ret;
+    nxt_file_t             file;
+    nxt_tls_conf_t         *conf;
+    nxt_file_info_t        fi;
+    nxt_tls_bundle_conf_t  *bundle;
+#if (NXT_HAVE_OPENSSL_OCSP)
+    X509                   *issuer;
+#endif
 
-    cctx = SSL_CONF_CTX_new();
-    if (nxt_slow_path(cctx == NULL)) {
-        nxt_openssl_log_error(task, NXT_LOG_ALERT,
-                              "SSL_CONF_CTX_new() failed");
-        return NXT_ERROR;
-    }
+    conf = tls_init->conf;
+    bundle = conf->bundle;
 
-    SSL_CONF_CTX_set_flags(cctx, SSL_CONF_FLAG_FILE
-                                 | SSL_CONF_FLAG_SERVER
-                                 | SSL_CONF_FLAG_CERTIFICATE
-                                 | SSL_CONF_FLAG_SHOW_ERRORS);
+    bundle->ctx = NULL;
+    nxt_str_null(&bundle->chain);
 
-    SSL_CONF_CTX_set_ssl_ctx(cctx, ctx);
+    nxt_memzero(&file, sizeof(nxt_file_t));
 
-    index = 0;
+    file.fd = bundle->chain_file;
+    file.name = (nxt_file_name_t *) "certificate";
 
-    for ( ;; ) {
-        member = nxt_conf_next_object_member(conf, &cmd, &index);
-        if (nxt_slow_path(member == NULL)) {
-            break;
-        }
+    ret = NXT_ERROR;
 
-        nxt_conf_get_string(member, &value);
+    if (nxt_file_info(&file, &fi) != NXT_OK) {
+        goto done;
+    }
 
-        zcmd = nxt_str_cstrz(mp, &cmd);
-        zvalue = nxt_str_cstrz(mp, &value);
+    bundle->chain.length = nxt_file_size(&fi);
 
-        if (nxt_slow_path(zcmd == NULL || zvalue == NULL)) {
-            goto fail;
-        }
+    bundle->chain.start = nxt_mp_nget(mp, bundle->chain.length);
+    if (nxt_slow_path(bundle->chain.start == NULL)) {
+        goto done;
+    }
 
-        ret = SSL_CONF_cmd(cctx, zcmd, zvalue);
-        if (ret == -2) {
-            nxt_openssl_log_error(task, NXT_LOG_ERR,
-                                  "unknown command \"%s\" in "
-                                  "\"conf_commands\" option", zcmd);
-            goto fail;
-        }
+    n = nxt_file_read(&file, bundle->chain.start, bundle->chain.length, 0);
 
-        if (ret <= 0) {
-            nxt_openssl_log_error(task, NXT_LOG_ERR,
-                                  "invalid value \"%s\" for command \"%s\" "
-                                  "in \"conf_commands\" option",
-                                  zvalue, zcmd);
-            goto fail;
-        }
+    if (n != (ssize_t) bundle->chain.length) {
+        goto done;
+    }
 
-        nxt_debug(task, "SSL_CONF_cmd(\"%s\", \"%s\")", zcmd, zvalue);
+    bio = BIO_new_mem_buf(bundle->chain.start, bundle->chain.length);
+    if (bio == NULL) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT, "BIO_new_mem_buf() failed");
+        goto done;
     }
 
-    if (SSL_CONF_CTX_finish(cctx) != 1) {
+    cert = PEM_read_bio_X509_AUX(bio, NULL, NULL, NULL);
+
+    if (cert == NULL) {
+        BIO_free(bio);
+
         nxt_openssl_log_error(task, NXT_LOG_ALERT,
-                              "SSL_CONF_finish() failed");
-        goto fail;
+                              "loading certificate \"%V\" failed",
+                              &bundle->name);
+        goto done;
     }
 
-    SSL_CONF_CTX_free(cctx);
+    ret = nxt_openssl_cert_get_names(task, cert, conf, mp);
 
-    return NXT_OK;
+#if (NXT_HAVE_OPENSSL_OCSP)
+    if (ret == NXT_OK && tls_init->ocsp_responses.length != 0) {
+        issuer = PEM_read_bio_X509(bio, NULL, NULL, NULL);
+        ERR_clear_error();
 
-fail:
+        ret = nxt_openssl_ocsp_create(task, tls_init, bundle, cert, issuer);
 
-    SSL_CONF_CTX_free(cctx);
+        X509_free(issuer);
+    }
+#endif
 
-    return NXT_ERROR;
+    BIO_free(bio);
+    X509_free(cert);
+
+done:
+
+    nxt_fd_close(bundle->chain_file);
+
+    return ret;
 }
 
+
+static SSL_CTX *
+nxt_openssl_bundle_ctx(nxt_task_t *task, nxt_tls_conf_t *conf,
+    nxt_tls_bundle_conf_t *bundle)
+{
+    BIO                    *bio;
+    SSL_CTX                *ctx, *old;
+    nxt_queue_link_t       *lnk;
+    nxt_tls_bundle_conf_t  *lru;
+#if (NXT_HAVE_OPENSSL_CONF_CMD)
+    nxt_mp_t               *mp;
+    nxt_int_t              ret;
 #endif
 
-#if (NXT_HAVE_OPENSSL_TLSEXT)
+    nxt_thread_spin_lock(&conf->contexts_lock);
 
-static nxt_int_t
-nxt_tls_ticket_keys(nxt_task_t *task, SSL_CTX *ctx, nxt_tls_init_t *tls_init,
-    nxt_mp_t *mp)
-{
-    size_t             len;
-    uint32_t           i;
-    nxt_str_t          value;
-    nxt_uint_t         count;
-    nxt_conf_value_t   *member, *tickets_conf;
-    nxt_tls_ticket_t   *ticket;
-    nxt_tls_tickets_t  *tickets;
-    u_char             buf[80];
+    ctx = bundle->ctx;
 
-    tickets_conf = tls_init->tickets_conf;
+    if (ctx != NULL) {
+        SSL_CTX_up_ref(ctx);
 
-    if (tickets_conf == NULL) {
-        goto no_ticket;
+        nxt_queue_remove(&bundle->link);
+        nxt_queue_insert_head(&conf->contexts, &bundle->link);
     }
 
-    if (nxt_conf_type(tickets_conf) == NXT_CONF_BOOLEAN) {
-        if (nxt_conf_get_boolean(tickets_conf) == 0) {
-            goto no_ticket;
-        }
+    nxt_thread_spin_unlock(&conf->contexts_lock);
+
+    if (ctx != NULL) {
+        return ctx;
+    }
+
+    ctx = SSL_CTX_new(SSLv23_server_method());
+    if (ctx == NULL) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT, "SSL_CTX_new() failed");
+        return NULL;
+    }
+
+    bio = BIO_new_mem_buf(bundle->chain.start, bundle->chain.length);
+    if (bio == NULL) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT, "BIO_new_mem_buf() failed");
+        goto fail;
+    }
+
+    if (nxt_openssl_chain(task, ctx, bio, bundle, NULL, NULL) != NXT_OK) {
+        BIO_free(bio);
+        goto fail;
+    }
+
+    BIO_free(bio);
+
+#if (NXT_HAVE_OPENSSL_CONF_CMD)
+    if (conf->conf_cmds != NULL) {
+        mp = nxt_mp_create(1024, 128, 256, 32);
+        if (nxt_slow_path(mp == NULL)) {
+            goto fail;
+        }
+
+        ret = nxt_ssl_conf_commands(task, ctx, conf->conf_cmds, mp);
+
+        nxt_mp_destroy(mp);
+
+        if (ret != NXT_OK) {
+            goto fail;
+        }
+    }
+#endif
+
+    if (nxt_openssl_ca_certificate(task, ctx, conf) != NXT_OK) {
+        goto fail;
+    }
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+    if (bundle->ocsp != NULL) {
+        SSL_CTX_set_tlsext_status_cb(ctx, nxt_openssl_ocsp_status);
+        SSL_CTX_set_tlsext_status_arg(ctx, bundle->ocsp);
+    }
+#endif
+
+    nxt_debug(task, "tls context for \"%V\" is created", &bundle->name);
+
+    old = NULL;
+
+    nxt_thread_spin_lock(&conf->contexts_lock);
+
+    if (bundle->ctx != NULL) {
+        /* The context has been created by another thread meanwhile. */
+        old = ctx;
+        ctx = bundle->ctx;
+
+        nxt_queue_remove(&bundle->link);
+
+    } else {
+        bundle->ctx = ctx;
+
+        if (conf->ncontexts == NXT_TLS_CONTEXTS) {
+            lnk = nxt_queue_last(&conf->contexts);
+            nxt_queue_remove(lnk);
+
+            lru = nxt_queue_link_data(lnk, nxt_tls_bundle_conf_t, link);
+
+            old = lru->ctx;
+            lru->ctx = NULL;
+
+        } else {
+            conf->ncontexts++;
+        }
+    }
+
+    nxt_queue_insert_head(&conf->contexts, &bundle->link);
+
+    SSL_CTX_up_ref(ctx);
+
+    nxt_thread_spin_unlock(&conf->contexts_lock);
+
+    /* The connections using the context keep their own references. */
+    SSL_CTX_free(old);
+
+    return ctx;
+
+fail:
+
+    SSL_CTX_free(ctx);
+
+    return NULL;
+}
+
+
+static nxt_int_t
+nxt_openssl_ca_certificate(nxt_task_t *task, SSL_CTX *ctx,
+    nxt_tls_conf_t *conf)
+{
+    const char           *ca_certificate;
+    STACK_OF(X509_NAME)  *list;
+
+    if (conf->ca_certificate == NULL) {
+        return NXT_OK;
+    }
+
+    /* TODO: verify callback */
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, NULL);
+
+    /* TODO: verify depth */
+    SSL_CTX_set_verify_depth(ctx, 1);
+
+    ca_certificate = conf->ca_certificate;
+
+    if (SSL_CTX_load_verify_locations(ctx, ca_certificate, NULL) == 0) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "SSL_CTX_load_verify_locations(\"%s\") failed",
+                              ca_certificate);
+        return NXT_ERROR;
+    }
+
+    list = SSL_load_client_CA_file(ca_certificate);
+
+    if (list == NULL) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "SSL_load_client_CA_file(\"%s\") failed",
+                              ca_certificate);
+        return NXT_ERROR;
+    }
+
+    /*
+     * SSL_load_client_CA_file() in OpenSSL prior to 0.9.7h and
+     * 0.9.8 versions always leaves an error in the error queue.
+     */
+    ERR_clear_error();
+
+    SSL_CTX_set_client_CA_list(ctx, list);
+
+    return NXT_OK;
+}
+
+
+#if (NXT_HAVE_OPENSSL_CONF_CMD)
+
+static nxt_int_t
+nxt_ssl_conf_commands(nxt_task_t *task, SSL_CTX *ctx, nxt_conf_value_t *conf,
+    nxt_mp_t *mp)
+{
+    int               ret;
+    char              *zcmd, *zvalue;
+    uint32_t          index;
+    nxt_str_t         cmd, value;
+    SSL_CONF_CTX      *cctx;
+    nxt_conf_value_t  *member;
+
+    cctx = SSL_CONF_CTX_new();
+    if (nxt_slow_path(cctx == NULL)) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "SSL_CONF_CTX_new() failed");
+        return NXT_ERROR;
+    }
+
+    SSL_CONF_CTX_set_flags(cctx, SSL_CONF_FLAG_FILE
+                                 | SSL_CONF_FLAG_SERVER
+                                 | SSL_CONF_FLAG_CERTIFICATE
+                                 | SSL_CONF_FLAG_SHOW_ERRORS);
+
+    SSL_CONF_CTX_set_ssl_ctx(cctx, ctx);
+
+    index = 0;
+
+    for ( ;; ) {
+        member = nxt_conf_next_object_member(conf, &cmd, &index);
+        if (nxt_slow_path(member == NULL)) {
+            break;
+        }
+
+        nxt_conf_get_string(member, &value);
+
+        zcmd = nxt_str_cstrz(mp, &cmd);
+        zvalue = nxt_str_cstrz(mp, &value);
+
+        if (nxt_slow_path(zcmd == NULL || zvalue == NULL)) {
+            goto fail;
+        }
+
+        ret = SSL_CONF_cmd(cctx, zcmd, zvalue);
+        if (ret == -2) {
+            nxt_openssl_log_error(task, NXT_LOG_ERR,
+                                  "unknown command \"%s\" in "
+                                  "\"conf_commands\" option", zcmd);
+            goto fail;
+        }
+
+        if (ret <= 0) {
+            nxt_openssl_log_error(task, NXT_LOG_ERR,
+                                  "invalid value \"%s\" for command \"%s\" "
+                                  "in \"conf_commands\" option",
+                                  zvalue, zcmd);
+            goto fail;
+        }
+
+        nxt_debug(task, "SSL_CONF_cmd(\"%s\", \"%s\")", zcmd, zvalue);
+    }
+
+    if (SSL_CONF_CTX_finish(cctx) != 1) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "SSL_CONF_finish() failed");
+        goto fail;
+    }
+
+    SSL_CONF_CTX_free(cctx);
+
+    return NXT_OK;
+
+fail:
+
+    SSL_CONF_CTX_free(cctx);
+
+    return NXT_ERROR;
+}
+
+#endif
+
+#if (NXT_HAVE_OPENSSL_TLSEXT)
+
+static nxt_int_t
+nxt_tls_ticket_keys(nxt_task_t *task, SSL_CTX *ctx, nxt_tls_init_t *tls_init,
+    nxt_mp_t *mp)
+{
+    size_t             len;
+    uint32_t           i;
+    nxt_str_t          value;
+    nxt_uint_t         count;
+    nxt_conf_value_t   *member, *tickets_conf;
+    nxt_tls_ticket_t   *ticket;
+    nxt_tls_tickets_t  *tickets;
+    u_char             buf[80];
+
+    tickets_conf = tls_init->tickets_conf;
+
+    if (tickets_conf == NULL) {
+        goto no_ticket;
+    }
+
+    if (nxt_conf_type(tickets_conf) == NXT_CONF_BOOLEAN) {
+        if (nxt_conf_get_boolean(tickets_conf) == 0) {
+            goto no_ticket;
+        }
 
         return NXT_OK;
     }
@@ -790,60 +1260,598 @@ nxt_tls_ticket_key_callback(SSL *s, unsigned char *name, unsigned char *iv,
 
         return 0;
 
-    found:
+    found:
+
+        nxt_debug(c->socket.task,
+                  "TLS session ticket decrypt, key number: \"%d\"", i);
+
+        enc = (i == 0) ? 1 : 2 /* renew */;
+
+        cipher = (ticket[i].size == 16) ? EVP_aes_128_cbc() : EVP_aes_256_cbc();
+
+        if (EVP_DecryptInit_ex(ectx, cipher, NULL, ticket[i].aes_key, iv) != 1)
+        {
+            nxt_openssl_log_error(c->socket.task, NXT_LOG_ALERT,
+                                  "EVP_DecryptInit_ex() failed");
+            return -1;
+        }
+    }
+
+#ifdef OPENSSL_NO_SHA256
+    digest = EVP_sha1();
+#else
+    digest = EVP_sha256();
+#endif
+
+    if (HMAC_Init_ex(hctx, ticket[i].hmac_key, ticket[i].size, digest, NULL)
+        != 1)
+    {
+        nxt_openssl_log_error(c->socket.task, NXT_LOG_ALERT,
+                              "HMAC_Init_ex() failed");
+        return -1;
+    }
+
+    return enc;
+}
+
+#endif /* SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB */
+
+#endif /* NXT_HAVE_OPENSSL_TLSEXT */
+
+
+static nxt_int_t
+nxt_ssl_session_cache(nxt_task_t *task, SSL_CTX *ctx, nxt_tls_init_t *tls_init)
+{
+    if (tls_init->cache_size == 0) {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+        return NXT_OK;
+    }
+
+    /*
+     * The sessions are kept only in the shared cache of the listener,
+     * which is not lost on reconfiguration and is used by all engines.
+     */
+
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER
+                                        | SSL_SESS_CACHE_NO_INTERNAL);
+
+    if (SSL_CTX_set_ex_data(ctx, nxt_openssl_session_cache_index,
+                            tls_init->session_cache)
+        == 0)
+    {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                              "SSL_CTX_set_ex_data() failed");
+        return NXT_ERROR;
+    }
+
+    SSL_CTX_sess_set_new_cb(ctx, nxt_ssl_session_new);
+    SSL_CTX_sess_set_get_cb(ctx, nxt_ssl_session_get);
+    SSL_CTX_sess_set_remove_cb(ctx, nxt_ssl_session_remove);
+
+    SSL_CTX_set_timeout(ctx, (long) tls_init->timeout);
+
+    return NXT_OK;
+}
+
+
+/*
+ * A context created for a certificate selected by SNI has no session
+ * cache set, so the cache is looked up via the connection configuration.
+ */
+
+static nxt_tls_session_cache_t *
+nxt_ssl_session_conn_cache(SSL *s)
+{
+    nxt_conn_t          *c;
+    nxt_openssl_conn_t  *tls;
+
+    c = SSL_get_ex_data(s, nxt_openssl_connection_index);
+
+    if (nxt_slow_path(c == NULL)) {
+        nxt_thread_log_alert("SSL_get_ex_data() failed");
+        return NULL;
+    }
+
+    tls = c->u.tls;
+
+    return tls->conf->session_cache;
+}
+
+
+static int
+nxt_ssl_session_new(SSL *s, SSL_SESSION *sess)
+{
+    int                      len;
+    u_char                   *p;
+    nxt_time_t               expire;
+    unsigned int             id_len;
+    const unsigned char      *id;
+    nxt_tls_session_cache_t  *cache;
+    u_char                   buf[NXT_TLS_SESSION_MAX_SIZE];
+
+    cache = nxt_ssl_session_conn_cache(s);
+    if (nxt_slow_path(cache == NULL)) {
+        return 0;
+    }
+
+    len = i2d_SSL_SESSION(sess, NULL);
+
+    if (len <= 0 || len > NXT_TLS_SESSION_MAX_SIZE) {
+        nxt_thread_log_debug("SSL session is not cached, size: %d", len);
+        return 0;
+    }
+
+    p = buf;
+    (void) i2d_SSL_SESSION(sess, &p);
+
+    id = SSL_SESSION_get_id(sess, &id_len);
+
+    expire = SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess);
+
+    (void) nxt_tls_session_cache_store(cache, id, id_len, buf, len, expire);
+
+    /* The session is not referenced by the cache. */
+
+    return 0;
+}
+
+
+static SSL_SESSION *
+#if OPENSSL_VERSION_NUMBER >= 0x10100003L
+nxt_ssl_session_get(SSL *s, const unsigned char *id, int len, int *copy)
+#else
+nxt_ssl_session_get(SSL *s, unsigned char *id, int len, int *copy)
+#endif
+{
+    ssize_t                  n;
+    const u_char             *p;
+    nxt_tls_session_cache_t  *cache;
+    u_char                   buf[NXT_TLS_SESSION_MAX_SIZE];
+
+    *copy = 0;
+
+    cache = nxt_ssl_session_conn_cache(s);
+    if (nxt_slow_path(cache == NULL)) {
+        return NULL;
+    }
+
+    n = nxt_tls_session_cache_fetch(cache, id, len, buf, sizeof(buf));
+
+    if (n == 0) {
+        return NULL;
+    }
+
+    p = buf;
+
+    return d2i_SSL_SESSION(NULL, &p, n);
+}
+
+
+static void
+nxt_ssl_session_remove(SSL_CTX *ctx, SSL_SESSION *sess)
+{
+    unsigned int             id_len;
+    const unsigned char      *id;
+    nxt_tls_session_cache_t  *cache;
+
+    cache = SSL_CTX_get_ex_data(ctx, nxt_openssl_session_cache_index);
+    if (nxt_slow_path(cache == NULL)) {
+        return;
+    }
+
+    id = SSL_SESSION_get_id(sess, &id_len);
+
+    nxt_tls_session_cache_remove(cache, id, id_len);
+}
+
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+
+static nxt_int_t
+nxt_openssl_ocsp_create(nxt_task_t *task, nxt_tls_init_t *tls_init,
+    nxt_tls_bundle_conf_t *bundle, X509 *cert, X509 *issuer)
+{
+    u_char              *p;
+    size_t              size;
+    nxt_time_t          now;
+    nxt_openssl_ocsp_t  *ocsp, *item;
+
+    size = tls_init->ocsp_responses.length + bundle->name.length + 2;
+
+    ocsp = nxt_zalloc(sizeof(nxt_openssl_ocsp_t) + size + bundle->name.length);
+    if (nxt_slow_path(ocsp == NULL)) {
+        return NXT_ERROR;
+    }
+
+    ocsp->file = (nxt_file_name_t *) (ocsp + 1);
+
+    p = nxt_cpymem(ocsp->file, tls_init->ocsp_responses.start,
+                   tls_init->ocsp_responses.length);
+    *p++ = '/';
+    p = nxt_cpymem(p, bundle->name.start, bundle->name.length);
+    *p++ = '\0';
+
+    ocsp->name.length = bundle->name.length;
+    ocsp->name.start = p;
+    nxt_memcpy(p, bundle->name.start, bundle->name.length);
+
+    /*
+     * Without the issuer certificate in the chain the certificate
+     * identifier cannot be built, the first response is used then.
+     */
+
+    if (issuer != NULL) {
+        ocsp->id = OCSP_cert_to_id(NULL, cert, issuer);
+        if (ocsp->id == NULL) {
+            nxt_openssl_log_error(task, NXT_LOG_ALERT,
+                                  "OCSP_cert_to_id() failed");
+            nxt_free(ocsp);
+            return NXT_ERROR;
+        }
+    }
+
+    /*
+     * The certificate may be replaced under the same name, so
+     * the response is shared only if the identifiers are equal.
+     */
+
+    now = nxt_thread_time(task->thread);
+
+    nxt_queue_each(item, &nxt_openssl_ocsps, nxt_openssl_ocsp_t, link) {
+
+        if (nxt_strcmp(item->file, ocsp->file) != 0) {
+            continue;
+        }
+
+        if (item->id == NULL || ocsp->id == NULL) {
+            if (item->id != ocsp->id) {
+                continue;
+            }
+
+        } else if (OCSP_id_cmp(item->id, ocsp->id) != 0) {
+            continue;
+        }
+
+        OCSP_CERTID_free(ocsp->id);
+        nxt_free(ocsp);
+
+        ocsp = item;
+
+        if (tls_init->ocsp_refresh < ocsp->interval) {
+            ocsp->interval = tls_init->ocsp_refresh;
+            ocsp->refresh = nxt_min(ocsp->refresh, now + ocsp->interval);
+        }
+
+        goto found;
+
+    } nxt_queue_loop;
+
+    ocsp->interval = tls_init->ocsp_refresh;
+
+    nxt_openssl_ocsp_update(task, ocsp, now);
+
+    ocsp->refresh = now + ocsp->interval;
+
+    nxt_queue_insert_tail(&nxt_openssl_ocsps, &ocsp->link);
+
+found:
+
+    (void) nxt_atomic_fetch_add(&ocsp->count, 1);
+
+    bundle->ocsp = ocsp;
+
+    nxt_openssl_ocsp_timer(task->thread->engine);
+
+    return NXT_OK;
+}
+
+
+/*
+ * The response files are checked by the router thread once in the refresh
+ * interval, so the file I/O does not delay handshakes, which only staple
+ * the current response.
+ */
+
+static void
+nxt_openssl_ocsp_timer(nxt_event_engine_t *engine)
+{
+    nxt_msec_t          timeout;
+    nxt_time_t          now, refresh;
+    nxt_timer_t         *timer;
+    nxt_openssl_ocsp_t  *ocsp;
+
+    if (nxt_queue_is_empty(&nxt_openssl_ocsps)) {
+        return;
+    }
+
+    refresh = NXT_TIME_T_MAX;
+
+    nxt_queue_each(ocsp, &nxt_openssl_ocsps, nxt_openssl_ocsp_t, link) {
+        refresh = nxt_min(refresh, ocsp->refresh);
+    } nxt_queue_loop;
+
+    now = nxt_thread_time(nxt_thread());
+
+    timeout = (refresh > now) ? (refresh - now) * 1000 : 0;
+
+    timer = &nxt_openssl_ocsp_refresh_timer;
+
+    timer->bias = NXT_TIMER_DEFAULT_BIAS;
+    timer->work_queue = &engine->fast_work_queue;
+    timer->handler = nxt_openssl_ocsp_refresh;
+    timer->task = &engine->task;
+    timer->log = timer->task->log;
+
+    nxt_timer_add(engine, timer, timeout);
+}
+
+
+static void
+nxt_openssl_ocsp_refresh(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_time_t          now;
+    nxt_openssl_ocsp_t  *ocsp;
+
+    now = nxt_thread_time(task->thread);
+
+    /*
+     * The references are taken only by the router thread while
+     * configuring, so an unused response cannot become used meanwhile.
+     */
+
+    nxt_queue_each(ocsp, &nxt_openssl_ocsps, nxt_openssl_ocsp_t, link) {
+
+        if (ocsp->count == 0) {
+            nxt_queue_remove(&ocsp->link);
+            nxt_openssl_ocsp_free(ocsp);
+            continue;
+        }
+
+        if (now >= ocsp->refresh) {
+            nxt_openssl_ocsp_update(task, ocsp, now);
+            ocsp->refresh = now + ocsp->interval;
+        }
+
+    } nxt_queue_loop;
+
+    nxt_openssl_ocsp_timer(task->thread->engine);
+}
+
+
+static void
+nxt_openssl_ocsp_update(nxt_task_t *task, nxt_openssl_ocsp_t *ocsp,
+    nxt_time_t now)
+{
+    int                   status, day, sec;
+    u_char                *buf, *old;
+    ssize_t               n;
+    nxt_file_t            file;
+    nxt_time_t            expire;
+    const u_char          *p;
+    OCSP_RESPONSE         *resp;
+    nxt_file_info_t       fi;
+    OCSP_BASICRESP        *basic;
+    OCSP_SINGLERESP       *single;
+    ASN1_GENERALIZEDTIME  *next;
+
+    nxt_memzero(&file, sizeof(nxt_file_t));
+
+    file.name = ocsp->file;
+
+    if (nxt_file_open(task, &file, NXT_FILE_RDONLY, NXT_FILE_OPEN, 0)
+        != NXT_OK)
+    {
+        return;
+    }
+
+    buf = NULL;
+    resp = NULL;
+    basic = NULL;
+
+    if (nxt_file_info(&file, &fi) != NXT_OK
+        || nxt_file_mtime(&fi) == ocsp->mtime)
+    {
+        goto done;
+    }
+
+    n = nxt_file_size(&fi);
+
+    if (n == 0 || n > NXT_TLS_OCSP_MAX_SIZE) {
+        nxt_log(task, NXT_LOG_WARN, "OCSP response \"%FN\" has invalid size",
+                file.name);
+        goto done;
+    }
+
+    buf = nxt_malloc(n);
+    if (nxt_slow_path(buf == NULL)) {
+        goto done;
+    }
+
+    if (nxt_file_read(&file, buf, n, 0) != n) {
+        goto done;
+    }
+
+    p = buf;
+
+    resp = d2i_OCSP_RESPONSE(NULL, &p, n);
+    if (resp == NULL) {
+        nxt_openssl_log_error(task, NXT_LOG_WARN,
+                              "d2i_OCSP_RESPONSE(\"%FN\") failed", file.name);
+        goto done;
+    }
+
+    status = OCSP_response_status(resp);
+
+    if (status != OCSP_RESPONSE_STATUS_SUCCESSFUL) {
+        nxt_log(task, NXT_LOG_WARN, "OCSP response \"%FN\" has status %d",
+                file.name, status);
+        goto done;
+    }
+
+    basic = OCSP_response_get1_basic(resp);
+    if (basic == NULL) {
+        nxt_openssl_log_error(task, NXT_LOG_WARN,
+                              "OCSP_response_get1_basic(\"%FN\") failed",
+                              file.name);
+        goto done;
+    }
+
+    next = NULL;
+
+    if (ocsp->id != NULL) {
+        if (OCSP_resp_find_status(basic, ocsp->id, &status, NULL, NULL, NULL,
+                                  &next)
+            != 1)
+        {
+            nxt_log(task, NXT_LOG_WARN, "OCSP response \"%FN\" has no status "
+                    "of certificate \"%V\"", file.name, &ocsp->name);
+            goto done;
+        }
+
+    } else {
+        single = OCSP_resp_get0(basic, 0);
+
+        if (single == NULL) {
+            nxt_log(task, NXT_LOG_WARN, "OCSP response \"%FN\" is empty",
+                    file.name);
+            goto done;
+        }
+
+        status = OCSP_single_get0_status(single, NULL, NULL, NULL, &next);
+    }
+
+    expire = NXT_TIME_T_MAX;
+
+    if (next != NULL) {
+        if (ASN1_TIME_diff(&day, &sec, NULL, next) != 1) {
+            goto done;
+        }
+
+        expire = now + (nxt_time_t) day * 86400 + sec;
+
+        if (expire <= now) {
+            nxt_log(task, NXT_LOG_WARN, "OCSP response \"%FN\" is expired",
+                    file.name);
+            goto done;
+        }
+    }
+
+    nxt_debug(task, "OCSP response \"%FN\" status:%d expire:%T",
+              file.name, status, expire);
+
+    nxt_thread_spin_lock(&ocsp->lock);
+
+    old = ocsp->response;
+
+    ocsp->response = buf;
+    ocsp->length = n;
+    ocsp->expire = expire;
+    ocsp->mtime = nxt_file_mtime(&fi);
+
+    nxt_thread_spin_unlock(&ocsp->lock);
+
+    buf = old;
+
+done:
+
+    OCSP_BASICRESP_free(basic);
+    OCSP_RESPONSE_free(resp);
+
+    if (buf != NULL) {
+        nxt_free(buf);
+    }
+
+    nxt_file_close(task, &file);
+}
+
+
+static int
+nxt_openssl_ocsp_status(SSL *s, void *arg)
+{
+    u_char              *p;
+    nxt_conn_t          *c;
+    nxt_time_t          now;
+    nxt_openssl_ocsp_t  *ocsp;
+
+    ocsp = arg;
+
+    c = SSL_get_ex_data(s, nxt_openssl_connection_index);
+
+    if (nxt_slow_path(c == NULL)) {
+        nxt_thread_log_alert("SSL_get_ex_data() failed");
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+
+    now = nxt_thread_time(nxt_thread());
 
-        nxt_debug(c->socket.task,
-                  "TLS session ticket decrypt, key number: \"%d\"", i);
+    p = NULL;
 
-        enc = (i == 0) ? 1 : 2 /* renew */;
+    nxt_thread_spin_lock(&ocsp->lock);
 
-        cipher = (ticket[i].size == 16) ? EVP_aes_128_cbc() : EVP_aes_256_cbc();
+    if (ocsp->response != NULL && ocsp->expire > now) {
+        p = OPENSSL_malloc(ocsp->length);
 
-        if (EVP_DecryptInit_ex(ectx, cipher, NULL, ticket[i].aes_key, iv) != 1)
-        {
-            nxt_openssl_log_error(c->socket.task, NXT_LOG_ALERT,
-                                  "EVP_DecryptInit_ex() failed");
-            return -1;
+        if (p != NULL) {
+            nxt_memcpy(p, ocsp->response, ocsp->length);
+            SSL_set_tlsext_status_ocsp_resp(s, p, ocsp->length);
         }
     }
 
-#ifdef OPENSSL_NO_SHA256
-    digest = EVP_sha1();
-#else
-    digest = EVP_sha256();
-#endif
+    nxt_thread_spin_unlock(&ocsp->lock);
 
-    if (HMAC_Init_ex(hctx, ticket[i].hmac_key, ticket[i].size, digest, NULL)
-        != 1)
-    {
-        nxt_openssl_log_error(c->socket.task, NXT_LOG_ALERT,
-                              "HMAC_Init_ex() failed");
-        return -1;
+    nxt_debug(c->socket.task, "OCSP response for \"%V\" is %s", &ocsp->name,
+              (p != NULL) ? "stapled" : "not available");
+
+    return (p != NULL) ? SSL_TLSEXT_ERR_OK : SSL_TLSEXT_ERR_NOACK;
+}
+
+
+static void
+nxt_openssl_ocsp_free(nxt_openssl_ocsp_t *ocsp)
+{
+    OCSP_CERTID_free(ocsp->id);
+
+    if (ocsp->response != NULL) {
+        nxt_free(ocsp->response);
     }
 
-    return enc;
+    nxt_free(ocsp);
 }
 
-#endif /* SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB */
+#endif
 
-#endif /* NXT_HAVE_OPENSSL_TLSEXT */
 
+#if (NXT_HAVE_OPENSSL_EARLY_DATA)
 
-static void
-nxt_ssl_session_cache(SSL_CTX *ctx, size_t cache_size, time_t timeout)
+/*
+ * Early data of a ClientHello seen within the window are rejected,
+ * so the client resends the request after the handshake.
+ */
+
+static int
+nxt_openssl_early_data_allow(SSL *s, void *arg)
 {
-    if (cache_size == 0) {
-        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
-        return;
-    }
+    size_t                   len;
+    nxt_time_t               expire;
+    nxt_tls_session_cache_t  *hellos;
+    u_char                   random[SSL3_RANDOM_SIZE];
 
-    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    hellos = arg;
 
-    SSL_CTX_sess_set_cache_size(ctx, cache_size);
+    len = SSL_get_client_random(s, random, sizeof(random));
 
-    SSL_CTX_set_timeout(ctx, (long) timeout);
+    expire = nxt_thread_time(nxt_thread()) + NXT_TLS_EARLY_DATA_WINDOW;
+
+    if (nxt_tls_session_cache_insert(hellos, random, len, expire) != NXT_OK) {
+        nxt_thread_log_debug("SSL early data rejected");
+        return 0;
+    }
+
+    return 1;
 }
 
+#endif
+
 
 static nxt_uint_t
 nxt_openssl_cert_get_names(nxt_task_t *task, X509 *cert, nxt_tls_conf_t *conf,
@@ -1029,6 +2037,7 @@ nxt_openssl_bundle_hash_insert(nxt_task_t *task, nxt_lvlhsh_t *lvlhsh,
 static nxt_int_t
 nxt_openssl_servername(SSL *s, int *ad, void *arg)
 {
+    SSL_CTX                *ctx;
     nxt_str_t              str;
     nxt_uint_t             i;
     nxt_conn_t             *c;
@@ -1036,6 +2045,7 @@ nxt_openssl_servername(SSL *s, int *ad, void *arg)
     nxt_tls_conf_t         *conf;
     nxt_openssl_conn_t     *tls;
     nxt_tls_bundle_conf_t  *bundle;
+    u_char                 name[NXT_TLS_SERVERNAME_LEN];
 
     c = SSL_get_ex_data(s, nxt_openssl_connection_index);
 
@@ -1065,11 +2075,19 @@ nxt_openssl_servername(SSL *s, int *ad, void *arg)
 
     nxt_debug(c->socket.task, "tls with servername \"%s\"", servername);
 
-    str.start = nxt_mp_nget(c->mem_pool, str.length);
-    if (nxt_slow_path(str.start == NULL)) {
-        return SSL_TLSEXT_ERR_ALERT_FATAL;
+    /*
+     * The callback may run in a handshake thread pool,
+     * so the connection memory pool is not used here.
+     */
+
+    if (str.length > sizeof(name)) {
+        nxt_debug(c->socket.task, "ignored the server name \"%s\": "
+                                  "too long", servername);
+        goto done;
     }
 
+    str.start = name;
+
     nxt_memcpy_lowcase(str.start, (const u_char *) servername, str.length);
 
     tls = c->u.tls;
@@ -1095,12 +2113,22 @@ nxt_openssl_servername(SSL *s, int *ad, void *arg)
                                   &conf->bundle->name);
 
         if (bundle != conf->bundle) {
-            if (SSL_set_SSL_CTX(s, bundle->ctx) == NULL) {
+            ctx = nxt_openssl_bundle_ctx(c->socket.task, conf, bundle);
+            if (ctx == NULL) {
+                return SSL_TLSEXT_ERR_ALERT_FATAL;
+            }
+
+            if (SSL_set_SSL_CTX(s, ctx) == NULL) {
                 nxt_openssl_log_error(c->socket.task, NXT_LOG_ALERT,
                                       "SSL_set_SSL_CTX() failed");
 
+                SSL_CTX_free(ctx);
+
                 return SSL_TLSEXT_ERR_ALERT_FATAL;
             }
+
+            /* The connection holds its own reference to the context. */
+            SSL_CTX_free(ctx);
         }
     }
 
@@ -1136,12 +2164,25 @@ static void
 nxt_openssl_server_free(nxt_task_t *task, nxt_tls_conf_t *conf)
 {
     nxt_tls_bundle_conf_t  *bundle;
+#if (NXT_HAVE_OPENSSL_OCSP)
+    nxt_openssl_ocsp_t     *ocsp;
+#endif
 
     bundle = conf->bundle;
     nxt_assert(bundle != NULL);
 
+    /* Contexts of certificates selected by SNI may be not created yet. */
+
     do {
         SSL_CTX_free(bundle->ctx);
+
+#if (NXT_HAVE_OPENSSL_OCSP)
+        if (bundle->ocsp != NULL) {
+            ocsp = bundle->ocsp;
+            (void) nxt_atomic_fetch_add(&ocsp->count, -1);
+        }
+#endif
+
         bundle = bundle->next;
     } while (bundle != NULL);
 
@@ -1150,6 +2191,16 @@ nxt_openssl_server_free(nxt_task_t *task, nxt_tls_conf_t *conf)
                     conf->tickets->count * sizeof(nxt_tls_ticket_t));
     }
 
+    /* The router destroys the caches once they are not used. */
+
+    if (conf->session_cache != NULL) {
+        (void) nxt_atomic_fetch_add(&conf->session_cache->count, -1);
+    }
+
+    if (conf->early_data_hellos != NULL) {
+        (void) nxt_atomic_fetch_add(&conf->early_data_hellos->count, -1);
+    }
+
 #if (OPENSSL_VERSION_NUMBER >= 0x1010100fL \
      && OPENSSL_VERSION_NUMBER < 0x1010101fL)
     RAND_keep_random_devices_open(0);
@@ -1175,158 +2226,425 @@ nxt_openssl_conn_init(nxt_task_t *task, nxt_tls_conf_t *conf, nxt_conn_t *c)
     c->u.tls = tls;
     nxt_buf_mem_set_size(&tls->buffer, conf->buffer_size);
 
-    ctx = conf->bundle->ctx;
+    tls->early = (conf->early_data != 0);
+
+    ctx = conf->bundle->ctx;
+
+    s = SSL_new(ctx);
+    if (s == NULL) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT, "SSL_new() failed");
+        goto fail;
+    }
+
+    tls->session = s;
+    /* To pass TLS config to the nxt_openssl_servername() callback. */
+    tls->conf = conf;
+    tls->conn = c;
+
+    ret = SSL_set_fd(s, c->socket.fd);
+
+    if (ret == 0) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT, "SSL_set_fd(%d) failed",
+                              c->socket.fd);
+        goto fail;
+    }
+
+    SSL_set_accept_state(s);
+
+    if (SSL_set_ex_data(s, nxt_openssl_connection_index, c) == 0) {
+        nxt_openssl_log_error(task, NXT_LOG_ALERT, "SSL_set_ex_data() failed");
+        goto fail;
+    }
+
+    c->io = &nxt_openssl_conn_io;
+    c->sendfile = NXT_CONN_SENDFILE_OFF;
+
+    nxt_openssl_conn_handshake(task, c, c->socket.data);
+
+    return;
+
+fail:
+
+    nxt_work_queue_add(c->read_work_queue, c->read_state->error_handler,
+                       task, c, c->socket.data);
+}
+
+
+nxt_inline void
+nxt_openssl_conn_free(nxt_task_t *task, nxt_conn_t *c)
+{
+    nxt_openssl_conn_t  *tls;
+
+    nxt_debug(task, "openssl conn free");
+
+    tls = c->u.tls;
+
+    if (tls != NULL) {
+        c->u.tls = NULL;
+        nxt_free(tls->buffer.start);
+        SSL_free(tls->session);
+    }
+}
+
+
+static void
+nxt_openssl_conn_handshake(nxt_task_t *task, void *obj, void *data)
+{
+    int                 ret;
+    nxt_int_t           n;
+    nxt_err_t           err;
+    nxt_conn_t          *c;
+    nxt_openssl_conn_t  *tls;
+
+    c = obj;
+
+    nxt_debug(task, "openssl conn handshake fd:%d", c->socket.fd);
+
+    if (c->socket.error != 0) {
+        return;
+    }
+
+    tls = c->u.tls;
+
+    if (tls == NULL || tls->job) {
+        return;
+    }
+
+    nxt_debug(task, "openssl conn handshake: %d times", tls->times);
+
+#if (NXT_HAVE_OPENSSL_EARLY_DATA)
+    if (tls->early) {
+        n = nxt_openssl_conn_early_data(task, c);
+
+        if (n != NXT_DECLINED) {
+            nxt_openssl_conn_handshake_result(task, c, data, n);
+            return;
+        }
+    }
+#endif
+
+    /*
+     * A connection is initialized when ClientHello has already arrived,
+     * so each SSL_do_handshake() call does the handshake crypto.
+     */
+
+    if (tls->conf->offload != NULL
+        && nxt_openssl_conn_handshake_job(task, c, data) == NXT_OK)
+    {
+        return;
+    }
+
+    ret = SSL_do_handshake(tls->session);
+
+    err = (ret <= 0) ? nxt_socket_errno : 0;
+
+    nxt_thread_time_debug_update(task->thread);
+
+    nxt_debug(task, "SSL_do_handshake(%d): %d err:%d", c->socket.fd, ret, err);
+
+    if (ret > 0) {
+        /* ret == 1, the handshake was successfully completed. */
+        tls->handshake = 1;
+        n = NXT_OK;
+
+    } else {
+        n = nxt_openssl_conn_test_error(task, c, ret, err,
+                                        NXT_OPENSSL_HANDSHAKE);
+
+        if (n == NXT_ERROR) {
+            nxt_openssl_conn_error(task, err, "SSL_do_handshake(%d) failed",
+                                   c->socket.fd);
+        }
+    }
+
+    nxt_openssl_conn_handshake_result(task, c, data, n);
+}
+
+
+static void
+nxt_openssl_conn_handshake_result(nxt_task_t *task, nxt_conn_t *c, void *data,
+    nxt_int_t n)
+{
+    nxt_work_queue_t        *wq;
+    nxt_work_handler_t      handler;
+    nxt_openssl_conn_t      *tls;
+    const nxt_conn_state_t  *state;
+
+    tls = c->u.tls;
+
+    state = (c->read_state != NULL) ? c->read_state : c->write_state;
+
+    if (n == NXT_OK) {
+
+#if (NXT_HAVE_OPENSSL_KTLS)
+        if (tls->handshake && BIO_get_ktls_send(SSL_get_wbio(tls->session))) {
+            nxt_debug(task, "SSL kTLS send enabled, recv %s",
+                      BIO_get_ktls_recv(SSL_get_rbio(tls->session))
+                      ? "enabled" : "disabled");
+
+            c->io = &nxt_openssl_ktls_conn_io;
+            c->sendfile = NXT_CONN_SENDFILE_ON;
+        }
+#endif
+
+        if (c->read_state != NULL) {
+            if (state->io_read_handler != NULL || c->read != NULL) {
+                nxt_conn_read(task->thread->engine, c);
+                return;
+            }
+
+        } else {
+            if (c->write != NULL) {
+                nxt_conn_write(task->thread->engine, c);
+                return;
+            }
+        }
+
+        handler = state->ready_handler;
+
+    } else {
+        c->socket.read_handler = nxt_openssl_conn_handshake;
+        c->socket.write_handler = nxt_openssl_conn_handshake;
+
+        switch (n) {
+
+        case NXT_AGAIN:
+            if (tls->ssl_error == SSL_ERROR_WANT_READ && tls->times < 2) {
+                tls->times++;
+            }
+
+            return;
+
+        case 0:
+            handler = state->close_handler;
+            break;
+
+        default:
+        case NXT_ERROR:
+            handler = state->error_handler;
+            break;
+        }
+    }
+
+    wq = (c->read_state != NULL) ? c->read_work_queue : c->write_work_queue;
+
+    nxt_work_queue_add(wq, handler, task, c, data);
+}
+
+
+/*
+ * The connection events are disabled while the handshake runs in
+ * the thread pool and a connection shutdown is postponed until
+ * the job returns, so the connection is not used by both threads.
+ */
+
+static nxt_int_t
+nxt_openssl_conn_handshake_job(nxt_task_t *task, nxt_conn_t *c, void *data)
+{
+    nxt_tls_offload_t            *offload;
+    nxt_openssl_conn_t           *tls;
+    nxt_openssl_handshake_job_t  *jbh;
+
+    jbh = nxt_job_create(c->mem_pool, sizeof(nxt_openssl_handshake_job_t));
 
-    s = SSL_new(ctx);
-    if (s == NULL) {
-        nxt_openssl_log_error(task, NXT_LOG_ALERT, "SSL_new() failed");
-        goto fail;
+    if (nxt_slow_path(jbh == NULL)) {
+        return NXT_ERROR;
     }
 
-    tls->session = s;
-    /* To pass TLS config to the nxt_openssl_servername() callback. */
-    tls->conf = conf;
-    tls->conn = c;
+    tls = c->u.tls;
+    offload = tls->conf->offload;
 
-    ret = SSL_set_fd(s, c->socket.fd);
+    /* The thread pool sets its own thread in the job task. */
 
-    if (ret == 0) {
-        nxt_openssl_log_error(task, NXT_LOG_ALERT, "SSL_set_fd(%d) failed",
-                              c->socket.fd);
-        goto fail;
-    }
+    jbh->task.thread = task->thread;
+    jbh->task.log = c->socket.log;
+    jbh->task.ident = c->socket.task->ident;
 
-    SSL_set_accept_state(s);
+    jbh->job.task = &jbh->task;
+    jbh->job.data = c;
+    jbh->job.thread_pool = offload->thread_pool;
+    jbh->job.log = c->socket.log;
+    nxt_job_set_name(&jbh->job, "job tls handshake");
 
-    if (SSL_set_ex_data(s, nxt_openssl_connection_index, c) == 0) {
-        nxt_openssl_log_error(task, NXT_LOG_ALERT, "SSL_set_ex_data() failed");
-        goto fail;
-    }
+    /*
+     * If the thread pool fails to start a thread, the abort handler
+     * runs the handshake in the engine thread and the job returns
+     * in the usual way.
+     */
+    jbh->job.abort_handler = nxt_openssl_conn_handshake_thread;
 
-    c->io = &nxt_openssl_conn_io;
-    c->sendfile = NXT_CONN_SENDFILE_OFF;
+    jbh->data = data;
 
-    nxt_openssl_conn_handshake(task, c, c->socket.data);
+    tls->job = 1;
 
-    return;
+    nxt_fd_event_disable(task->thread->engine, &c->socket);
 
-fail:
+    (void) nxt_atomic_fetch_add(&offload->queued, 1);
+    (void) nxt_atomic_fetch_add(&offload->offloaded, 1);
 
-    nxt_work_queue_add(c->read_work_queue, c->read_state->error_handler,
-                       task, c, c->socket.data);
+    nxt_job_start(task, &jbh->job, nxt_openssl_conn_handshake_thread);
+
+    return NXT_OK;
 }
 
 
-nxt_inline void
-nxt_openssl_conn_free(nxt_task_t *task, nxt_conn_t *c)
+static void
+nxt_openssl_conn_handshake_thread(nxt_task_t *task, void *obj, void *data)
 {
-    nxt_openssl_conn_t  *tls;
+    int                          ret;
+    nxt_err_t                    err;
+    nxt_conn_t                   *c;
+    nxt_openssl_conn_t           *tls;
+    nxt_openssl_handshake_job_t  *jbh;
 
-    nxt_debug(task, "openssl conn free");
+    jbh = obj;
+    c = data;
 
     tls = c->u.tls;
 
-    if (tls != NULL) {
-        c->u.tls = NULL;
-        nxt_free(tls->buffer.start);
-        SSL_free(tls->session);
+    ret = SSL_do_handshake(tls->session);
+
+    err = (ret <= 0) ? nxt_socket_errno : 0;
+
+    nxt_debug(task, "SSL_do_handshake(%d) in thread: %d err:%d",
+              c->socket.fd, ret, err);
+
+    if (ret > 0) {
+        tls->handshake = 1;
+        jbh->n = NXT_OK;
+
+    } else {
+        jbh->n = nxt_openssl_conn_ssl_error(task, c, ret, err);
+
+        if (jbh->n == NXT_ERROR) {
+            nxt_openssl_conn_error(task, err, "SSL_do_handshake(%d) failed",
+                                   c->socket.fd);
+        }
     }
+
+    nxt_job_return(task, &jbh->job, nxt_openssl_conn_handshake_return);
 }
 
 
 static void
-nxt_openssl_conn_handshake(nxt_task_t *task, void *obj, void *data)
+nxt_openssl_conn_handshake_return(nxt_task_t *task, void *obj, void *data)
 {
-    int                     ret;
-    nxt_int_t               n;
-    nxt_err_t               err;
-    nxt_conn_t              *c;
-    nxt_work_queue_t        *wq;
-    nxt_work_handler_t      handler;
-    nxt_openssl_conn_t      *tls;
-    const nxt_conn_state_t  *state;
+    nxt_int_t                    n;
+    nxt_conn_t                   *c;
+    nxt_openssl_conn_t           *tls;
+    nxt_openssl_handshake_job_t  *jbh;
 
-    c = obj;
+    jbh = obj;
+    c = data;
 
-    nxt_debug(task, "openssl conn handshake fd:%d", c->socket.fd);
+    n = jbh->n;
+    data = jbh->data;
 
-    if (c->socket.error != 0) {
-        return;
-    }
+    nxt_job_destroy(task, jbh);
+
+    /* The job task has been just freed. */
+    task = c->socket.task;
 
     tls = c->u.tls;
+    tls->job = 0;
 
-    if (tls == NULL) {
+    (void) nxt_atomic_fetch_add(&tls->conf->offload->queued, -1);
+
+    nxt_debug(task, "openssl conn handshake return fd:%d", c->socket.fd);
+
+    nxt_thread_time_debug_update(task->thread);
+
+    if (tls->shutdown) {
+        nxt_openssl_conn_io_shutdown(task, c, NULL);
         return;
     }
 
-    nxt_debug(task, "openssl conn handshake: %d times", tls->times);
+    if (n == NXT_AGAIN) {
+        nxt_openssl_conn_io_wait(task, c, NXT_OPENSSL_HANDSHAKE);
+    }
 
-    /* "tls->times == 1" is suitable to run SSL_do_handshake() in job. */
+    nxt_openssl_conn_handshake_result(task, c, data, n);
+}
 
-    ret = SSL_do_handshake(tls->session);
 
-    err = (ret <= 0) ? nxt_socket_errno : 0;
+#if (NXT_HAVE_OPENSSL_EARLY_DATA)
 
-    nxt_thread_time_debug_update(task->thread);
+/*
+ * If the client sends early data, the request is processed as soon as
+ * the early data have arrived, while the handshake is completed later
+ * in nxt_openssl_conn_io_recvbuf().
+ */
 
-    nxt_debug(task, "SSL_do_handshake(%d): %d err:%d", c->socket.fd, ret, err);
+static nxt_int_t
+nxt_openssl_conn_early_data(nxt_task_t *task, nxt_conn_t *c)
+{
+    int                 ret;
+    size_t              nread;
+    nxt_int_t           n;
+    nxt_err_t           err;
+    nxt_buf_mem_t       *b;
+    nxt_openssl_conn_t  *tls;
 
-    state = (c->read_state != NULL) ? c->read_state : c->write_state;
+    tls = c->u.tls;
+    b = &tls->early_data;
 
-    if (ret > 0) {
-        /* ret == 1, the handshake was successfully completed. */
-        tls->handshake = 1;
+    if (b->start == NULL) {
+        b->start = nxt_mp_alloc(c->mem_pool, tls->conf->early_data);
+        if (nxt_slow_path(b->start == NULL)) {
+            return NXT_ERROR;
+        }
 
-        if (c->read_state != NULL) {
-            if (state->io_read_handler != NULL || c->read != NULL) {
-                nxt_conn_read(task->thread->engine, c);
-                return;
-            }
+        b->pos = b->start;
+        b->free = b->start;
+        b->end = b->start + tls->conf->early_data;
+    }
 
-        } else {
-            if (c->write != NULL) {
-                nxt_conn_write(task->thread->engine, c);
-                return;
-            }
+    for ( ;; ) {
+        if (b->free == b->end) {
+            return NXT_OK;
         }
 
-        handler = state->ready_handler;
+        ret = SSL_read_early_data(tls->session, b->free, b->end - b->free,
+                                  &nread);
 
-    } else {
-        c->socket.read_handler = nxt_openssl_conn_handshake;
-        c->socket.write_handler = nxt_openssl_conn_handshake;
+        err = (ret == SSL_READ_EARLY_DATA_ERROR) ? nxt_socket_errno : 0;
 
-        n = nxt_openssl_conn_test_error(task, c, ret, err,
-                                        NXT_OPENSSL_HANDSHAKE);
-        switch (n) {
+        nxt_debug(task, "SSL_read_early_data(%d, %p, %uz): %d, %uz err:%d",
+                  c->socket.fd, b->free, b->end - b->free, ret, nread, err);
 
-        case NXT_AGAIN:
-            if (tls->ssl_error == SSL_ERROR_WANT_READ && tls->times < 2) {
-                tls->times++;
-            }
+        if (ret == SSL_READ_EARLY_DATA_SUCCESS) {
+            b->free += nread;
+            continue;
+        }
 
-            return;
+        if (ret == SSL_READ_EARLY_DATA_FINISH) {
+            /* The buffered early data are processed after the handshake. */
+            tls->early = 0;
+            return NXT_DECLINED;
+        }
 
-        case 0:
-            handler = state->close_handler;
-            break;
+        n = nxt_openssl_conn_ssl_error(task, c, ret, err);
 
-        default:
-        case NXT_ERROR:
-            nxt_openssl_conn_error(task, err, "SSL_do_handshake(%d) failed",
-                                   c->socket.fd);
+        if (n == NXT_AGAIN) {
+            if (b->free != b->start) {
+                /* The buffered data are read first, so the socket is ready. */
+                return NXT_OK;
+            }
 
-            handler = state->error_handler;
-            break;
+            nxt_openssl_conn_io_wait(task, c, NXT_OPENSSL_HANDSHAKE);
         }
-    }
 
-    wq = (c->read_state != NULL) ? c->read_work_queue : c->write_work_queue;
+        if (n == NXT_ERROR) {
+            nxt_openssl_conn_error(task, err, "SSL_read_early_data(%d) failed",
+                                   c->socket.fd);
+        }
 
-    nxt_work_queue_add(wq, handler, task, c, data);
+        return n;
+    }
 }
 
+#endif
+
 
 static ssize_t
 nxt_openssl_conn_io_recvbuf(nxt_conn_t *c, nxt_buf_t *b)
@@ -1340,6 +2658,56 @@ nxt_openssl_conn_io_recvbuf(nxt_conn_t *c, nxt_buf_t *b)
     tls = c->u.tls;
     size = b->mem.end - b->mem.free;
 
+#if (NXT_HAVE_OPENSSL_EARLY_DATA)
+
+    if (tls->early_data.pos != tls->early_data.free) {
+        size = nxt_min(size, (size_t) (tls->early_data.free
+                                       - tls->early_data.pos));
+
+        nxt_memcpy(b->mem.free, tls->early_data.pos, size);
+        tls->early_data.pos += size;
+
+        /* The data are early even if the handshake has completed since. */
+        c->early_data = 1;
+
+        return size;
+    }
+
+    if (tls->early) {
+        ret = SSL_read_early_data(tls->session, b->mem.free, size, &size);
+
+        err = (ret == SSL_READ_EARLY_DATA_ERROR) ? nxt_socket_errno : 0;
+
+        nxt_debug(c->socket.task, "SSL_read_early_data(%d, %p): %d, %uz err:%d",
+                  c->socket.fd, b->mem.free, ret, size, err);
+
+        if (ret == SSL_READ_EARLY_DATA_SUCCESS) {
+            c->early_data = 1;
+            return size;
+        }
+
+        if (ret == SSL_READ_EARLY_DATA_ERROR) {
+            n = nxt_openssl_conn_test_error(c->socket.task, c, ret, err,
+                                            NXT_OPENSSL_READ);
+            if (n == NXT_ERROR) {
+                nxt_openssl_conn_error(c->socket.task, err,
+                                       "SSL_read_early_data(%d) failed",
+                                       c->socket.fd);
+            }
+
+            return n;
+        }
+
+        /* SSL_READ_EARLY_DATA_FINISH, SSL_read() completes the handshake. */
+
+        tls->early = 0;
+        size = b->mem.end - b->mem.free;
+    }
+
+    c->early_data = 0;
+
+#endif
+
     ret = SSL_read(tls->session, b->mem.free, size);
 
     err = (ret <= 0) ? nxt_socket_errno : 0;
@@ -1347,6 +2715,10 @@ nxt_openssl_conn_io_recvbuf(nxt_conn_t *c, nxt_buf_t *b)
     nxt_debug(c->socket.task, "SSL_read(%d, %p, %uz): %d err:%d",
               c->socket.fd, b->mem.free, size, ret, err);
 
+    if (!tls->handshake && SSL_is_init_finished(tls->session)) {
+        tls->handshake = 1;
+    }
+
     if (ret > 0) {
         return ret;
     }
@@ -1384,14 +2756,57 @@ nxt_openssl_conn_io_send(nxt_task_t *task, nxt_sendbuf_t *sb, void *buf,
     size_t size)
 {
     int                 ret;
+    size_t              limit;
+#if (NXT_HAVE_OPENSSL_EARLY_DATA)
+    size_t              written;
+#endif
     nxt_err_t           err;
     nxt_int_t           n;
+    nxt_msec_t          now;
     nxt_conn_t          *c;
+    nxt_tls_records_t   *records;
     nxt_openssl_conn_t  *tls;
 
     tls = sb->tls;
+    records = tls->conf->records;
+    now = 0;
+
+    if (records != NULL) {
+        now = task->thread->engine->timers.now;
+
+        if (tls->write_size != 0) {
+            /* SSL_write() must be retried with the same data size. */
+            size = nxt_min(size, tls->write_size);
+
+        } else {
+            if (nxt_msec_diff(now, tls->last_write)
+                > (nxt_msec_int_t) records->idle_timeout)
+            {
+                tls->records = 0;
+            }
+
+            limit = (tls->records < records->threshold)
+                    ? records->initial_size : records->max_size;
+
+            size = nxt_min(size, limit);
+        }
+    }
 
+#if (NXT_HAVE_OPENSSL_EARLY_DATA)
+    if (tls->early) {
+        /* A response to early data is sent before the handshake completes. */
+        ret = SSL_write_early_data(tls->session, buf, size, &written);
+
+        if (ret > 0) {
+            ret = written;
+        }
+
+    } else {
+        ret = SSL_write(tls->session, buf, size);
+    }
+#else
     ret = SSL_write(tls->session, buf, size);
+#endif
 
     err = (ret <= 0) ? nxt_socket_errno : 0;
 
@@ -1399,9 +2814,19 @@ nxt_openssl_conn_io_send(nxt_task_t *task, nxt_sendbuf_t *sb, void *buf,
               sb->socket, buf, size, ret, err);
 
     if (ret > 0) {
+        if (records != NULL) {
+            tls->records++;
+            tls->last_write = now;
+            tls->write_size = 0;
+        }
+
         return ret;
     }
 
+    if (records != NULL) {
+        tls->write_size = size;
+    }
+
     c = tls->conn;
     c->socket.write_ready = sb->ready;
 
@@ -1442,6 +2867,12 @@ nxt_openssl_conn_io_shutdown(nxt_task_t *task, void *obj, void *data)
         return;
     }
 
+    if (tls->job) {
+        /* The shutdown is continued when the handshake job returns. */
+        tls->shutdown = 1;
+        return;
+    }
+
     s = tls->session;
 
     if (s == NULL || !tls->handshake) {
@@ -1543,6 +2974,28 @@ nxt_openssl_conn_io_shutdown(nxt_task_t *task, void *obj, void *data)
 static nxt_int_t
 nxt_openssl_conn_test_error(nxt_task_t *task, nxt_conn_t *c, int ret,
     nxt_err_t sys_err, nxt_openssl_io_t io)
+{
+    nxt_int_t  n;
+
+    n = nxt_openssl_conn_ssl_error(task, c, ret, sys_err);
+
+    if (n == NXT_AGAIN) {
+        nxt_openssl_conn_io_wait(task, c, io);
+    }
+
+    return n;
+}
+
+
+/*
+ * The OpenSSL error queue is per thread, so the function must be called
+ * in the same thread which has called an SSL I/O function.  It does not
+ * change the connection events and may be called in a thread pool.
+ */
+
+static nxt_int_t
+nxt_openssl_conn_ssl_error(nxt_task_t *task, nxt_conn_t *c, int ret,
+    nxt_err_t sys_err)
 {
     u_long              lib_err;
     nxt_openssl_conn_t  *tls;
@@ -1556,29 +3009,7 @@ nxt_openssl_conn_test_error(nxt_task_t *task, nxt_conn_t *c, int ret,
     switch (tls->ssl_error) {
 
     case SSL_ERROR_WANT_READ:
-        c->socket.read_ready = 0;
-
-        if (io != NXT_OPENSSL_READ) {
-            nxt_fd_event_block_write(task->thread->engine, &c->socket);
-
-            if (nxt_fd_event_is_disabled(c->socket.read)) {
-                nxt_fd_event_enable_read(task->thread->engine, &c->socket);
-            }
-        }
-
-        return NXT_AGAIN;
-
     case SSL_ERROR_WANT_WRITE:
-        c->socket.write_ready = 0;
-
-        if (io != NXT_OPENSSL_WRITE) {
-            nxt_fd_event_block_read(task->thread->engine, &c->socket);
-
-            if (nxt_fd_event_is_disabled(c->socket.write)) {
-                nxt_fd_event_enable_write(task->thread->engine, &c->socket);
-            }
-        }
-
         return NXT_AGAIN;
 
     case SSL_ERROR_SYSCALL:
@@ -1606,6 +3037,38 @@ nxt_openssl_conn_test_error(nxt_task_t *task, nxt_conn_t *c, int ret,
 }
 
 
+static void
+nxt_openssl_conn_io_wait(nxt_task_t *task, nxt_conn_t *c, nxt_openssl_io_t io)
+{
+    nxt_openssl_conn_t  *tls;
+
+    tls = c->u.tls;
+
+    if (tls->ssl_error == SSL_ERROR_WANT_READ) {
+        c->socket.read_ready = 0;
+
+        if (io != NXT_OPENSSL_READ) {
+            nxt_fd_event_block_write(task->thread->engine, &c->socket);
+
+            if (nxt_fd_event_is_disabled(c->socket.read)) {
+                nxt_fd_event_enable_read(task->thread->engine, &c->socket);
+            }
+        }
+
+    } else {
+        c->socket.write_ready = 0;
+
+        if (io != NXT_OPENSSL_WRITE) {
+            nxt_fd_event_block_read(task->thread->engine, &c->socket);
+
+            if (nxt_fd_event_is_disabled(c->socket.write)) {
+                nxt_fd_event_enable_write(task->thread->engine, &c->socket);
+            }
+        }
+    }
+}
+
+
 static void
 nxt_openssl_conn_io_shutdown_timeout(nxt_task_t *task, void *obj, void *data)
 {
@@ -256,6 +256,7 @@ struct nxt_port_s {
 
     uint32_t            active_websockets;
     uint32_t            active_requests;
+    uint32_t            affinity_requests;
 
     nxt_port_handler_t  handler;
     nxt_port_handler_t  *data;
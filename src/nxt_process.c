@@ -640,6 +640,7 @@ nxt_process_setup(nxt_task_t *task, nxt_process_t *process)
     nxt_int_t                    ret;
     nxt_thread_t                 *thread;
     nxt_runtime_t                *rt;
+    nxt_thread_pool_t            *tp;
     nxt_process_init_t           *init;
     nxt_event_engine_t           *engine;
     const nxt_event_interface_t  *interface;
@@ -675,9 +676,9 @@ nxt_process_setup(nxt_task_t *task, nxt_process_t *process)
         return NXT_ERROR;
     }
 
-    ret = nxt_runtime_thread_pool_create(thread, rt, rt->auxiliary_threads,
-                                         60000 * 1000000LL);
-    if (nxt_slow_path(ret != NXT_OK)) {
+    tp = nxt_runtime_thread_pool_create(thread, rt, rt->auxiliary_threads,
+                                        60000 * 1000000LL);
+    if (nxt_slow_path(tp == NULL)) {
         return NXT_ERROR;
     }
 
@@ -24,14 +24,27 @@
 
 #define NXT_SHARED_PORT_ID  0xFFFFu
 
+/*
+ * The autoscaler samples application queue every NXT_ROUTER_SCALE_INTERVAL
+ * and lowers its process target only after NXT_ROUTER_SCALE_CALM samples
+ * in a row with queue wait time below half of the target latency.
+ */
+#define NXT_ROUTER_SCALE_INTERVAL  200
+#define NXT_ROUTER_SCALE_CALM      25
+
 typedef struct {
     nxt_str_t         type;
     uint32_t          processes;
     uint32_t          max_processes;
     uint32_t          spare_processes;
+    uint32_t          target_latency;
+    uint32_t          queue_size;
+    uint32_t          queue_wait;
+    uint32_t          threads;
     nxt_msec_t        timeout;
     nxt_msec_t        idle_timeout;
     nxt_conf_value_t  *limits_value;
+    nxt_conf_value_t  *queue_value;
     nxt_conf_value_t  *processes_value;
     nxt_conf_value_t  *targets_value;
 } nxt_router_app_conf_t;
@@ -40,6 +53,7 @@ typedef struct {
 typedef struct {
     nxt_str_t         pass;
     nxt_str_t         application;
+    uint8_t           reuseport;
 } nxt_router_listener_conf_t;
 
 
@@ -50,6 +64,7 @@ typedef struct {
     nxt_socket_conf_t       *socket_conf;
     nxt_router_temp_conf_t  *temp_conf;
     nxt_tls_init_t          *tls_init;
+    nxt_str_t               *json;
     nxt_bool_t              last;
 
     nxt_queue_link_t        link;  /* for nxt_socket_conf_t.tls */
@@ -74,6 +89,7 @@ typedef struct {
     nxt_socket_conf_t       *socket_conf;
     nxt_router_temp_conf_t  *temp_conf;
     nxt_bool_t              last;
+    uint32_t                shard;
 } nxt_socket_rpc_t;
 
 
@@ -141,7 +157,7 @@ static nxt_int_t nxt_router_port_queue_init(nxt_task_t *task,
 static nxt_int_t nxt_router_port_queue_map(nxt_task_t *task,
     nxt_port_t *port, nxt_fd_t fd);
 static void nxt_router_listen_socket_rpc_create(nxt_task_t *task,
-    nxt_router_temp_conf_t *tmcf, nxt_socket_conf_t *skcf);
+    nxt_router_temp_conf_t *tmcf, nxt_socket_conf_t *skcf, uint32_t shard);
 static void nxt_router_listen_socket_ready(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, void *data);
 static void nxt_router_listen_socket_error(nxt_task_t *task,
@@ -151,7 +167,19 @@ static void nxt_router_tls_rpc_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, void *data);
 static nxt_int_t nxt_router_conf_tls_insert(nxt_router_temp_conf_t *tmcf,
     nxt_conf_value_t *value, nxt_socket_conf_t *skcf, nxt_tls_init_t *tls_init,
-    nxt_bool_t last);
+    nxt_str_t *json, nxt_bool_t last);
+static nxt_int_t nxt_router_tls_conf_reuse(nxt_router_temp_conf_t *tmcf,
+    nxt_socket_conf_t *skcf, nxt_conf_value_t *listener, nxt_str_t *json);
+static void nxt_router_tls_conf_release(nxt_task_t *task,
+    nxt_tls_conf_t *tlscf);
+static nxt_tls_session_cache_t *nxt_router_tls_session_cache(nxt_task_t *task,
+    nxt_router_t *router, nxt_str_t *name, size_t sessions, size_t data_size);
+static void nxt_router_tls_session_caches_free(nxt_router_t *router);
+static nxt_int_t nxt_router_tls_offload_create(nxt_task_t *task,
+    nxt_router_conf_t *rtcf);
+static void nxt_router_tls_offload_release(nxt_task_t *task, void *obj,
+    void *data);
+static void nxt_router_tls_offload_destroy(nxt_router_t *router);
 #endif
 #if (NXT_HAVE_NJS)
 static void nxt_router_js_module_rpc_handler(nxt_task_t *task,
@@ -166,9 +194,9 @@ static void nxt_router_app_prefork_ready(nxt_task_t *task,
 static void nxt_router_app_prefork_error(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, void *data);
 static nxt_socket_conf_t *nxt_router_socket_conf(nxt_task_t *task,
-    nxt_router_temp_conf_t *tmcf, nxt_str_t *name);
+    nxt_router_temp_conf_t *tmcf, nxt_str_t *name, nxt_bool_t reuseport);
 static nxt_int_t nxt_router_listen_socket_find(nxt_router_temp_conf_t *tmcf,
-    nxt_socket_conf_t *nskcf, nxt_sockaddr_t *sa);
+    nxt_socket_conf_t *nskcf, nxt_sockaddr_t *sa, uint32_t nshards);
 
 static nxt_int_t nxt_router_engines_create(nxt_task_t *task,
     nxt_router_t *router, nxt_router_temp_conf_t *tmcf,
@@ -231,6 +259,10 @@ static void nxt_router_app_port_release(nxt_task_t *task, nxt_app_t *app,
     nxt_port_t *port, nxt_apr_action_t action);
 static void nxt_router_app_port_get(nxt_task_t *task, nxt_app_t *app,
     nxt_request_rpc_data_t *req_rpc_data);
+static nxt_port_t *nxt_router_app_affinity_port(nxt_app_t *app,
+    uint32_t affinity);
+static void nxt_router_app_affinity_release(nxt_task_t *task,
+    nxt_request_rpc_data_t *req_rpc_data);
 static void nxt_router_http_request_error(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_router_http_request_done(nxt_task_t *task, void *obj,
@@ -241,13 +273,23 @@ static void nxt_router_app_prepare_request(nxt_task_t *task,
 static nxt_buf_t *nxt_router_prepare_msg(nxt_task_t *task,
     nxt_http_request_t *r, nxt_app_t *app, const nxt_str_t *prefix);
 
+static nxt_uint_t nxt_router_app_admit(nxt_task_t *task, nxt_app_t *app);
+static nxt_int_t nxt_router_app_affinity(nxt_task_t *task,
+    nxt_http_request_t *r);
+static void nxt_router_app_queue_timeout(nxt_task_t *task, void *obj,
+    void *data);
 static void nxt_router_app_timeout(nxt_task_t *task, void *obj, void *data);
 static void nxt_router_adjust_idle_timer(nxt_task_t *task, void *obj,
     void *data);
 static void nxt_router_app_idle_timeout(nxt_task_t *task, void *obj,
     void *data);
+static void nxt_router_app_scale(nxt_task_t *task, nxt_app_t *app);
+static void nxt_router_app_scale_timeout(nxt_task_t *task, void *obj,
+    void *data);
 static void nxt_router_app_joint_release_handler(nxt_task_t *task, void *obj,
     void *data);
+static void nxt_router_app_joint_scale_release_handler(nxt_task_t *task,
+    void *obj, void *data);
 static void nxt_router_free_app(nxt_task_t *task, void *obj, void *data);
 
 static const nxt_http_request_state_t  nxt_http_request_send_state;
@@ -368,6 +410,9 @@ nxt_router_start(nxt_task_t *task, nxt_process_data_t *data)
     nxt_queue_init(&router->engines);
     nxt_queue_init(&router->sockets);
     nxt_queue_init(&router->apps);
+#if (NXT_TLS)
+    nxt_queue_init(&router->tls_session_caches);
+#endif
 
     nxt_router = router;
 
@@ -551,7 +596,9 @@ nxt_router_msg_cancel(nxt_task_t *task, nxt_request_rpc_data_t *req_rpc_data)
 
     app_port = req_rpc_data->app_port;
 
-    if (app_port != NULL && app_port->id == NXT_SHARED_PORT_ID) {
+    if (app_port != NULL && app_port->id == NXT_SHARED_PORT_ID
+        && req_rpc_data->affinity_port == NULL)
+    {
         cancelled = nxt_app_queue_cancel(app_port->queue,
                                          msg_info->tracking_cookie,
                                          req_rpc_data->stream);
@@ -609,6 +656,10 @@ nxt_request_rpc_data_unlink(nxt_task_t *task,
 
     app = req_rpc_data->app;
 
+    if (req_rpc_data->affinity_port != NULL) {
+        nxt_router_app_affinity_release(task, req_rpc_data);
+    }
+
     if (req_rpc_data->app_port != NULL) {
         nxt_router_app_port_release(task, app, req_rpc_data->app_port,
                                     req_rpc_data->apr_action);
@@ -635,6 +686,8 @@ nxt_request_rpc_data_unlink(nxt_task_t *task,
                 nxt_queue_remove(&r->app_link);
                 r->app_link.next = NULL;
 
+                app->queued_requests--;
+
                 unlinked = 1;
             }
 
@@ -952,8 +1005,8 @@ nxt_router_status_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     nxt_buf_t            *b;
     nxt_uint_t           type;
     nxt_port_t           *port;
+    nxt_app_queue_t      *queue;
     nxt_status_app_t     *app_stat;
-    nxt_event_engine_t   *engine;
     nxt_status_report_t  *report;
 
     port = nxt_runtime_port_find(task->thread->runtime,
@@ -981,16 +1034,19 @@ nxt_router_status_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
     report = (nxt_status_report_t *) b->mem.free;
     b->mem.free = b->mem.end;
 
-    nxt_memzero(report, sizeof(nxt_status_report_t));
-
-    nxt_queue_each(engine, &nxt_router->engines, nxt_event_engine_t, link0) {
+    /* The connection and request counters are read by the controller. */
 
-        report->accepted_conns += engine->accepted_conns_cnt;
-        report->idle_conns += engine->idle_conns_cnt;
-        report->closed_conns += engine->closed_conns_cnt;
-        report->requests += engine->requests_cnt;
+    nxt_memzero(report, sizeof(nxt_status_report_t));
 
-    } nxt_queue_loop;
+#if (NXT_TLS)
+    if (nxt_router->tls_offload != NULL
+        && nxt_router->tls_offload->threads != 0)
+    {
+        report->tls_offload = 1;
+        report->tls_handshakes_queued = nxt_router->tls_offload->queued;
+        report->tls_handshakes_offloaded = nxt_router->tls_offload->offloaded;
+    }
+#endif
 
     report->apps_count = 0;
     app_stat = report->apps;
@@ -1005,10 +1061,30 @@ nxt_router_status_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg)
         app_stat->name.start = (u_char *) (p - b->mem.pos);
 
         app_stat->active_requests = app->active_requests;
+        app_stat->queued_requests = app->queued_requests;
         app_stat->pending_processes = app->pending_processes;
         app_stat->processes = app->processes;
         app_stat->idle_processes = app->idle_processes;
 
+        app_stat->target_latency = app->target_latency;
+        app_stat->scale_target = app->scale_target;
+        app_stat->scale_ups = app->scale_ups;
+        app_stat->scale_downs = app->scale_downs;
+        app_stat->wait_latency = app->wait_latency;
+
+        app_stat->prioritized = app->prioritized;
+
+        if (app->prioritized && app->shared_port != NULL) {
+            queue = app->shared_port->queue;
+
+            app_stat->queue_high = nxt_app_queue_depth(queue,
+                                                       NXT_APP_QUEUE_HIGH);
+            app_stat->queue_normal = nxt_app_queue_depth(queue,
+                                                         NXT_APP_QUEUE_NORMAL);
+            app_stat->queue_low = nxt_app_queue_depth(queue,
+                                                      NXT_APP_QUEUE_LOW);
+        }
+
         report->apps_count++;
         app_stat++;
     } nxt_queue_loop;
@@ -1193,7 +1269,7 @@ nxt_router_conf_apply(nxt_task_t *task, void *obj, void *data)
 
         skcf = nxt_queue_link_data(qlk, nxt_socket_conf_t, link);
 
-        nxt_router_listen_socket_rpc_create(task, tmcf, skcf);
+        nxt_router_listen_socket_rpc_create(task, tmcf, skcf, 0);
 
         return;
     }
@@ -1249,7 +1325,7 @@ nxt_router_conf_apply(nxt_task_t *task, void *obj, void *data)
 
     rt = task->thread->runtime;
 
-    interface = nxt_service_get(rt->services, "engine", NULL);
+    interface = nxt_service_get(rt->services, "engine", rt->engine);
 
     router = rtcf->router;
 
@@ -1267,6 +1343,19 @@ nxt_router_conf_apply(nxt_task_t *task, void *obj, void *data)
 
     nxt_router_apps_hash_use(task, rtcf, 1);
 
+#if (NXT_TLS)
+    /* The engines release previous listeners once the jobs are posted. */
+
+    if (router->tls_offload != NULL) {
+        router->tls_offload->threads = rtcf->tls_handshake_threads;
+
+        if (rtcf->tls_handshake_threads != 0) {
+            router->tls_offload->thread_pool->max_threads =
+                                                   rtcf->tls_handshake_threads;
+        }
+    }
+#endif
+
     nxt_router_engines_post(router, tmcf);
 
     nxt_queue_add(&router->sockets, &updating_sockets);
@@ -1345,6 +1434,7 @@ nxt_router_conf_ready(nxt_task_t *task, nxt_router_temp_conf_t *tmcf)
 void
 nxt_router_conf_error(nxt_task_t *task, nxt_router_temp_conf_t *tmcf)
 {
+    uint32_t           i;
     nxt_app_t          *app;
     nxt_socket_t       s;
     nxt_router_t       *router;
@@ -1365,9 +1455,35 @@ nxt_router_conf_error(nxt_task_t *task, nxt_router_temp_conf_t *tmcf)
             nxt_socket_close(task, s);
         }
 
+        for (i = 1; i < skcf->listen->nshards; i++) {
+            s = skcf->listen->shards[i];
+
+            if (s != -1) {
+                nxt_socket_close(task, s);
+            }
+        }
+
         nxt_free(skcf->listen);
     }
 
+#if (NXT_TLS)
+    nxt_queue_each(skcf, &creating_sockets, nxt_socket_conf_t, link) {
+
+        if (skcf->tls != NULL) {
+            nxt_router_tls_conf_release(task, skcf->tls);
+        }
+
+    } nxt_queue_loop;
+
+    nxt_queue_each(skcf, &updating_sockets, nxt_socket_conf_t, link) {
+
+        if (skcf->tls != NULL) {
+            nxt_router_tls_conf_release(task, skcf->tls);
+        }
+
+    } nxt_queue_loop;
+#endif
+
     rtcf = tmcf->router_conf;
 
     nxt_queue_each(app, &tmcf->apps, nxt_app_t, link) {
@@ -1446,6 +1562,12 @@ static nxt_conf_map_t  nxt_router_app_conf[] = {
         NXT_CONF_MAP_PTR,
         offsetof(nxt_router_app_conf_t, targets_value),
     },
+
+    {
+        nxt_string("threads"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_router_app_conf_t, threads),
+    },
 };
 
 
@@ -1455,6 +1577,27 @@ static nxt_conf_map_t  nxt_router_app_limits_conf[] = {
         NXT_CONF_MAP_MSEC,
         offsetof(nxt_router_app_conf_t, timeout),
     },
+
+    {
+        nxt_string("queue"),
+        NXT_CONF_MAP_PTR,
+        offsetof(nxt_router_app_conf_t, queue_value),
+    },
+};
+
+
+static nxt_conf_map_t  nxt_router_app_queue_conf[] = {
+    {
+        nxt_string("size"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_router_app_conf_t, queue_size),
+    },
+
+    {
+        nxt_string("wait"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_router_app_conf_t, queue_wait),
+    },
 };
 
 
@@ -1476,6 +1619,12 @@ static nxt_conf_map_t  nxt_router_app_processes_conf[] = {
         NXT_CONF_MAP_MSEC,
         offsetof(nxt_router_app_conf_t, idle_timeout),
     },
+
+    {
+        nxt_string("target_latency"),
+        NXT_CONF_MAP_INT32,
+        offsetof(nxt_router_app_conf_t, target_latency),
+    },
 };
 
 
@@ -1491,6 +1640,12 @@ static nxt_conf_map_t  nxt_router_listener_conf[] = {
         NXT_CONF_MAP_STR_COPY,
         offsetof(nxt_router_listener_conf_t, application),
     },
+
+    {
+        nxt_string("reuseport"),
+        NXT_CONF_MAP_INT8,
+        offsetof(nxt_router_listener_conf_t, reuseport),
+    },
 };
 
 
@@ -1597,6 +1752,37 @@ static nxt_conf_map_t  nxt_router_websocket_conf[] = {
 };
 
 
+#if (NXT_TLS)
+
+static nxt_conf_map_t  nxt_router_tls_records_conf[] = {
+    {
+        nxt_string("initial_size"),
+        NXT_CONF_MAP_SIZE,
+        offsetof(nxt_tls_records_t, initial_size),
+    },
+
+    {
+        nxt_string("max_size"),
+        NXT_CONF_MAP_SIZE,
+        offsetof(nxt_tls_records_t, max_size),
+    },
+
+    {
+        nxt_string("threshold"),
+        NXT_CONF_MAP_INT,
+        offsetof(nxt_tls_records_t, threshold),
+    },
+
+    {
+        nxt_string("idle_timeout"),
+        NXT_CONF_MAP_MSEC,
+        offsetof(nxt_tls_records_t, idle_timeout),
+    },
+};
+
+#endif
+
+
 static nxt_int_t
 nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     u_char *start, u_char *end)
@@ -1614,8 +1800,10 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     nxt_router_t                *router;
     nxt_app_joint_t             *app_joint;
 #if (NXT_TLS)
+    nxt_str_t                   *json;
     nxt_tls_init_t              *tls_init;
     nxt_conf_value_t            *certificate;
+    nxt_tls_records_t           *records;
 #endif
 #if (NXT_HAVE_NJS)
     nxt_conf_value_t            *js_module;
@@ -1642,6 +1830,16 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
     static nxt_str_t  conf_cache_path = nxt_string("/tls/session/cache_size");
     static nxt_str_t  conf_timeout_path = nxt_string("/tls/session/timeout");
     static nxt_str_t  conf_tickets = nxt_string("/tls/session/tickets");
+    static nxt_str_t  conf_ktls_path = nxt_string("/tls/ktls");
+    static nxt_str_t  conf_records_path = nxt_string("/tls/records");
+    static nxt_str_t  conf_early_data_path = nxt_string("/tls/early_data");
+    static nxt_str_t  conf_early_data_size_path =
+                                       nxt_string("/tls/early_data/max_size");
+    static nxt_str_t  conf_ocsp_responses_path =
+                                       nxt_string("/tls/ocsp/responses");
+    static nxt_str_t  conf_ocsp_refresh_path = nxt_string("/tls/ocsp/refresh");
+    static nxt_str_t  handshake_threads_path =
+                                nxt_string("/settings/tls/handshake_threads");
 #endif
 #if (NXT_HAVE_NJS)
     static nxt_str_t  js_module_path = nxt_string("/settings/js_module");
@@ -1680,6 +1878,21 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
 
     router = rtcf->router;
 
+#if (NXT_TLS)
+    value = nxt_conf_get_path(root, &handshake_threads_path);
+
+    if (value != NULL) {
+        rtcf->tls_handshake_threads = nxt_conf_get_number(value);
+    }
+
+    ret = nxt_router_tls_offload_create(task, rtcf);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    nxt_router_tls_session_caches_free(router);
+#endif
+
     applications = nxt_conf_get_path(root, &applications_path);
 
     if (applications != NULL) {
@@ -1740,9 +1953,14 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
             apcf.processes = 1;
             apcf.max_processes = 1;
             apcf.spare_processes = 0;
+            apcf.target_latency = 0;
+            apcf.queue_size = 0;
+            apcf.queue_wait = 0;
+            apcf.threads = 1;
             apcf.timeout = 0;
             apcf.idle_timeout = 15000;
             apcf.limits_value = NULL;
+            apcf.queue_value = NULL;
             apcf.processes_value = NULL;
             apcf.targets_value = NULL;
 
@@ -1777,6 +1995,23 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                 }
             }
 
+            if (apcf.queue_value != NULL) {
+
+                if (nxt_conf_type(apcf.queue_value) != NXT_CONF_OBJECT) {
+                    nxt_alert(task, "application queue is not object");
+                    goto app_fail;
+                }
+
+                ret = nxt_conf_map_object(mp, apcf.queue_value,
+                                        nxt_router_app_queue_conf,
+                                        nxt_nitems(nxt_router_app_queue_conf),
+                                        &apcf);
+                if (ret != NXT_OK) {
+                    nxt_alert(task, "application queue map error");
+                    goto app_fail;
+                }
+            }
+
             if (apcf.processes_value != NULL
                 && nxt_conf_type(apcf.processes_value) == NXT_CONF_OBJECT)
             {
@@ -1851,6 +2086,11 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                                          ? apcf.spare_processes : 1;
             app->timeout = apcf.timeout;
             app->idle_timeout = apcf.idle_timeout;
+            app->target_latency = apcf.target_latency;
+            app->queue_size = apcf.queue_size;
+            app->queue_wait = apcf.queue_wait;
+            app->threads = apcf.threads;
+            app->scale_target = apcf.spare_processes;
 
             app->targets = targets;
 
@@ -1882,6 +2122,17 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
             app_joint->idle_timer.task = &engine->task;
             app_joint->idle_timer.log = app_joint->idle_timer.task->log;
 
+            app_joint->scale_timer.bias = NXT_TIMER_DEFAULT_BIAS;
+            app_joint->scale_timer.work_queue = &engine->fast_work_queue;
+            app_joint->scale_timer.handler = nxt_router_app_scale_timeout;
+            app_joint->scale_timer.task = &engine->task;
+            app_joint->scale_timer.log = app_joint->scale_timer.task->log;
+
+            if (app->target_latency != 0) {
+                nxt_timer_add(engine, &app_joint->scale_timer,
+                              NXT_ROUTER_SCALE_INTERVAL);
+            }
+
             app_joint->free_app_work.handler = nxt_router_free_app;
             app_joint->free_app_work.task = &engine->task;
             app_joint->free_app_work.obj = app_joint;
@@ -1951,11 +2202,6 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                 break;
             }
 
-            skcf = nxt_router_socket_conf(task, tmcf, &name);
-            if (skcf == NULL) {
-                goto fail;
-            }
-
             nxt_memzero(&lscf, sizeof(lscf));
 
             ret = nxt_conf_map_object(mp, listener, nxt_router_listener_conf,
@@ -1966,6 +2212,11 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                 goto fail;
             }
 
+            skcf = nxt_router_socket_conf(task, tmcf, &name, lscf.reuseport);
+            if (skcf == NULL) {
+                goto fail;
+            }
+
             nxt_debug(task, "application: %V", &lscf.application);
 
             // STUB, default values if http block is not defined.
@@ -2043,6 +2294,22 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
 #if (NXT_TLS)
             certificate = nxt_conf_get_path(listener, &certificate_path);
 
+            if (certificate != NULL) {
+                json = nxt_mp_get(tmcf->mem_pool, sizeof(nxt_str_t));
+                if (nxt_slow_path(json == NULL)) {
+                    goto fail;
+                }
+
+                ret = nxt_router_tls_conf_reuse(tmcf, skcf, listener, json);
+                if (nxt_slow_path(ret == NXT_ERROR)) {
+                    goto fail;
+                }
+
+                if (ret == NXT_OK) {
+                    certificate = NULL;
+                }
+            }
+
             if (certificate != NULL) {
                 tls_init = nxt_mp_get(tmcf->mem_pool, sizeof(nxt_tls_init_t));
                 if (nxt_slow_path(tls_init == NULL)) {
@@ -2057,6 +2324,18 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                     tls_init->cache_size = nxt_conf_get_number(value);
                 }
 
+                tls_init->session_cache = NULL;
+
+                if (tls_init->cache_size != 0) {
+                    tls_init->session_cache =
+                        nxt_router_tls_session_cache(task, router, &name,
+                                                     tls_init->cache_size,
+                                                     NXT_TLS_SESSION_MAX_SIZE);
+                    if (nxt_slow_path(tls_init->session_cache == NULL)) {
+                        goto fail;
+                    }
+                }
+
                 value = nxt_conf_get_path(listener, &conf_timeout_path);
                 if (value != NULL) {
                     tls_init->timeout = nxt_conf_get_number(value);
@@ -2068,6 +2347,75 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                 tls_init->tickets_conf = nxt_conf_get_path(listener,
                                                            &conf_tickets);
 
+                value = nxt_conf_get_path(listener, &conf_ktls_path);
+                tls_init->ktls = (value != NULL && nxt_conf_get_boolean(value));
+
+                tls_init->records = NULL;
+
+                value = nxt_conf_get_path(listener, &conf_records_path);
+
+                if (value != NULL) {
+                    records = nxt_mp_get(tmcf->mem_pool,
+                                         sizeof(nxt_tls_records_t));
+                    if (nxt_slow_path(records == NULL)) {
+                        goto fail;
+                    }
+
+                    records->initial_size = NXT_TLS_RECORD_INITIAL_SIZE;
+                    records->max_size = NXT_TLS_RECORD_MAX_SIZE;
+                    records->threshold = NXT_TLS_RECORD_THRESHOLD;
+                    records->idle_timeout = NXT_TLS_RECORD_IDLE_TIMEOUT;
+
+                    ret = nxt_conf_map_object(tmcf->mem_pool, value,
+                                        nxt_router_tls_records_conf,
+                                        nxt_nitems(nxt_router_tls_records_conf),
+                                        records);
+                    if (ret != NXT_OK) {
+                        nxt_alert(task, "tls records map error");
+                        goto fail;
+                    }
+
+                    tls_init->records = records;
+                }
+
+                tls_init->early_data = 0;
+                tls_init->early_data_hellos = NULL;
+
+                value = nxt_conf_get_path(listener, &conf_early_data_path);
+
+                if (value != NULL) {
+                    tls_init->early_data = NXT_TLS_EARLY_DATA_SIZE;
+
+                    value = nxt_conf_get_path(listener,
+                                              &conf_early_data_size_path);
+                    if (value != NULL) {
+                        tls_init->early_data = nxt_conf_get_number(value);
+                    }
+
+                    tls_init->early_data_hellos =
+                        nxt_router_tls_session_cache(task, router, &name,
+                                                     NXT_TLS_EARLY_DATA_HELLOS,
+                                                     0);
+                    if (nxt_slow_path(tls_init->early_data_hellos == NULL)) {
+                        goto fail;
+                    }
+                }
+
+                nxt_str_null(&tls_init->ocsp_responses);
+                tls_init->ocsp_refresh = NXT_TLS_OCSP_REFRESH;
+
+                value = nxt_conf_get_path(listener, &conf_ocsp_responses_path);
+
+                if (value != NULL) {
+                    nxt_conf_get_string(value, &tls_init->ocsp_responses);
+
+                    value = nxt_conf_get_path(listener,
+                                              &conf_ocsp_refresh_path);
+                    if (value != NULL) {
+                        tls_init->ocsp_refresh = nxt_conf_get_number(value);
+                    }
+                }
+
                 n = nxt_conf_array_elements_count_or_1(certificate);
 
                 for (i = 0; i < n; i++) {
@@ -2076,7 +2424,7 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
                     nxt_assert(value != NULL);
 
                     ret = nxt_router_conf_tls_insert(tmcf, value, skcf,
-                                                     tls_init, i == 0);
+                                                     tls_init, json, i == 0);
                     if (nxt_slow_path(ret != NXT_OK)) {
                         goto fail;
                     }
@@ -2173,7 +2521,7 @@ nxt_router_conf_create(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
 static nxt_int_t
 nxt_router_conf_tls_insert(nxt_router_temp_conf_t *tmcf,
     nxt_conf_value_t *value, nxt_socket_conf_t *skcf,
-    nxt_tls_init_t *tls_init, nxt_bool_t last)
+    nxt_tls_init_t *tls_init, nxt_str_t *json, nxt_bool_t last)
 {
     nxt_router_tlssock_t  *tls;
 
@@ -2183,6 +2531,7 @@ nxt_router_conf_tls_insert(nxt_router_temp_conf_t *tmcf,
     }
 
     tls->tls_init = tls_init;
+    tls->json = json;
     tls->socket_conf = skcf;
     tls->temp_conf = tmcf;
     tls->last = last;
@@ -2193,6 +2542,245 @@ nxt_router_conf_tls_insert(nxt_router_temp_conf_t *tmcf,
     return NXT_OK;
 }
 
+
+/*
+ * A TLS configuration with all its certificate contexts is shared with
+ * the previous configuration of the same listener if the listener "tls"
+ * object has not been changed.  This saves loading of certificates on
+ * reconfigurations that do not touch the listener; a certificate cannot
+ * be replaced while it is used, so the same names mean the same content.
+ */
+
+static nxt_int_t
+nxt_router_tls_conf_reuse(nxt_router_temp_conf_t *tmcf,
+    nxt_socket_conf_t *skcf, nxt_conf_value_t *listener, nxt_str_t *json)
+{
+    nxt_tls_conf_t     *tlscf;
+    nxt_conf_value_t   *value;
+    nxt_socket_conf_t  *prev;
+
+    static nxt_str_t  tls_path = nxt_string("/tls");
+
+    value = nxt_conf_get_path(listener, &tls_path);
+
+    json->length = nxt_conf_json_length(value, NULL);
+
+    json->start = nxt_mp_nget(tmcf->mem_pool, json->length);
+    if (nxt_slow_path(json->start == NULL)) {
+        return NXT_ERROR;
+    }
+
+    json->length = nxt_conf_json_print(json->start, value, NULL) - json->start;
+
+    nxt_queue_each(prev, &keeping_sockets, nxt_socket_conf_t, link) {
+
+        tlscf = prev->tls;
+
+        if (prev->listen == skcf->listen
+            && tlscf != NULL
+            && tlscf->offload == tmcf->router_conf->tls_offload
+            && nxt_strstr_eq(&tlscf->json, json))
+        {
+            (void) nxt_atomic_fetch_add(&tlscf->count, 1);
+
+            skcf->tls = tlscf;
+
+            return NXT_OK;
+        }
+
+    } nxt_queue_loop;
+
+    return NXT_DECLINED;
+}
+
+
+static void
+nxt_router_tls_conf_release(nxt_task_t *task, nxt_tls_conf_t *tlscf)
+{
+    nxt_mp_t            *mp;
+    nxt_work_t          *release;
+    nxt_tls_offload_t   *offload;
+    nxt_event_engine_t  *engine;
+
+    if (nxt_atomic_fetch_add(&tlscf->count, -1) != 1) {
+        return;
+    }
+
+    offload = tlscf->offload;
+
+    if (offload != NULL) {
+        /* The offload may be destroyed once the reference is released. */
+
+        engine = offload->thread_pool->engine;
+
+        if (nxt_atomic_fetch_add(&offload->count, -1) == 1
+            && offload->threads == 0)
+        {
+            release = nxt_zalloc(sizeof(nxt_work_t));
+
+            if (nxt_fast_path(release != NULL)) {
+                nxt_work_set(release, nxt_router_tls_offload_release,
+                             &engine->task, release, NULL);
+
+                nxt_event_engine_post(engine, release);
+            }
+        }
+    }
+
+    task->thread->runtime->tls->server_free(task, tlscf);
+
+    mp = tlscf->mem_pool;
+
+    nxt_mp_thread_adopt(mp);
+
+    nxt_mp_destroy(mp);
+}
+
+
+static nxt_tls_session_cache_t *
+nxt_router_tls_session_cache(nxt_task_t *task, nxt_router_t *router,
+    nxt_str_t *name, size_t sessions, size_t data_size)
+{
+    nxt_tls_session_cache_t  *cache;
+
+    nxt_queue_each(cache, &router->tls_session_caches,
+                   nxt_tls_session_cache_t, link)
+    {
+        if (cache->sessions == sessions
+            && cache->data_size == data_size
+            && nxt_strstr_eq(&cache->name, name))
+        {
+            return cache;
+        }
+
+    } nxt_queue_loop;
+
+    cache = nxt_tls_session_cache_create(task, name, sessions, data_size);
+    if (nxt_slow_path(cache == NULL)) {
+        return NULL;
+    }
+
+    nxt_queue_insert_tail(&router->tls_session_caches, &cache->link);
+
+    return cache;
+}
+
+
+static void
+nxt_router_tls_session_caches_free(nxt_router_t *router)
+{
+    nxt_tls_session_cache_t  *cache;
+
+    /*
+     * The references are taken only by the router thread while
+     * configuring, so an unused cache cannot become used meanwhile.
+     */
+
+    nxt_queue_each(cache, &router->tls_session_caches,
+                   nxt_tls_session_cache_t, link)
+    {
+        if (cache->count == 0) {
+            nxt_queue_remove(&cache->link);
+            nxt_tls_session_cache_destroy(cache);
+        }
+
+    } nxt_queue_loop;
+}
+
+
+static nxt_int_t
+nxt_router_tls_offload_create(nxt_task_t *task, nxt_router_conf_t *rtcf)
+{
+    nxt_router_t       *router;
+    nxt_tls_offload_t  *offload;
+
+    router = rtcf->router;
+    offload = router->tls_offload;
+
+    if (rtcf->tls_handshake_threads == 0) {
+
+        /*
+         * Otherwise the pool is destroyed when the listeners
+         * of the previous configurations are released.
+         */
+
+        if (offload != NULL && offload->count == 0) {
+            nxt_router_tls_offload_destroy(router);
+        }
+
+        return NXT_OK;
+    }
+
+    if (offload == NULL) {
+        offload = nxt_zalloc(sizeof(nxt_tls_offload_t));
+        if (nxt_slow_path(offload == NULL)) {
+            return NXT_ERROR;
+        }
+
+        /*
+         * The pool is shared by all router engines and exists until
+         * the router exits, its threads exit after a minute of idle.
+         */
+
+        offload->thread_pool = nxt_runtime_thread_pool_create(task->thread,
+                                                  task->thread->runtime,
+                                                  rtcf->tls_handshake_threads,
+                                                  60000 * 1000000LL);
+        if (nxt_slow_path(offload->thread_pool == NULL)) {
+            nxt_free(offload);
+            return NXT_ERROR;
+        }
+
+        router->tls_offload = offload;
+    }
+
+    rtcf->tls_offload = offload;
+
+    return NXT_OK;
+}
+
+
+static void
+nxt_router_tls_offload_release(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_work_t         *work;
+    nxt_tls_offload_t  *offload;
+
+    work = obj;
+
+    nxt_free(work);
+
+    /*
+     * The references are taken only by the router thread while
+     * configuring, so the pool is checked again in this thread.
+     */
+
+    offload = nxt_router->tls_offload;
+
+    if (offload != NULL && offload->count == 0 && offload->threads == 0) {
+        nxt_router_tls_offload_destroy(nxt_router);
+    }
+}
+
+
+static void
+nxt_router_tls_offload_destroy(nxt_router_t *router)
+{
+    nxt_tls_offload_t  *offload;
+
+    offload = router->tls_offload;
+
+    nxt_thread_log_debug("tls offload destroy");
+
+    /* The pool memory is freed by the runtime thread pool exit handler. */
+
+    nxt_thread_pool_destroy(offload->thread_pool);
+
+    nxt_free(offload);
+
+    router->tls_offload = NULL;
+}
+
 #endif
 
 
@@ -2675,9 +3263,10 @@ nxt_router_application_init(nxt_router_conf_t *rtcf, nxt_str_t *name,
 
 static nxt_socket_conf_t *
 nxt_router_socket_conf(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
-    nxt_str_t *name)
+    nxt_str_t *name, nxt_bool_t reuseport)
 {
-    size_t               size;
+    size_t               size, shards_size;
+    uint32_t             i, nshards;
     nxt_int_t            ret;
     nxt_bool_t           wildcard;
     nxt_sockaddr_t       *sa;
@@ -2702,18 +3291,49 @@ nxt_router_socket_conf(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
 
     size = nxt_sockaddr_size(sa);
 
-    ret = nxt_router_listen_socket_find(tmcf, skcf, sa);
+    /*
+     * A listener with "reuseport" gets a separate SO_REUSEPORT socket
+     * for each router thread, so the kernel balances connections between
+     * the threads instead of waking them all on a shared socket.
+     */
+
+    nshards = 0;
+
+#if (NXT_HAVE_UNIX_DOMAIN)
+    if (sa->u.sockaddr.sa_family == AF_UNIX) {
+        reuseport = 0;
+    }
+#endif
+
+    if (reuseport) {
+        nshards = tmcf->router_conf->threads;
+    }
+
+    ret = nxt_router_listen_socket_find(tmcf, skcf, sa, nshards);
 
     if (ret != NXT_OK) {
 
-        ls = nxt_zalloc(sizeof(nxt_listen_socket_t) + size);
+        shards_size = nxt_align_size(nshards * sizeof(nxt_socket_t),
+                                     NXT_ALIGNMENT);
+
+        ls = nxt_zalloc(sizeof(nxt_listen_socket_t) + shards_size + size);
         if (nxt_slow_path(ls == NULL)) {
             return NULL;
         }
 
         skcf->listen = ls;
 
-        ls->sockaddr = nxt_pointer_to(ls, sizeof(nxt_listen_socket_t));
+        if (nshards != 0) {
+            ls->nshards = nshards;
+            ls->shards = nxt_pointer_to(ls, sizeof(nxt_listen_socket_t));
+
+            for (i = 0; i < nshards; i++) {
+                ls->shards[i] = -1;
+            }
+        }
+
+        ls->sockaddr = nxt_pointer_to(ls, sizeof(nxt_listen_socket_t)
+                                          + shards_size);
         nxt_memcpy(ls->sockaddr, sa, size);
 
         nxt_listen_socket_remote_size(ls);
@@ -2756,7 +3376,7 @@ nxt_router_socket_conf(nxt_task_t *task, nxt_router_temp_conf_t *tmcf,
 
 static nxt_int_t
 nxt_router_listen_socket_find(nxt_router_temp_conf_t *tmcf,
-    nxt_socket_conf_t *nskcf, nxt_sockaddr_t *sa)
+    nxt_socket_conf_t *nskcf, nxt_sockaddr_t *sa, uint32_t nshards)
 {
     nxt_router_t       *router;
     nxt_queue_link_t   *qlk;
@@ -2770,7 +3390,15 @@ nxt_router_listen_socket_find(nxt_router_temp_conf_t *tmcf,
     {
         skcf = nxt_queue_link_data(qlk, nxt_socket_conf_t, link);
 
-        if (nxt_sockaddr_cmp(skcf->listen->sockaddr, sa)) {
+        /*
+         * Sharded sockets are kept only if the number of router threads
+         * has not changed, otherwise a new group of SO_REUSEPORT sockets
+         * is bound alongside the old one which is closed afterwards.
+         */
+
+        if (nxt_sockaddr_cmp(skcf->listen->sockaddr, sa)
+            && skcf->listen->nshards == nshards)
+        {
             nskcf->listen = skcf->listen;
 
             nxt_queue_remove(qlk);
@@ -2790,7 +3418,7 @@ nxt_router_listen_socket_find(nxt_router_temp_conf_t *tmcf,
 
 static void
 nxt_router_listen_socket_rpc_create(nxt_task_t *task,
-    nxt_router_temp_conf_t *tmcf, nxt_socket_conf_t *skcf)
+    nxt_router_temp_conf_t *tmcf, nxt_socket_conf_t *skcf, uint32_t shard)
 {
     size_t            size;
     uint32_t          stream;
@@ -2807,10 +3435,11 @@ nxt_router_listen_socket_rpc_create(nxt_task_t *task,
 
     rpc->socket_conf = skcf;
     rpc->temp_conf = tmcf;
+    rpc->shard = shard;
 
     size = nxt_sockaddr_size(skcf->listen->sockaddr);
 
-    b = nxt_buf_mem_alloc(tmcf->mem_pool, size, 0);
+    b = nxt_buf_mem_alloc(tmcf->mem_pool, size + 1, 0);
     if (b == NULL) {
         goto fail;
     }
@@ -2819,6 +3448,9 @@ nxt_router_listen_socket_rpc_create(nxt_task_t *task,
 
     b->mem.free = nxt_cpymem(b->mem.free, skcf->listen->sockaddr, size);
 
+    /* The SO_REUSEPORT flag follows the socket address. */
+    *b->mem.free++ = (skcf->listen->nshards != 0);
+
     rt = task->thread->runtime;
     main_port = rt->port_by_type[NXT_PROCESS_MAIN];
     router_port = rt->port_by_type[NXT_PROCESS_ROUTER];
@@ -2851,11 +3483,13 @@ static void
 nxt_router_listen_socket_ready(nxt_task_t *task, nxt_port_recv_msg_t *msg,
     void *data)
 {
-    nxt_int_t         ret;
-    nxt_socket_t      s;
-    nxt_socket_rpc_t  *rpc;
+    nxt_int_t            ret;
+    nxt_socket_t         s;
+    nxt_socket_rpc_t     *rpc;
+    nxt_listen_socket_t  *ls;
 
     rpc = data;
+    ls = rpc->socket_conf->listen;
 
     s = msg->fd[0];
 
@@ -2864,14 +3498,27 @@ nxt_router_listen_socket_ready(nxt_task_t *task, nxt_port_recv_msg_t *msg,
         goto fail;
     }
 
-    nxt_socket_defer_accept(task, s, rpc->socket_conf->listen->sockaddr);
+    nxt_socket_defer_accept(task, s, ls->sockaddr);
 
     ret = nxt_listen_socket(task, s, NXT_LISTEN_BACKLOG);
     if (nxt_slow_path(ret != NXT_OK)) {
         goto fail;
     }
 
-    rpc->socket_conf->listen->socket = s;
+    if (rpc->shard == 0) {
+        ls->socket = s;
+    }
+
+    if (ls->nshards != 0) {
+        ls->shards[rpc->shard] = s;
+
+        if (rpc->shard + 1 < ls->nshards) {
+            nxt_router_listen_socket_rpc_create(task, rpc->temp_conf,
+                                                rpc->socket_conf,
+                                                rpc->shard + 1);
+            return;
+        }
+    }
 
     nxt_work_queue_add(&task->thread->engine->fast_work_queue,
                        nxt_router_conf_apply, task, rpc->temp_conf, NULL);
@@ -2969,24 +3616,62 @@ nxt_router_tls_rpc_handler(nxt_task_t *task, nxt_port_recv_msg_t *msg,
         goto fail;
     }
 
-    mp = tmcf->router_conf->mem_pool;
-
     if (tls->socket_conf->tls == NULL){
+        mp = nxt_mp_create(1024, 128, 256, 32);
+        if (nxt_slow_path(mp == NULL)) {
+            goto fail;
+        }
+
         tlscf = nxt_mp_zget(mp, sizeof(nxt_tls_conf_t));
         if (nxt_slow_path(tlscf == NULL)) {
+            nxt_mp_destroy(mp);
             goto fail;
         }
 
+        tlscf->mem_pool = mp;
+        tlscf->count = 1;
         tlscf->no_wait_shutdown = 1;
+        tlscf->offload = tmcf->router_conf->tls_offload;
         tls->socket_conf->tls = tlscf;
 
+        if (tlscf->offload != NULL) {
+            (void) nxt_atomic_fetch_add(&tlscf->offload->count, 1);
+        }
+
+        tlscf->session_cache = tls->tls_init->session_cache;
+
+        if (tlscf->session_cache != NULL) {
+            (void) nxt_atomic_fetch_add(&tlscf->session_cache->count, 1);
+        }
+
+        tlscf->early_data = tls->tls_init->early_data;
+        tlscf->early_data_hellos = tls->tls_init->early_data_hellos;
+
+        if (tlscf->early_data_hellos != NULL) {
+            (void) nxt_atomic_fetch_add(&tlscf->early_data_hellos->count, 1);
+        }
+
+        if (nxt_slow_path(nxt_str_dup(mp, &tlscf->json, tls->json) == NULL)) {
+            goto fail;
+        }
+
+        if (tls->tls_init->records != NULL) {
+            tlscf->records = nxt_mp_get(mp, sizeof(nxt_tls_records_t));
+            if (nxt_slow_path(tlscf->records == NULL)) {
+                goto fail;
+            }
+
+            *tlscf->records = *tls->tls_init->records;
+        }
+
     } else {
         tlscf = tls->socket_conf->tls;
+        mp = tlscf->mem_pool;
     }
 
     tls->tls_init->conf = tlscf;
 
-    bundle = nxt_mp_get(mp, sizeof(nxt_tls_bundle_conf_t));
+    bundle = nxt_mp_zget(mp, sizeof(nxt_tls_bundle_conf_t));
     if (nxt_slow_path(bundle == NULL)) {
         goto fail;
     }
@@ -3196,6 +3881,7 @@ nxt_router_engines_create(nxt_task_t *task, nxt_router_t *router,
     nxt_int_t                 ret;
     nxt_uint_t                n, threads;
     nxt_queue_link_t          *qlk;
+    nxt_engine_counters_t     *counters;
     nxt_router_engine_conf_t  *recf;
 
     threads = tmcf->router_conf->threads;
@@ -3250,6 +3936,20 @@ nxt_router_engines_create(nxt_task_t *task, nxt_router_t *router,
             return NXT_ERROR;
         }
 
+        /*
+         * An engine added in place of a deleted one continues
+         * its cumulative counters.
+         */
+
+        counters = nxt_status_engine_counters(n);
+
+        if (nxt_fast_path(counters != NULL)) {
+            recf->engine->counters = counters;
+
+        } else {
+            nxt_alert(task, "router engine %ui counters are not shared", n);
+        }
+
         ret = nxt_router_engine_conf_create(tmcf, recf);
         if (nxt_slow_path(ret != NXT_OK)) {
             return ret;
@@ -3382,6 +4082,7 @@ nxt_router_engine_joints_create(nxt_router_temp_conf_t *tmcf,
         joint->socket_conf = skcf;
 
         joint->engine = recf->engine;
+        joint->shard = recf - (nxt_router_engine_conf_t *) tmcf->engines->elts;
     }
 
     return NXT_OK;
@@ -3684,7 +4385,13 @@ nxt_router_listen_socket_create(nxt_task_t *task, void *obj, void *data)
     skcf = joint->socket_conf;
     ls = skcf->listen;
 
-    lev = nxt_listen_event(task, ls);
+    if (ls->shards != NULL) {
+        lev = nxt_listen_shard_event(task, ls, joint->shard);
+
+    } else {
+        lev = nxt_listen_event(task, ls);
+    }
+
     if (nxt_slow_path(lev == NULL)) {
         nxt_router_listen_socket_release(task, skcf);
         return;
@@ -3709,19 +4416,16 @@ nxt_inline nxt_listen_event_t *
 nxt_router_listen_event(nxt_queue_t *listen_connections,
     nxt_socket_conf_t *skcf)
 {
-    nxt_socket_t        fd;
     nxt_queue_link_t    *qlk;
     nxt_listen_event_t  *lev;
 
-    fd = skcf->listen->socket;
-
     for (qlk = nxt_queue_first(listen_connections);
          qlk != nxt_queue_tail(listen_connections);
          qlk = nxt_queue_next(qlk))
     {
         lev = nxt_queue_link_data(qlk, nxt_listen_event_t, link);
 
-        if (fd == lev->socket.fd) {
+        if (lev->listen == skcf->listen) {
             return lev;
         }
     }
@@ -3856,6 +4560,7 @@ nxt_router_listen_socket_release(nxt_task_t *task, nxt_socket_conf_t *skcf)
     nxt_runtime_t          *rt;
     nxt_sockaddr_t         *sa;
 #endif
+    uint32_t               i;
     nxt_listen_socket_t    *ls;
     nxt_thread_spinlock_t  *lock;
 
@@ -3879,6 +4584,10 @@ nxt_router_listen_socket_release(nxt_task_t *task, nxt_socket_conf_t *skcf)
 
     nxt_socket_close(task, ls->socket);
 
+    for (i = 1; i < ls->nshards; i++) {
+        nxt_socket_close(task, ls->shards[i]);
+    }
+
 #if (NXT_HAVE_UNIX_DOMAIN)
     sa = ls->sockaddr;
     if (sa->u.sockaddr.sa_family != AF_UNIX
@@ -3983,7 +4692,7 @@ nxt_router_conf_release(nxt_task_t *task, nxt_socket_conf_joint_t *joint)
 
 #if (NXT_TLS)
     if (skcf != NULL && skcf->tls != NULL) {
-        task->thread->runtime->tls->server_free(task, skcf->tls);
+        nxt_router_tls_conf_release(task, skcf->tls);
     }
 #endif
 
@@ -4233,6 +4942,7 @@ nxt_router_req_headers_ack_handler(nxt_task_t *task,
     nxt_port_recv_msg_t *msg, nxt_request_rpc_data_t *req_rpc_data)
 {
     int                 res;
+    int32_t             wait;
     nxt_app_t           *app;
     nxt_buf_t           *b;
     nxt_bool_t          start_process, unlinked;
@@ -4259,6 +4969,14 @@ nxt_router_req_headers_ack_handler(nxt_task_t *task,
         nxt_queue_remove(&r->app_link);
         r->app_link.next = NULL;
 
+        app->queued_requests--;
+
+        wait = nxt_msec_diff(task->thread->engine->timers.now,
+                             r->app_queue_start);
+
+        app->wait_total += nxt_max(wait, 0);
+        app->wait_count++;
+
         unlinked = 1;
     }
 
@@ -4320,6 +5038,10 @@ nxt_router_req_headers_ack_handler(nxt_task_t *task,
 
     nxt_thread_mutex_unlock(&app->mutex);
 
+    if (req_rpc_data->affinity_port != NULL) {
+        nxt_router_app_affinity_release(task, req_rpc_data);
+    }
+
     if (unlinked) {
         nxt_mp_release(r->mem_pool);
     }
@@ -4363,6 +5085,9 @@ nxt_router_req_headers_ack_handler(nxt_task_t *task,
         r->timer.handler = nxt_router_app_timeout;
         r->timer_data = req_rpc_data;
         nxt_timer_add(task->thread->engine, &r->timer, app->timeout);
+
+    } else if (app->queue_wait != 0) {
+        nxt_timer_disable(task->thread->engine, &r->timer);
     }
 }
 
@@ -4574,6 +5299,8 @@ nxt_router_app_port_error(nxt_task_t *task, nxt_port_recv_msg_t *msg,
 
         nxt_queue_remove(link);
         link->next = NULL;
+
+        app->queued_requests--;
     }
 
     nxt_thread_mutex_unlock(&app->mutex);
@@ -4594,6 +5321,8 @@ nxt_router_app_port_error(nxt_task_t *task, nxt_port_recv_msg_t *msg,
 
             nxt_queue_remove(link);
             link->next = NULL;
+
+            app->queued_requests--;
         }
 
         nxt_thread_mutex_unlock(&app->mutex);
@@ -4911,8 +5640,9 @@ nxt_router_adjust_idle_timer(nxt_task_t *task, void *obj, void *data)
               &app->name,
               (int) app->idle_processes, (int) app->spare_processes);
 
-    while (app->idle_processes > app->spare_processes) {
-
+    while (app->idle_processes > app->spare_processes
+           && app->processes > app->scale_target)
+    {
         nxt_assert(!nxt_queue_is_empty(&app->idle_ports));
 
         lnk = nxt_queue_first(&app->idle_ports);
@@ -4985,6 +5715,114 @@ nxt_router_app_idle_timeout(nxt_task_t *task, void *obj, void *data)
 }
 
 
+static void
+nxt_router_app_scale(nxt_task_t *task, nxt_app_t *app)
+{
+    int32_t             age;
+    uint32_t            n, start, target;
+    nxt_bool_t          reap;
+    nxt_msec_t          wait;
+    nxt_http_request_t  *r;
+    nxt_event_engine_t  *engine;
+
+    engine = task->thread->engine;
+
+    nxt_assert(app->engine == engine);
+
+    start = 0;
+    reap = 0;
+
+    nxt_thread_mutex_lock(&app->mutex);
+
+    wait = (app->wait_count != 0) ? app->wait_total / app->wait_count : 0;
+
+    app->wait_total = 0;
+    app->wait_count = 0;
+
+    /* Requests that still wait for a process count as well. */
+    if (!nxt_queue_is_empty(&app->ack_waiting_req)) {
+        r = nxt_queue_link_data(nxt_queue_first(&app->ack_waiting_req),
+                                nxt_http_request_t, app_link);
+
+        age = nxt_msec_diff(engine->timers.now, r->app_queue_start);
+
+        wait = nxt_max(wait, (nxt_msec_t) nxt_max(age, 0));
+    }
+
+    app->wait_latency = wait;
+
+    if (wait > app->target_latency) {
+        app->scale_calm = 0;
+
+        if (app->scale_target < app->max_processes) {
+            target = nxt_max(app->scale_target,
+                             app->processes + app->pending_processes);
+
+            n = nxt_max(app->queued_requests, 1);
+
+            app->scale_target = nxt_min(target + n, app->max_processes);
+            app->scale_ups++;
+
+            nxt_debug(task, "app '%V' scale up to %uD, wait %M",
+                      &app->name, app->scale_target, wait);
+        }
+
+    } else if (wait < app->target_latency / 2) {
+
+        if (app->scale_target > app->spare_processes
+            && ++app->scale_calm >= NXT_ROUTER_SCALE_CALM)
+        {
+            app->scale_calm = 0;
+            app->scale_target--;
+            app->scale_downs++;
+
+            reap = 1;
+
+            nxt_debug(task, "app '%V' scale down to %uD, wait %M",
+                      &app->name, app->scale_target, wait);
+        }
+
+    } else {
+        app->scale_calm = 0;
+    }
+
+    while (app->processes + app->pending_processes < app->scale_target
+           && nxt_router_app_can_start(app))
+    {
+        app->pending_processes++;
+        start++;
+    }
+
+    nxt_thread_mutex_unlock(&app->mutex);
+
+    while (start != 0) {
+        nxt_router_start_app_process(task, app);
+        start--;
+    }
+
+    if (reap) {
+        nxt_router_adjust_idle_timer(task, app, NULL);
+    }
+
+    nxt_timer_add(engine, &app->joint->scale_timer, NXT_ROUTER_SCALE_INTERVAL);
+}
+
+
+static void
+nxt_router_app_scale_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_timer_t      *timer;
+    nxt_app_joint_t  *app_joint;
+
+    timer = obj;
+    app_joint = nxt_container_of(timer, nxt_app_joint_t, scale_timer);
+
+    if (nxt_fast_path(app_joint->app != NULL)) {
+        nxt_router_app_scale(task, app_joint->app);
+    }
+}
+
+
 static void
 nxt_router_app_joint_release_handler(nxt_task_t *task, void *obj, void *data)
 {
@@ -4998,6 +5836,20 @@ nxt_router_app_joint_release_handler(nxt_task_t *task, void *obj, void *data)
 }
 
 
+static void
+nxt_router_app_joint_scale_release_handler(nxt_task_t *task, void *obj,
+    void *data)
+{
+    nxt_timer_t      *timer;
+    nxt_app_joint_t  *app_joint;
+
+    timer = obj;
+    app_joint = nxt_container_of(timer, nxt_app_joint_t, scale_timer);
+
+    nxt_router_app_joint_use(task, app_joint, -1);
+}
+
+
 static void
 nxt_router_free_app(nxt_task_t *task, void *obj, void *data)
 {
@@ -5081,6 +5933,14 @@ nxt_router_free_app(nxt_task_t *task, void *obj, void *data)
 
     app_joint->app = NULL;
 
+    if (nxt_timer_delete(task->thread->engine, &app_joint->scale_timer)) {
+        nxt_router_app_joint_use(task, app_joint, 1);
+
+        app_joint->scale_timer.handler =
+                                    nxt_router_app_joint_scale_release_handler;
+        nxt_timer_add(task->thread->engine, &app_joint->scale_timer, 0);
+    }
+
     if (nxt_timer_delete(task->thread->engine, &app_joint->idle_timer)) {
         app_joint->idle_timer.handler = nxt_router_app_joint_release_handler;
         nxt_timer_add(task->thread->engine, &app_joint->idle_timer, 0);
@@ -5121,6 +5981,18 @@ nxt_router_app_port_get(nxt_task_t *task, nxt_app_t *app,
      */
     nxt_queue_insert_tail(&app->ack_waiting_req, &r->app_link);
 
+    r->app_queue_start = task->thread->engine->timers.now;
+    app->queued_requests++;
+
+    if (r->app_affinity != 0) {
+        req_rpc_data->affinity_port = nxt_router_app_affinity_port(app,
+                                                              r->app_affinity);
+    }
+
+    if (r->action != NULL && r->action->priority != NXT_APP_QUEUE_NORMAL) {
+        app->prioritized = 1;
+    }
+
     nxt_thread_mutex_unlock(&app->mutex);
 
     /*
@@ -5132,16 +6004,179 @@ nxt_router_app_port_get(nxt_task_t *task, nxt_app_t *app,
     req_rpc_data->app_port = port;
     req_rpc_data->apr_action = NXT_APR_REQUEST_FAILED;
 
+    if (app->queue_wait != 0) {
+        r->timer.handler = nxt_router_app_queue_timeout;
+        r->timer_data = req_rpc_data;
+        nxt_timer_add(task->thread->engine, &r->timer, app->queue_wait);
+    }
+
     if (start_process) {
         nxt_router_start_app_process(task, app);
     }
 }
 
 
+/*
+ * Picks the process for the affinity key by rendezvous hashing, so a key
+ * moves only when its own process goes away.  If that process is busy,
+ * the request is left to the shared queue.  Called with app->mutex held.
+ */
+
+static nxt_port_t *
+nxt_router_app_affinity_port(nxt_app_t *app, uint32_t affinity)
+{
+    uint32_t    key, weight, max;
+    nxt_port_t  *port, *best;
+
+    best = NULL;
+    max = 0;
+
+    nxt_queue_each(port, &app->ports, nxt_port_t, app_link) {
+
+        key = affinity ^ ((uint32_t) port->pid * 0x9E3779B1);
+        weight = nxt_murmur_hash2_uint32(&key);
+
+        if (best == NULL || weight > max) {
+            best = port;
+            max = weight;
+        }
+
+    } nxt_queue_loop;
+
+    if (best == NULL
+        || best->queue == NULL
+        || best->active_requests + best->affinity_requests >= app->threads)
+    {
+        return NULL;
+    }
+
+    best->affinity_requests++;
+
+    nxt_port_inc_use(best);
+
+    return best;
+}
+
+
+static void
+nxt_router_app_affinity_release(nxt_task_t *task,
+    nxt_request_rpc_data_t *req_rpc_data)
+{
+    nxt_app_t   *app;
+    nxt_port_t  *port;
+
+    app = req_rpc_data->app;
+    port = req_rpc_data->affinity_port;
+
+    req_rpc_data->affinity_port = NULL;
+
+    nxt_thread_mutex_lock(&app->mutex);
+
+    port->affinity_requests--;
+
+    nxt_thread_mutex_unlock(&app->mutex);
+
+    nxt_port_use(task, port, -1);
+}
+
+
+nxt_inline nxt_uint_t
+nxt_router_app_retry_after(nxt_app_t *app)
+{
+    /* Retry-After is in seconds, round the queue wait time up. */
+    return nxt_max((app->queue_wait + 999) / 1000, 1);
+}
+
+
+static nxt_uint_t
+nxt_router_app_admit(nxt_task_t *task, nxt_app_t *app)
+{
+    int32_t             age;
+    nxt_bool_t          reject;
+    nxt_http_request_t  *r;
+
+    reject = 0;
+
+    nxt_thread_mutex_lock(&app->mutex);
+
+    if (app->queue_size != 0 && app->queued_requests >= app->queue_size) {
+        reject = 1;
+
+    } else if (app->queue_wait != 0
+               && !nxt_queue_is_empty(&app->ack_waiting_req))
+    {
+        r = nxt_queue_link_data(nxt_queue_first(&app->ack_waiting_req),
+                                nxt_http_request_t, app_link);
+
+        age = nxt_msec_diff(task->thread->engine->timers.now,
+                            r->app_queue_start);
+
+        reject = (age >= (int32_t) app->queue_wait);
+    }
+
+    nxt_thread_mutex_unlock(&app->mutex);
+
+    if (!reject) {
+        return 0;
+    }
+
+    nxt_debug(task, "app '%V' queue is full, %uD requests",
+              &app->name, app->queued_requests);
+
+    return nxt_router_app_retry_after(app);
+}
+
+
+static nxt_int_t
+nxt_router_app_affinity(nxt_task_t *task, nxt_http_request_t *r)
+{
+    nxt_int_t          ret;
+    nxt_str_t          key;
+    nxt_tstr_t         *affinity;
+    nxt_router_conf_t  *rtcf;
+
+    r->app_affinity = 0;
+
+    if (r->action == NULL || r->action->affinity == NULL) {
+        return NXT_OK;
+    }
+
+    affinity = r->action->affinity;
+
+    if (nxt_tstr_is_const(affinity)) {
+        nxt_tstr_str(affinity, &key);
+
+    } else {
+        rtcf = r->conf->socket_conf->router_conf;
+
+        ret = nxt_tstr_query_init(&r->tstr_query, rtcf->tstr_state,
+                                  &r->tstr_cache, r, r->mem_pool);
+        if (nxt_slow_path(ret != NXT_OK)) {
+            return NXT_ERROR;
+        }
+
+        nxt_tstr_query(task, r->tstr_query, affinity, &key);
+
+        if (nxt_slow_path(nxt_tstr_query_failed(r->tstr_query))) {
+            return NXT_ERROR;
+        }
+    }
+
+    /* An empty key means no affinity; zero is reserved for that. */
+
+    if (key.length != 0) {
+        r->app_affinity = nxt_murmur_hash2(key.start, key.length) | 1;
+    }
+
+    return NXT_OK;
+}
+
+
 void
 nxt_router_process_http_request(nxt_task_t *task, nxt_http_request_t *r,
     nxt_http_action_t *action)
 {
+    nxt_uint_t              retry_after;
     nxt_event_engine_t      *engine;
     nxt_http_app_conf_t     *conf;
     nxt_request_rpc_data_t  *req_rpc_data;
@@ -5151,6 +6186,21 @@ nxt_router_process_http_request(nxt_task_t *task, nxt_http_request_t *r,
 
     r->app_target = conf->target;
 
+    if (nxt_slow_path(nxt_router_app_affinity(task, r) != NXT_OK)) {
+        nxt_http_request_error(task, r, NXT_HTTP_INTERNAL_SERVER_ERROR);
+        return;
+    }
+
+    if (conf->app->queue_size != 0 || conf->app->queue_wait != 0) {
+        retry_after = nxt_router_app_admit(task, conf->app);
+
+        if (retry_after != 0) {
+            nxt_http_request_error_retry(task, r, NXT_HTTP_SERVICE_UNAVAILABLE,
+                                         retry_after);
+            return;
+        }
+    }
+
     req_rpc_data = nxt_port_rpc_register_handler_ex(task, engine->port,
                                           nxt_router_response_ready_handler,
                                           nxt_router_response_error_handler,
@@ -5184,6 +6234,7 @@ nxt_router_process_http_request(nxt_task_t *task, nxt_http_request_t *r,
     req_rpc_data->app = conf->app;
     req_rpc_data->msg_info.body_fd = -1;
     req_rpc_data->rpc_cancel = 1;
+    req_rpc_data->affinity_port = NULL;
 
     nxt_router_app_use(task, conf->app, 1);
 
@@ -5242,7 +6293,9 @@ nxt_router_app_prepare_request(nxt_task_t *task,
     nxt_app_t         *app;
     nxt_buf_t         *buf, *body;
     nxt_int_t         res;
-    nxt_port_t        *port, *reply_port;
+    nxt_uint_t        lane;
+    nxt_port_t        *port, *reply_port, *affinity_port;
+    nxt_http_action_t *action;
 
     int                   notify;
     struct {
@@ -5307,7 +6360,38 @@ nxt_router_app_prepare_request(nxt_task_t *task,
     msg.mm.chunk_id = nxt_port_mmap_chunk_id(hdr, buf->mem.pos);
     msg.mm.size = nxt_buf_used_size(buf);
 
-    res = nxt_app_queue_send(port->queue, &msg, sizeof(msg),
+    affinity_port = req_rpc_data->affinity_port;
+
+    if (affinity_port != NULL) {
+        res = nxt_port_queue_send(affinity_port->queue, &msg, sizeof(msg),
+                                  &notify);
+        if (nxt_fast_path(res == NXT_OK)) {
+            nxt_debug(task, "stream #%uD: sent to app process %PI",
+                      req_rpc_data->stream, affinity_port->pid);
+
+            nxt_port_rpc_ex_set_peer(task, reply_port, req_rpc_data,
+                                     affinity_port->pid);
+
+            if (notify != 0) {
+                (void) nxt_port_socket_write(task, affinity_port,
+                                             NXT_PORT_MSG_READ_QUEUE,
+                                             -1, req_rpc_data->stream,
+                                             reply_port->id, NULL);
+            }
+
+            buf->is_port_mmap_sent = 1;
+            buf->mem.pos = buf->mem.free;
+
+            return;
+        }
+
+        nxt_router_app_affinity_release(task, req_rpc_data);
+    }
+
+    action = req_rpc_data->request->action;
+    lane = (action != NULL) ? action->priority : NXT_APP_QUEUE_NORMAL;
+
+    res = nxt_app_queue_send(port->queue, lane, &msg, sizeof(msg),
                              req_rpc_data->stream, &notify,
                              &req_rpc_data->msg_info.tracking_cookie);
     if (nxt_fast_path(res == NXT_OK)) {
@@ -5667,6 +6751,27 @@ nxt_router_prepare_msg(nxt_task_t *task, nxt_http_request_t *r,
 }
 
 
+static void
+nxt_router_app_queue_timeout(nxt_task_t *task, void *obj, void *data)
+{
+    nxt_timer_t              *timer;
+    nxt_http_request_t       *r;
+    nxt_request_rpc_data_t   *req_rpc_data;
+
+    timer = obj;
+
+    r = nxt_timer_data(timer, nxt_http_request_t, timer);
+    req_rpc_data = r->timer_data;
+
+    nxt_debug(task, "router app queue timeout");
+
+    nxt_http_request_error_retry(task, r, NXT_HTTP_SERVICE_UNAVAILABLE,
+                             nxt_router_app_retry_after(req_rpc_data->app));
+
+    nxt_request_rpc_data_unlink(task, req_rpc_data);
+}
+
+
 static void
 nxt_router_app_timeout(nxt_task_t *task, void *obj, void *data)
 {
@@ -35,6 +35,11 @@ typedef struct {
     nxt_queue_t              apps;     /* of nxt_app_t */
 
     nxt_router_access_log_t  *access_log;
+
+#if (NXT_TLS)
+    nxt_tls_offload_t        *tls_offload;
+    nxt_queue_t              tls_session_caches;
+#endif
 } nxt_router_t;
 
 
@@ -54,6 +59,11 @@ typedef struct {
 
     nxt_router_access_log_t  *access_log;
     nxt_tstr_t               *log_format;
+
+#if (NXT_TLS)
+    uint32_t                 tls_handshake_threads;
+    nxt_tls_offload_t        *tls_offload;
+#endif
 } nxt_router_conf_t;
 
 
@@ -104,6 +114,7 @@ typedef struct {
     uint32_t               use_count;
     nxt_app_t              *app;
     nxt_timer_t            idle_timer;
+    nxt_timer_t            scale_timer;
     nxt_work_t             free_app_work;
 } nxt_app_joint_t;
 
@@ -123,6 +134,7 @@ struct nxt_app_s {
     uint32_t               port_hash_count;
 
     uint32_t               active_requests;
+    uint32_t               queued_requests;
     uint32_t               pending_processes;
     uint32_t               processes;
     uint32_t               idle_processes;
@@ -136,6 +148,21 @@ struct nxt_app_s {
 
     nxt_msec_t             timeout;
     nxt_msec_t             idle_timeout;
+    nxt_msec_t             target_latency;
+
+    uint32_t               queue_size;
+    nxt_msec_t             queue_wait;
+    uint32_t               threads;
+    uint8_t                prioritized;  /* 1 bit */
+
+    /* Autoscaler state, protected by mutex. */
+    uint32_t               scale_target;
+    uint32_t               scale_calm;
+    uint32_t               scale_ups;
+    uint32_t               scale_downs;
+    uint32_t               wait_count;
+    nxt_msec_t             wait_total;
+    nxt_msec_t             wait_latency;
 
     nxt_str_t              *targets;
 
@@ -222,6 +249,9 @@ typedef struct {
     nxt_event_engine_t     *engine;
     nxt_socket_conf_t      *socket_conf;
 
+    /* Index of the SO_REUSEPORT socket used by the engine. */
+    uint32_t               shard;
+
     nxt_joint_job_t        *close_job;
 
     nxt_upstream_t         **upstreams;
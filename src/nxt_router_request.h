@@ -28,6 +28,7 @@ typedef struct {
     nxt_app_t               *app;
 
     nxt_port_t              *app_port;
+    nxt_port_t              *affinity_port;
     nxt_apr_action_t        apr_action;
 
     nxt_http_request_t      *request;
@@ -11,6 +11,7 @@
 #include <nxt_main_process.h>
 #include <nxt_router.h>
 #include <nxt_regex.h>
+#include <nxt_status.h>
 
 
 static nxt_int_t nxt_runtime_inherited_listen_sockets(nxt_task_t *task,
@@ -127,6 +128,10 @@ nxt_runtime_create(nxt_task_t *task)
         goto fail;
     }
 
+    if (nxt_status_init() != NXT_OK) {
+        goto fail;
+    }
+
     if (nxt_slow_path(nxt_http_register_variables() != NXT_OK)) {
         goto fail;
     }
@@ -315,8 +320,8 @@ nxt_runtime_event_engines(nxt_task_t *task, nxt_runtime_t *rt)
 static nxt_int_t
 nxt_runtime_thread_pools(nxt_thread_t *thr, nxt_runtime_t *rt)
 {
-    nxt_int_t    ret;
-    nxt_array_t  *thread_pools;
+    nxt_array_t        *thread_pools;
+    nxt_thread_pool_t  *tp;
 
     thread_pools = nxt_array_create(rt->mem_pool, 1,
                                     sizeof(nxt_thread_pool_t *));
@@ -326,9 +331,9 @@ nxt_runtime_thread_pools(nxt_thread_t *thr, nxt_runtime_t *rt)
     }
 
     rt->thread_pools = thread_pools;
-    ret = nxt_runtime_thread_pool_create(thr, rt, 2, 60000 * 1000000LL);
+    tp = nxt_runtime_thread_pool_create(thr, rt, 2, 60000 * 1000000LL);
 
-    if (nxt_slow_path(ret != NXT_OK)) {
+    if (nxt_slow_path(tp == NULL)) {
         return NXT_ERROR;
     }
 
@@ -669,7 +674,7 @@ nxt_runtime_event_engine_free(nxt_runtime_t *rt)
 }
 
 
-nxt_int_t
+nxt_thread_pool_t *
 nxt_runtime_thread_pool_create(nxt_thread_t *thr, nxt_runtime_t *rt,
     nxt_uint_t max_threads, nxt_nsec_t timeout)
 {
@@ -677,7 +682,7 @@ nxt_runtime_thread_pool_create(nxt_thread_t *thr, nxt_runtime_t *rt,
 
     tp = nxt_array_add(rt->thread_pools);
     if (tp == NULL) {
-        return NXT_ERROR;
+        return NULL;
     }
 
     thread_pool = nxt_thread_pool_create(max_threads, timeout,
@@ -685,11 +690,14 @@ nxt_runtime_thread_pool_create(nxt_thread_t *thr, nxt_runtime_t *rt,
                                          thr->engine,
                                          nxt_runtime_thread_pool_exit);
 
-    if (nxt_fast_path(thread_pool != NULL)) {
-        *tp = thread_pool;
+    if (nxt_slow_path(thread_pool == NULL)) {
+        nxt_array_remove_last(rt->thread_pools);
+        return NULL;
     }
 
-    return NXT_OK;
+    *tp = thread_pool;
+
+    return thread_pool;
 }
 
 
@@ -820,6 +828,17 @@ nxt_runtime_conf_init(nxt_task_t *task, nxt_runtime_t *rt)
         return NXT_ERROR;
     }
 
+#if (NXT_HAVE_IO_URING)
+
+    if (interface == &nxt_io_uring_engine && !nxt_io_uring_available(task)) {
+        interface = nxt_service_get(rt->services, "engine", NULL);
+
+        nxt_log(task, NXT_LOG_WARN, "io_uring engine is not available, "
+                "falling back to %s", interface->name);
+    }
+
+#endif
+
     rt->engine = interface->name;
 
     ret = nxt_file_name_create(rt->mem_pool, &file_name, "%s%Z", rt->pid);
@@ -889,6 +908,22 @@ nxt_runtime_conf_init(nxt_task_t *task, nxt_runtime_t *rt)
 
     rt->conf_tmp = (char *) file_name.start;
 
+    ret = nxt_file_name_create(rt->mem_pool, &file_name, "%s%sconf.digest%Z",
+                               rt->state, slash);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    rt->conf_digest = (char *) file_name.start;
+
+    ret = nxt_file_name_create(rt->mem_pool, &file_name, "%s.tmp%Z",
+                               rt->conf_digest);
+    if (nxt_slow_path(ret != NXT_OK)) {
+        return NXT_ERROR;
+    }
+
+    rt->conf_digest_tmp = (char *) file_name.start;
+
     ret = nxt_file_name_create(rt->mem_pool, &file_name, "%s%scerts/%Z",
                                rt->state, slash);
     if (nxt_slow_path(ret != NXT_OK)) {
@@ -965,6 +1000,8 @@ nxt_runtime_conf_read_cmd(nxt_task_t *task, nxt_runtime_t *rt)
     static const char  no_state[] =
                        "option \"--statedir\" requires directory\n";
     static const char  no_tmp[] = "option \"--tmpdir\" requires directory\n";
+    static const char  no_engine[] =
+                       "option \"--engine\" requires event engine name\n";
 
     static const char  modules_deprecated[] =
            "option \"--modules\" is deprecated; use \"--modulesdir\" instead\n";
@@ -999,6 +1036,10 @@ nxt_runtime_conf_read_cmd(nxt_task_t *task, nxt_runtime_t *rt)
         "  --tmpdir DIR         set tmp directory name\n"
         "                       default: \"" NXT_TMPDIR "\"\n"
         "\n"
+        "  --engine NAME        set event engine, \"io_uring\" falls back\n"
+        "                       to the default if it is not available\n"
+        "                       default: the first one supported\n"
+        "\n"
         "  --modules DIR        [deprecated] synonym for --modulesdir\n"
         "  --state DIR          [deprecated] synonym for --statedir\n"
         "  --tmp DIR            [deprecated] synonym for --tmpdir\n"
@@ -1143,6 +1184,19 @@ nxt_runtime_conf_read_cmd(nxt_task_t *task, nxt_runtime_t *rt)
             continue;
         }
 
+        if (nxt_strcmp(p, "--engine") == 0) {
+            if (*argv == NULL) {
+                write(STDERR_FILENO, no_engine, nxt_length(no_engine));
+                return NXT_ERROR;
+            }
+
+            p = *argv++;
+
+            rt->engine = p;
+
+            continue;
+        }
+
         if (nxt_strcmp(p, "--no-daemon") == 0) {
             rt->daemon = 0;
             continue;
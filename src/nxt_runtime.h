@@ -70,6 +70,8 @@ struct nxt_runtime_s {
     const char             *ver_tmp;
     const char             *conf;
     const char             *conf_tmp;
+    const char             *conf_digest;
+    const char             *conf_digest_tmp;
     const char             *control;
     const char             *tmp;
 
@@ -92,8 +94,8 @@ void nxt_runtime_quit(nxt_task_t *task, nxt_uint_t status);
 
 void nxt_runtime_event_engine_free(nxt_runtime_t *rt);
 
-nxt_int_t nxt_runtime_thread_pool_create(nxt_thread_t *thr, nxt_runtime_t *rt,
-    nxt_uint_t max_threads, nxt_nsec_t timeout);
+nxt_thread_pool_t *nxt_runtime_thread_pool_create(nxt_thread_t *thr,
+    nxt_runtime_t *rt, nxt_uint_t max_threads, nxt_nsec_t timeout);
 
 
 void nxt_runtime_process_add(nxt_task_t *task, nxt_process_t *process);
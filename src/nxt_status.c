@@ -8,14 +8,96 @@
 #include <nxt_status.h>
 
 
+/*
+ * Each router engine updates its own counters without locks, so
+ * the counters of different engines are placed in separate cache lines.
+ */
+
+typedef struct {
+    nxt_engine_counters_t  counters  nxt_aligned(64);
+} nxt_status_engine_t;
+
+
+typedef struct {
+    nxt_atomic_t           engines;
+    nxt_status_engine_t    engine[NXT_STATUS_ENGINES];
+} nxt_status_shm_t;
+
+
+static nxt_status_shm_t  *nxt_status_shm;
+
+
+nxt_int_t
+nxt_status_init(void)
+{
+    void  *p;
+
+    if (nxt_status_shm != NULL) {
+        return NXT_OK;
+    }
+
+    /* The mapping is inherited by the router and controller processes. */
+
+    p = nxt_mem_mmap(NULL, sizeof(nxt_status_shm_t), PROT_READ | PROT_WRITE,
+                     MAP_ANON | MAP_SHARED, -1, 0);
+
+    if (nxt_slow_path(p == MAP_FAILED)) {
+        return NXT_ERROR;
+    }
+
+    nxt_status_shm = p;
+
+    return NXT_OK;
+}
+
+
+nxt_engine_counters_t *
+nxt_status_engine_counters(nxt_uint_t n)
+{
+    if (nxt_slow_path(nxt_status_shm == NULL || n >= NXT_STATUS_ENGINES)) {
+        return NULL;
+    }
+
+    if (nxt_status_shm->engines <= n) {
+        nxt_status_shm->engines = n + 1;
+    }
+
+    return &nxt_status_shm->engine[n].counters;
+}
+
+
+void
+nxt_status_counters(nxt_status_report_t *report)
+{
+    nxt_uint_t             n, engines;
+    nxt_engine_counters_t  *counters;
+
+    if (nxt_slow_path(nxt_status_shm == NULL)) {
+        return;
+    }
+
+    engines = nxt_status_shm->engines;
+
+    for (n = 0; n < engines; n++) {
+        counters = &nxt_status_shm->engine[n].counters;
+
+        report->accepted_conns += counters->accepted_conns;
+        report->idle_conns += counters->idle_conns;
+        report->closed_conns += counters->closed_conns;
+        report->requests += counters->requests;
+    }
+}
+
+
 nxt_conf_value_t *
 nxt_status_get(nxt_status_report_t *report, nxt_mp_t *mp)
 {
     size_t            i;
     nxt_str_t         name;
+    nxt_uint_t        n;
     nxt_int_t         ret;
     nxt_status_app_t  *app;
-    nxt_conf_value_t  *status, *obj, *apps, *app_obj;
+    nxt_conf_value_t  *status, *obj, *apps, *app_obj, *handshakes;
 
     static nxt_str_t conns_str = nxt_string("connections");
     static nxt_str_t acc_str = nxt_string("accepted");
@@ -28,8 +110,21 @@ nxt_status_get(nxt_status_report_t *report, nxt_mp_t *mp)
     static nxt_str_t procs_str = nxt_string("processes");
     static nxt_str_t run_str = nxt_string("running");
     static nxt_str_t start_str = nxt_string("starting");
+    static nxt_str_t scaling_str = nxt_string("scaling");
+    static nxt_str_t target_str = nxt_string("target");
+    static nxt_str_t queued_str = nxt_string("queued");
+    static nxt_str_t latency_str = nxt_string("latency");
+    static nxt_str_t ups_str = nxt_string("scale_ups");
+    static nxt_str_t downs_str = nxt_string("scale_downs");
+    static nxt_str_t queue_str = nxt_string("queue");
+    static nxt_str_t high_str = nxt_string("high");
+    static nxt_str_t normal_str = nxt_string("normal");
+    static nxt_str_t low_str = nxt_string("low");
+    static nxt_str_t tls_str = nxt_string("tls");
+    static nxt_str_t handshakes_str = nxt_string("handshakes");
+    static nxt_str_t offloaded_str = nxt_string("offloaded");
 
-    status = nxt_conf_create_object(mp, 3);
+    status = nxt_conf_create_object(mp, 3 + report->tls_offload);
     if (nxt_slow_path(status == NULL)) {
         return NULL;
     }
@@ -57,17 +152,42 @@ nxt_status_get(nxt_status_report_t *report, nxt_mp_t *mp)
 
     nxt_conf_set_member_integer(obj, &total_str, report->requests, 0);
 
+    n = 2;
+
+    if (report->tls_offload) {
+        obj = nxt_conf_create_object(mp, 1);
+        if (nxt_slow_path(obj == NULL)) {
+            return NULL;
+        }
+
+        nxt_conf_set_member(status, &tls_str, obj, n++);
+
+        handshakes = nxt_conf_create_object(mp, 2);
+        if (nxt_slow_path(handshakes == NULL)) {
+            return NULL;
+        }
+
+        nxt_conf_set_member(obj, &handshakes_str, handshakes, 0);
+
+        nxt_conf_set_member_integer(handshakes, &queued_str,
+                                    report->tls_handshakes_queued, 0);
+        nxt_conf_set_member_integer(handshakes, &offloaded_str,
+                                    report->tls_handshakes_offloaded, 1);
+    }
+
     apps = nxt_conf_create_object(mp, report->apps_count);
     if (nxt_slow_path(apps == NULL)) {
         return NULL;
     }
 
-    nxt_conf_set_member(status, &apps_str, apps, 2);
+    nxt_conf_set_member(status, &apps_str, apps, n);
 
     for (i = 0; i < report->apps_count; i++) {
         app = &report->apps[i];
 
-        app_obj = nxt_conf_create_object(mp, 2);
+        n = 2 + (app->target_latency != 0) + app->prioritized;
+
+        app_obj = nxt_conf_create_object(mp, n);
         if (nxt_slow_path(app_obj == NULL)) {
             return NULL;
         }
@@ -99,6 +219,38 @@ nxt_status_get(nxt_status_report_t *report, nxt_mp_t *mp)
         nxt_conf_set_member(app_obj, &reqs_str, obj, 1);
 
         nxt_conf_set_member_integer(obj, &active_str, app->active_requests, 0);
+
+        n = 2;
+
+        if (app->prioritized) {
+            obj = nxt_conf_create_object(mp, 3);
+            if (nxt_slow_path(obj == NULL)) {
+                return NULL;
+            }
+
+            nxt_conf_set_member(app_obj, &queue_str, obj, n++);
+
+            nxt_conf_set_member_integer(obj, &high_str, app->queue_high, 0);
+            nxt_conf_set_member_integer(obj, &normal_str, app->queue_normal, 1);
+            nxt_conf_set_member_integer(obj, &low_str, app->queue_low, 2);
+        }
+
+        if (app->target_latency == 0) {
+            continue;
+        }
+
+        obj = nxt_conf_create_object(mp, 5);
+        if (nxt_slow_path(obj == NULL)) {
+            return NULL;
+        }
+
+        nxt_conf_set_member(app_obj, &scaling_str, obj, n);
+
+        nxt_conf_set_member_integer(obj, &target_str, app->scale_target, 0);
+        nxt_conf_set_member_integer(obj, &queued_str, app->queued_requests, 1);
+        nxt_conf_set_member_integer(obj, &latency_str, app->wait_latency, 2);
+        nxt_conf_set_member_integer(obj, &ups_str, app->scale_ups, 3);
+        nxt_conf_set_member_integer(obj, &downs_str, app->scale_downs, 4);
     }
 
     return status;
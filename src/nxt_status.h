@@ -7,12 +7,27 @@
 #define _NXT_STATUS_H_INCLUDED_
 
 
+#define NXT_STATUS_ENGINES  1024
+
+
 typedef struct {
     nxt_str_t         name;
     uint32_t          active_requests;
+    uint32_t          queued_requests;
     uint32_t          pending_processes;
     uint32_t          processes;
     uint32_t          idle_processes;
+
+    nxt_msec_t        target_latency;
+    nxt_msec_t        wait_latency;
+    uint32_t          scale_target;
+    uint32_t          scale_ups;
+    uint32_t          scale_downs;
+
+    uint8_t           prioritized;  /* 1 bit */
+    uint32_t          queue_high;
+    uint32_t          queue_normal;
+    uint32_t          queue_low;
 } nxt_status_app_t;
 
 
@@ -22,11 +37,18 @@ typedef struct {
     uint64_t          closed_conns;
     uint64_t          requests;
 
+    uint8_t           tls_offload;  /* 1 bit */
+    uint64_t          tls_handshakes_queued;
+    uint64_t          tls_handshakes_offloaded;
+
     size_t            apps_count;
     nxt_status_app_t  apps[];
 } nxt_status_report_t;
 
 
+nxt_int_t nxt_status_init(void);
+nxt_engine_counters_t *nxt_status_engine_counters(nxt_uint_t n);
+void nxt_status_counters(nxt_status_report_t *report);
 nxt_conf_value_t *nxt_status_get(nxt_status_report_t *report, nxt_mp_t *mp);
 
 
@@ -17,21 +17,49 @@
  *
  * nxt_timer_delete() deletes a timer.  It returns 1 if there are pending
  * changes in the changes array or 0 otherwise.
+ *
+ * Coarse timers, such as connection timeouts, are kept in a hierarchical
+ * timing wheel instead of the rbtree if their timeouts are long enough.
+ * Insertion and deletion take constant time there, but such a timer may
+ * expire up to a wheel tick later than requested.
  */
 
+
+#define nxt_timer_wheel_link(timer)                                           \
+    ((nxt_queue_link_t *) &(timer)->node)
+
+#define nxt_timer_wheel_align(time)                                           \
+    ((time) & ~((nxt_msec_t) NXT_TIMER_WHEEL_TICK - 1))
+
 static intptr_t nxt_timer_rbtree_compare(nxt_rbtree_node_t *node1,
     nxt_rbtree_node_t *node2);
 static void nxt_timer_change(nxt_event_engine_t *engine, nxt_timer_t *timer,
     nxt_timer_operation_t change, nxt_msec_t time);
 static void nxt_timer_changes_commit(nxt_event_engine_t *engine);
+static void nxt_timer_wheel_insert(nxt_timers_t *timers, nxt_timer_t *timer);
+static void nxt_timer_wheel_delete(nxt_timers_t *timers, nxt_timer_t *timer);
+static void nxt_timer_wheel_cascade(nxt_timers_t *timers, nxt_uint_t level,
+    nxt_uint_t slot);
+static nxt_msec_t nxt_timer_wheel_find(nxt_timers_t *timers);
+static void nxt_timer_wheel_expire(nxt_timers_t *timers, nxt_msec_t now);
 static void nxt_timer_handler(nxt_task_t *task, void *obj, void *data);
 
 
 nxt_int_t
 nxt_timers_init(nxt_timers_t *timers, nxt_uint_t mchanges)
 {
+    nxt_uint_t  level, slot;
+
     nxt_rbtree_init(&timers->tree, nxt_timer_rbtree_compare);
 
+    for (level = 0; level < NXT_TIMER_WHEEL_LEVELS; level++) {
+        for (slot = 0; slot < NXT_TIMER_WHEEL_SLOTS; slot++) {
+            nxt_queue_init(&timers->wheel.slots[level][slot]);
+        }
+    }
+
+    timers->wheel.count = 0;
+
     if (mchanges > NXT_TIMER_MAX_CHANGES) {
         mchanges = NXT_TIMER_MAX_CHANGES;
     }
@@ -195,10 +223,19 @@ nxt_timer_changes_commit(nxt_event_engine_t *engine)
             /* Fall through. */
 
         case NXT_TIMER_DELETE:
-            nxt_debug(timer->task, "timer rbtree delete: %M±%d",
-                      timer->time, timer->bias);
+            if (timer->wheel) {
+                nxt_debug(timer->task, "timer wheel delete: %M±%d",
+                          timer->time, timer->bias);
+
+                nxt_timer_wheel_delete(timers, timer);
+
+            } else {
+                nxt_debug(timer->task, "timer rbtree delete: %M±%d",
+                          timer->time, timer->bias);
+
+                nxt_rbtree_delete(&timers->tree, &timer->node);
+            }
 
-            nxt_rbtree_delete(&timers->tree, &timer->node);
             nxt_timer_in_tree_clear(timer);
 
             break;
@@ -212,11 +249,23 @@ nxt_timer_changes_commit(nxt_event_engine_t *engine)
     while (add < add_end) {
         timer = add->timer;
 
-        nxt_debug(timer->task, "timer rbtree insert: %M±%d",
-                  timer->time, timer->bias);
+        if (timer->coarse
+            && nxt_msec_diff(timer->time, timers->now) >= NXT_TIMER_WHEEL_MIN)
+        {
+            nxt_debug(timer->task, "timer wheel insert: %M±%d",
+                      timer->time, timer->bias);
 
-        nxt_rbtree_insert(&timers->tree, &timer->node);
-        nxt_timer_in_tree_set(timer);
+            nxt_timer_wheel_insert(timers, timer);
+
+        } else {
+            nxt_debug(timer->task, "timer rbtree insert: %M±%d",
+                      timer->time, timer->bias);
+
+            timer->wheel = 0;
+
+            nxt_rbtree_insert(&timers->tree, &timer->node);
+            nxt_timer_in_tree_set(timer);
+        }
 
         add++;
     }
@@ -225,11 +274,103 @@ nxt_timer_changes_commit(nxt_event_engine_t *engine)
 }
 
 
+static void
+nxt_timer_wheel_insert(nxt_timers_t *timers, nxt_timer_t *timer)
+{
+    int32_t            delta;
+    uint32_t           ticks;
+    nxt_msec_t         time;
+    nxt_uint_t         level, slot;
+    nxt_queue_t        *q;
+    nxt_timer_wheel_t  *wheel;
+
+    wheel = &timers->wheel;
+
+    if (wheel->count == 0) {
+        wheel->now = nxt_timer_wheel_align(timers->now)
+                     + NXT_TIMER_WHEEL_TICK;
+    }
+
+    /* A timer is never expired before its time. */
+    time = nxt_timer_wheel_align(timer->time + NXT_TIMER_WHEEL_TICK - 1);
+
+    delta = nxt_msec_diff(time, wheel->now);
+
+    if (delta < 0) {
+        time = wheel->now;
+        delta = 0;
+    }
+
+    ticks = (uint32_t) delta >> NXT_TIMER_WHEEL_TICK_BITS;
+
+    for (level = 0; level < NXT_TIMER_WHEEL_LEVELS - 1; level++) {
+        if (ticks < (1U << (NXT_TIMER_WHEEL_BITS * (level + 1)))) {
+            break;
+        }
+    }
+
+    if (ticks >= (1U << (NXT_TIMER_WHEEL_BITS * NXT_TIMER_WHEEL_LEVELS))) {
+        /*
+         * The timer is too far: it is put in the last slot and
+         * will be cascaded again when the wheel turns around.
+         */
+        time = wheel->now - NXT_TIMER_WHEEL_TICK
+               + ((nxt_msec_t) NXT_TIMER_WHEEL_TICK
+                  << (NXT_TIMER_WHEEL_BITS * NXT_TIMER_WHEEL_LEVELS));
+    }
+
+    slot = (time >> (NXT_TIMER_WHEEL_TICK_BITS + NXT_TIMER_WHEEL_BITS * level))
+           & (NXT_TIMER_WHEEL_SLOTS - 1);
+
+    q = &wheel->slots[level][slot];
+
+    nxt_queue_insert_tail(q, nxt_timer_wheel_link(timer));
+
+    timer->node.parent = (nxt_rbtree_node_t *) q;
+    timer->wheel = 1;
+
+    wheel->count++;
+}
+
+
+static void
+nxt_timer_wheel_delete(nxt_timers_t *timers, nxt_timer_t *timer)
+{
+    nxt_queue_remove(nxt_timer_wheel_link(timer));
+
+    timers->wheel.count--;
+}
+
+
+static void
+nxt_timer_wheel_cascade(nxt_timers_t *timers, nxt_uint_t level,
+    nxt_uint_t slot)
+{
+    nxt_queue_t       *q;
+    nxt_timer_t       *timer;
+    nxt_queue_link_t  *lnk;
+
+    q = &timers->wheel.slots[level][slot];
+
+    while (!nxt_queue_is_empty(q)) {
+        lnk = nxt_queue_first(q);
+        nxt_queue_remove(lnk);
+
+        timer = (nxt_timer_t *) lnk;
+
+        /* The counter is decremented after insertion to keep wheel->now. */
+        nxt_timer_wheel_insert(timers, timer);
+
+        timers->wheel.count--;
+    }
+}
+
+
 nxt_msec_t
 nxt_timer_find(nxt_event_engine_t *engine)
 {
     int32_t            delta;
-    nxt_msec_t         time;
+    nxt_msec_t         time, timeout;
     nxt_timer_t        *timer;
     nxt_timers_t       *timers;
     nxt_rbtree_t       *tree;
@@ -241,6 +382,8 @@ nxt_timer_find(nxt_event_engine_t *engine)
         nxt_timer_changes_commit(engine);
     }
 
+    timeout = nxt_timer_wheel_find(timers);
+
     tree = &timers->tree;
 
     for (node = nxt_rbtree_min(tree);
@@ -266,14 +409,54 @@ nxt_timer_find(nxt_event_engine_t *engine)
 
             delta = nxt_msec_diff(time, timers->now);
 
-            return (nxt_msec_t) nxt_max(delta, 0);
+            return nxt_min((nxt_msec_t) nxt_max(delta, 0), timeout);
         }
     }
 
     /* Set minimum time one day ahead. */
     timers->minimum = timers->now + 24 * 60 * 60 * 1000;
 
-    return NXT_INFINITE_MSEC;
+    return timeout;
+}
+
+
+static nxt_msec_t
+nxt_timer_wheel_find(nxt_timers_t *timers)
+{
+    int32_t            delta;
+    nxt_uint_t         slot;
+    nxt_msec_t         time;
+    nxt_timer_wheel_t  *wheel;
+
+    wheel = &timers->wheel;
+
+    if (wheel->count == 0) {
+        return NXT_INFINITE_MSEC;
+    }
+
+    time = wheel->now;
+    slot = (time >> NXT_TIMER_WHEEL_TICK_BITS) & (NXT_TIMER_WHEEL_SLOTS - 1);
+
+    /*
+     * The nearest non-empty slot of the first level is looked up.
+     * Otherwise the wheel is woken up to cascade the upper levels
+     * when the first level turns around.
+     */
+
+    if (slot != 0) {
+        while (slot < NXT_TIMER_WHEEL_SLOTS) {
+            if (!nxt_queue_is_empty(&wheel->slots[0][slot])) {
+                break;
+            }
+
+            time += NXT_TIMER_WHEEL_TICK;
+            slot++;
+        }
+    }
+
+    delta = nxt_msec_diff(time, timers->now);
+
+    return (nxt_msec_t) nxt_max(delta, 0);
 }
 
 
@@ -288,6 +471,8 @@ nxt_timer_expire(nxt_event_engine_t *engine, nxt_msec_t now)
     timers = &engine->timers;
     timers->now = now;
 
+    nxt_timer_wheel_expire(timers, now);
+
     nxt_debug(&engine->task, "timer expire minimum: %M:%M",
               timers->minimum, now);
 
@@ -327,6 +512,70 @@ nxt_timer_expire(nxt_event_engine_t *engine, nxt_msec_t now)
 }
 
 
+static void
+nxt_timer_wheel_expire(nxt_timers_t *timers, nxt_msec_t now)
+{
+    uint32_t           ticks;
+    nxt_uint_t         level, slot;
+    nxt_queue_t        *q;
+    nxt_timer_t        *timer;
+    nxt_queue_link_t   *lnk;
+    nxt_timer_wheel_t  *wheel;
+
+    wheel = &timers->wheel;
+
+                                /* wheel->now <= now */
+    while (wheel->count != 0 && nxt_msec_diff(wheel->now, now) <= 0) {
+
+        ticks = wheel->now >> NXT_TIMER_WHEEL_TICK_BITS;
+
+        /*
+         * When a level turns around, the next slot of the upper level
+         * is cascaded down.
+         */
+
+        for (level = 1; level < NXT_TIMER_WHEEL_LEVELS; level++) {
+            slot = (ticks >> (NXT_TIMER_WHEEL_BITS * (level - 1)))
+                   & (NXT_TIMER_WHEEL_SLOTS - 1);
+
+            if (slot != 0) {
+                break;
+            }
+
+            slot = (ticks >> (NXT_TIMER_WHEEL_BITS * level))
+                   & (NXT_TIMER_WHEEL_SLOTS - 1);
+
+            nxt_timer_wheel_cascade(timers, level, slot);
+        }
+
+        q = &wheel->slots[0][ticks & (NXT_TIMER_WHEEL_SLOTS - 1)];
+
+        while (!nxt_queue_is_empty(q)) {
+            lnk = nxt_queue_first(q);
+            nxt_queue_remove(lnk);
+
+            wheel->count--;
+
+            timer = (nxt_timer_t *) lnk;
+
+            nxt_debug(timer->task, "timer wheel expire: %M±%d",
+                      timer->time, timer->bias);
+
+            nxt_timer_in_tree_clear(timer);
+
+            if (timer->enabled) {
+                timer->queued = 1;
+
+                nxt_work_queue_add(timer->work_queue, nxt_timer_handler,
+                                   timer->task, timer, NULL);
+            }
+        }
+
+        wheel->now += NXT_TIMER_WHEEL_TICK;
+    }
+}
+
+
 static void
 nxt_timer_handler(nxt_task_t *task, void *obj, void *data)
 {
@@ -14,22 +14,39 @@
 
 
 /*
- * The nxt_timer_t structure can hold up to 14 bits of change index,
+ * The nxt_timer_t structure can hold up to 12 bits of change index,
  * but 0 reserved for NXT_TIMER_NO_CHANGE.
  */
-#define NXT_TIMER_MAX_CHANGES  16383
+#define NXT_TIMER_MAX_CHANGES  4095
 #define NXT_TIMER_NO_CHANGE    0
 
 
+/*
+ * Coarse timers with timeouts of at least NXT_TIMER_WHEEL_MIN are kept
+ * in a hierarchical timing wheel of 4 levels of 64 slots each.  A tick
+ * is 64ms, so the levels cover about 4s, 4.5m, 4.6h, and 12 days.
+ */
+#define NXT_TIMER_WHEEL_TICK_BITS  6
+#define NXT_TIMER_WHEEL_TICK       (1 << NXT_TIMER_WHEEL_TICK_BITS)
+#define NXT_TIMER_WHEEL_BITS       6
+#define NXT_TIMER_WHEEL_SLOTS      (1 << NXT_TIMER_WHEEL_BITS)
+#define NXT_TIMER_WHEEL_LEVELS     4
+#define NXT_TIMER_WHEEL_MIN        1000
+
+
 typedef struct {
     /* The rbtree node must be the first field. */
     NXT_RBTREE_NODE           (node);
 
     uint8_t                   bias;
 
-    uint16_t                  change:14;
+    uint16_t                  change:12;
     uint16_t                  enabled:1;
     uint16_t                  queued:1;
+    /* The timer can be put in the timing wheel. */
+    uint16_t                  coarse:1;
+    /* The timer resides in the timing wheel rather than in the rbtree. */
+    uint16_t                  wheel:1;
 
     nxt_msec_t                time;
 
@@ -42,7 +59,7 @@ typedef struct {
 
 
 #define NXT_TIMER             { NXT_RBTREE_NODE_INIT, 0, NXT_TIMER_NO_CHANGE, \
-                                0, 0, 0, NULL, NULL, NULL, NULL }
+                                0, 0, 0, 0, 0, NULL, NULL, NULL, NULL }
 
 
 typedef enum {
@@ -59,8 +76,19 @@ typedef struct {
 } nxt_timer_change_t;
 
 
+typedef struct {
+    /* The start of the next tick to expire. */
+    nxt_msec_t                now;
+    nxt_uint_t                count;
+
+    nxt_queue_t               slots[NXT_TIMER_WHEEL_LEVELS]
+                                   [NXT_TIMER_WHEEL_SLOTS];
+} nxt_timer_wheel_t;
+
+
 typedef struct {
     nxt_rbtree_t              tree;
+    nxt_timer_wheel_t         wheel;
 
     /* An overflown milliseconds counter. */
     nxt_msec_t                now;
@@ -79,7 +107,9 @@ typedef struct {
 
 /*
  * When timer resides in rbtree all links of its node are not NULL.
- * A parent link is the nearst to other timer flags.
+ * A parent link is the nearst to other timer flags.  A timer in the
+ * timing wheel uses the left and right links of its node as a queue link
+ * and the parent link points to the wheel slot.
  */
 
 #define nxt_timer_is_in_tree(timer)                                           \
@@ -25,12 +25,65 @@
 
 #define NXT_TLS_BUFFER_SIZE       4096
 
+#define NXT_TLS_MAX_HANDSHAKE_THREADS  256
+
+/*
+ * A session is stored in the session cache in a fixed size slot.
+ * A server session without a client certificate takes about 150-250
+ * bytes, larger sessions are not cached.
+ */
+
+#define NXT_TLS_SESSION_MAX_SIZE  960
+
+/*
+ * Dynamic record sizing: the first records of a connection and records
+ * sent after the connection was idle fit into a single TCP packet even
+ * over tunnels, so a client is able to start processing a response as
+ * soon as the first packet arrives.  Then records grow to the maximum
+ * size to decrease TLS framing overhead of bulk transfers.
+ */
+
+#define NXT_TLS_RECORD_INITIAL_SIZE   1369
+#define NXT_TLS_RECORD_MAX_SIZE       16384
+#define NXT_TLS_RECORD_THRESHOLD      40
+#define NXT_TLS_RECORD_IDLE_TIMEOUT   1000
+
+/*
+ * TLS 1.3 early data can be replayed, so ClientHello random values are
+ * remembered for the time OpenSSL accepts a ticket age skew, and early
+ * data is rejected if the ClientHello has been already seen or cannot
+ * be remembered.
+ */
+
+#define NXT_TLS_EARLY_DATA_SIZE       16384
+#define NXT_TLS_EARLY_DATA_MAX_SIZE   (1024 * 1024)
+#define NXT_TLS_EARLY_DATA_WINDOW     10
+#define NXT_TLS_EARLY_DATA_HELLOS     16384
+
+/*
+ * Contexts of certificates selected by SNI are created on first use,
+ * at most NXT_TLS_CONTEXTS of them are kept per listener, the least
+ * recently used ones are freed.
+ */
+
+#define NXT_TLS_CONTEXTS              1024
+
+/*
+ * OCSP responses are read from files named after certificates, a file
+ * is checked for a newer response once in the refresh interval, and
+ * a response is not stapled after its nextUpdate time.
+ */
+
+#define NXT_TLS_OCSP_REFRESH          60
+#define NXT_TLS_OCSP_MAX_SIZE         (64 * 1024)
+
 
 typedef struct nxt_tls_conf_s         nxt_tls_conf_t;
 typedef struct nxt_tls_bundle_conf_s  nxt_tls_bundle_conf_t;
 typedef struct nxt_tls_init_s         nxt_tls_init_t;
 typedef struct nxt_tls_ticket_s       nxt_tls_ticket_t;
 typedef struct nxt_tls_tickets_s      nxt_tls_tickets_t;
+typedef struct nxt_tls_session_cache_s  nxt_tls_session_cache_t;
 
 typedef struct {
     nxt_int_t                     (*library_init)(nxt_task_t *task);
@@ -51,21 +104,94 @@ typedef struct {
 } nxt_tls_bundle_hash_item_t;
 
 
+/*
+ * Handshakes of a TLS connection may run in a thread pool to keep
+ * the connection engine responsive while the handshake crypto is
+ * busy.  The counters are updated by engine threads and are read
+ * by the router status handler.  The TLS configurations of listeners
+ * hold references, so the pool is destroyed once handshakes are not
+ * offloaded and the last listener using it is released.
+ */
+
+typedef struct {
+    nxt_thread_pool_t             *thread_pool;
+    nxt_uint_t                    threads;
+    nxt_atomic_t                  count;
+
+    nxt_atomic_t                  queued;
+    nxt_atomic_t                  offloaded;
+} nxt_tls_offload_t;
+
+
+typedef struct {
+    size_t                        initial_size;
+    size_t                        max_size;
+    nxt_uint_t                    threshold;
+    nxt_msec_t                    idle_timeout;
+} nxt_tls_records_t;
+
+
+/*
+ * The session cache of a listener is kept in shared memory, it is split
+ * into buckets, each with its own lock, and is kept by the router across
+ * reconfigurations while the listener has the same cache size.  The same
+ * structure without session data keeps the early data replay window.
+ */
+
+struct nxt_tls_session_cache_s {
+    nxt_queue_link_t              link;
+    nxt_str_t                     name;
+    size_t                        sessions;
+    size_t                        data_size;
+
+    /* The number of TLS configurations using the cache. */
+    nxt_atomic_t                  count;
+
+    uint32_t                      nbuckets;
+    uint32_t                      bucket_size;
+    size_t                        slot_size;
+    size_t                        size;
+    void                          *buckets;
+};
+
+
 struct nxt_tls_bundle_conf_s {
     void                          *ctx;
 
     nxt_fd_t                      chain_file;
     nxt_str_t                     name;
 
+    /* The certificate chain and key to create the context on first use. */
+    nxt_str_t                     chain;
+    nxt_queue_link_t              link;
+
+    void                          *ocsp;
+
     nxt_tls_bundle_conf_t         *next;
 };
 
 
 struct nxt_tls_conf_s {
     nxt_tls_bundle_conf_t         *bundle;
+
+    /*
+     * The configuration is shared by subsequent router configurations
+     * while the listener "tls" object is the same.
+     */
+    nxt_mp_t                      *mem_pool;
+    nxt_str_t                     json;
+    nxt_atomic_t                  count;
     nxt_lvlhsh_t                  bundle_hash;
 
+    nxt_thread_spinlock_t         contexts_lock;
+    nxt_queue_t                   contexts;
+    nxt_uint_t                    ncontexts;
+
     nxt_tls_tickets_t             *tickets;
+    nxt_tls_offload_t             *offload;
+    nxt_tls_session_cache_t       *session_cache;
+    nxt_tls_records_t             *records;
+    nxt_tls_session_cache_t       *early_data_hellos;
 
     void                          (*conn_init)(nxt_task_t *task,
                                       nxt_tls_conf_t *conf, nxt_conn_t *c);
@@ -76,7 +202,11 @@ struct nxt_tls_conf_s {
 
     char                          *ca_certificate;
 
+    /* The commands for contexts of certificates selected by SNI. */
+    nxt_conf_value_t              *conf_cmds;
+
     size_t                        buffer_size;
+    size_t                        early_data;
 
     uint8_t                       no_wait_shutdown;  /* 1 bit */
 };
@@ -87,11 +217,32 @@ struct nxt_tls_init_s {
     nxt_time_t                    timeout;
     nxt_conf_value_t              *conf_cmds;
     nxt_conf_value_t              *tickets_conf;
+    nxt_bool_t                    ktls;
+    nxt_tls_session_cache_t       *session_cache;
+    nxt_tls_records_t             *records;
+    size_t                        early_data;
+    nxt_tls_session_cache_t       *early_data_hellos;
+    nxt_str_t                     ocsp_responses;
+    nxt_time_t                    ocsp_refresh;
 
     nxt_tls_conf_t                *conf;
 };
 
 
+nxt_tls_session_cache_t *nxt_tls_session_cache_create(nxt_task_t *task,
+    nxt_str_t *name, size_t sessions, size_t data_size);
+void nxt_tls_session_cache_destroy(nxt_tls_session_cache_t *cache);
+nxt_int_t nxt_tls_session_cache_store(nxt_tls_session_cache_t *cache,
+    const u_char *id, size_t id_length, const u_char *data, size_t length,
+    nxt_time_t expire);
+ssize_t nxt_tls_session_cache_fetch(nxt_tls_session_cache_t *cache,
+    const u_char *id, size_t id_length, u_char *buf, size_t size);
+nxt_int_t nxt_tls_session_cache_insert(nxt_tls_session_cache_t *cache,
+    const u_char *id, size_t id_length, nxt_time_t expire);
+void nxt_tls_session_cache_remove(nxt_tls_session_cache_t *cache,
+    const u_char *id, size_t id_length);
+
+
 #if (NXT_HAVE_OPENSSL)
 extern const nxt_tls_lib_t        nxt_openssl_lib;
 
@@ -0,0 +1,320 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_main.h>
+#include <nxt_conf.h>
+
+
+#define NXT_TLS_SESSION_ID_LEN       32
+#define NXT_TLS_SESSION_BUCKET_SIZE  8
+
+
+typedef struct {
+    nxt_time_t             expire;
+    uint16_t               length;
+    uint8_t                id_length;
+    u_char                 id[NXT_TLS_SESSION_ID_LEN];
+    u_char                 data[];
+} nxt_tls_session_t;
+
+
+typedef struct {
+    nxt_thread_spinlock_t  lock;
+    uint64_t               sessions[];
+} nxt_tls_session_bucket_t;
+
+
+#define nxt_tls_session_slot(cache, bucket, i)                                \
+    ((nxt_tls_session_t *) ((u_char *) (bucket)->sessions                     \
+                            + (i) * (cache)->slot_size))
+
+
+static nxt_tls_session_bucket_t *nxt_tls_session_bucket(
+    nxt_tls_session_cache_t *cache, const u_char *id, size_t id_length);
+static nxt_tls_session_t *nxt_tls_session_find(nxt_tls_session_cache_t *cache,
+    nxt_tls_session_bucket_t *bucket, const u_char *id, size_t id_length);
+
+
+nxt_tls_session_cache_t *
+nxt_tls_session_cache_create(nxt_task_t *task, nxt_str_t *name,
+    size_t sessions, size_t data_size)
+{
+    size_t                   size, slot_size;
+    uint32_t                 nbuckets, bucket_size;
+    nxt_tls_session_cache_t  *cache;
+
+    /*
+     * The cache holds the configured number of sessions: small caches
+     * consist of a single bucket, larger ones have buckets of up to
+     * NXT_TLS_SESSION_BUCKET_SIZE sessions.
+     */
+
+    nbuckets = (sessions + NXT_TLS_SESSION_BUCKET_SIZE - 1)
+               / NXT_TLS_SESSION_BUCKET_SIZE;
+    bucket_size = (sessions + nbuckets - 1) / nbuckets;
+
+    slot_size = nxt_align_size(sizeof(nxt_tls_session_t) + data_size, 8);
+
+    size = nbuckets * (sizeof(nxt_tls_session_bucket_t)
+                       + bucket_size * slot_size);
+
+    cache = nxt_zalloc(sizeof(nxt_tls_session_cache_t) + name->length);
+    if (nxt_slow_path(cache == NULL)) {
+        return NULL;
+    }
+
+    cache->buckets = nxt_mem_mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                  NXT_MEM_MAP_SHARED, -1, 0);
+
+    if (nxt_slow_path(cache->buckets == NXT_MEM_MAP_FAILED)) {
+        nxt_alert(task, "mmap(%uz) failed %E", size, nxt_errno);
+        nxt_free(cache);
+        return NULL;
+    }
+
+    cache->name.length = name->length;
+    cache->name.start = (u_char *) cache + sizeof(nxt_tls_session_cache_t);
+    nxt_memcpy(cache->name.start, name->start, name->length);
+
+    cache->sessions = sessions;
+    cache->data_size = data_size;
+    cache->slot_size = slot_size;
+    cache->nbuckets = nbuckets;
+    cache->bucket_size = bucket_size;
+    cache->size = size;
+
+    nxt_debug(task, "tls session cache \"%V\": %uz sessions, %uD buckets",
+              name, sessions, nbuckets);
+
+    return cache;
+}
+
+
+void
+nxt_tls_session_cache_destroy(nxt_tls_session_cache_t *cache)
+{
+    nxt_mem_munmap(cache->buckets, cache->size);
+    nxt_free(cache);
+}
+
+
+nxt_int_t
+nxt_tls_session_cache_store(nxt_tls_session_cache_t *cache, const u_char *id,
+    size_t id_length, const u_char *data, size_t length, nxt_time_t expire)
+{
+    nxt_uint_t                i;
+    nxt_time_t                now;
+    nxt_tls_session_t         *sess, *oldest;
+    nxt_tls_session_bucket_t  *bucket;
+
+    if (id_length == 0
+        || id_length > NXT_TLS_SESSION_ID_LEN
+        || length > cache->data_size)
+    {
+        return NXT_DECLINED;
+    }
+
+    now = nxt_thread_time(nxt_thread());
+
+    bucket = nxt_tls_session_bucket(cache, id, id_length);
+
+    nxt_thread_spin_lock(&bucket->lock);
+
+    sess = nxt_tls_session_find(cache, bucket, id, id_length);
+
+    if (sess == NULL) {
+        /* A free or an expired slot, otherwise the one expiring first. */
+
+        oldest = nxt_tls_session_slot(cache, bucket, 0);
+
+        for (i = 0; i < cache->bucket_size; i++) {
+            sess = nxt_tls_session_slot(cache, bucket, i);
+
+            if (sess->id_length == 0 || sess->expire <= now) {
+                oldest = sess;
+                break;
+            }
+
+            if (sess->expire < oldest->expire) {
+                oldest = sess;
+            }
+        }
+
+        sess = oldest;
+    }
+
+    sess->expire = expire;
+    sess->length = length;
+    sess->id_length = id_length;
+    nxt_memcpy(sess->id, id, id_length);
+    nxt_memcpy(sess->data, data, length);
+
+    nxt_thread_spin_unlock(&bucket->lock);
+
+    return NXT_OK;
+}
+
+
+ssize_t
+nxt_tls_session_cache_fetch(nxt_tls_session_cache_t *cache, const u_char *id,
+    size_t id_length, u_char *buf, size_t size)
+{
+    ssize_t                   n;
+    nxt_time_t                now;
+    nxt_tls_session_t         *sess;
+    nxt_tls_session_bucket_t  *bucket;
+
+    if (id_length == 0 || id_length > NXT_TLS_SESSION_ID_LEN) {
+        return 0;
+    }
+
+    now = nxt_thread_time(nxt_thread());
+
+    bucket = nxt_tls_session_bucket(cache, id, id_length);
+
+    nxt_thread_spin_lock(&bucket->lock);
+
+    sess = nxt_tls_session_find(cache, bucket, id, id_length);
+
+    if (sess == NULL || sess->length > size) {
+        n = 0;
+
+    } else if (sess->expire <= now) {
+        sess->id_length = 0;
+        n = 0;
+
+    } else {
+        nxt_memcpy(buf, sess->data, sess->length);
+        n = sess->length;
+    }
+
+    nxt_thread_spin_unlock(&bucket->lock);
+
+    return n;
+}
+
+
+/*
+ * The function adds an identifier without data if it is not in the cache
+ * yet.  An unexpired entry is never evicted, so if the bucket is full,
+ * the identifier is treated as already seen.
+ */
+
+nxt_int_t
+nxt_tls_session_cache_insert(nxt_tls_session_cache_t *cache, const u_char *id,
+    size_t id_length, nxt_time_t expire)
+{
+    nxt_int_t                 ret;
+    nxt_uint_t                i;
+    nxt_time_t                now;
+    nxt_tls_session_t         *sess;
+    nxt_tls_session_bucket_t  *bucket;
+
+    if (id_length == 0 || id_length > NXT_TLS_SESSION_ID_LEN) {
+        return NXT_DECLINED;
+    }
+
+    now = nxt_thread_time(nxt_thread());
+
+    bucket = nxt_tls_session_bucket(cache, id, id_length);
+
+    nxt_thread_spin_lock(&bucket->lock);
+
+    sess = nxt_tls_session_find(cache, bucket, id, id_length);
+
+    if (sess != NULL && sess->expire > now) {
+        ret = NXT_DECLINED;
+        goto done;
+    }
+
+    if (sess == NULL) {
+        for (i = 0; i < cache->bucket_size; i++) {
+            sess = nxt_tls_session_slot(cache, bucket, i);
+
+            if (sess->id_length == 0 || sess->expire <= now) {
+                break;
+            }
+        }
+
+        if (i == cache->bucket_size) {
+            ret = NXT_DECLINED;
+            goto done;
+        }
+    }
+
+    sess->expire = expire;
+    sess->length = 0;
+    sess->id_length = id_length;
+    nxt_memcpy(sess->id, id, id_length);
+
+    ret = NXT_OK;
+
+done:
+
+    nxt_thread_spin_unlock(&bucket->lock);
+
+    return ret;
+}
+
+
+void
+nxt_tls_session_cache_remove(nxt_tls_session_cache_t *cache, const u_char *id,
+    size_t id_length)
+{
+    nxt_tls_session_t         *sess;
+    nxt_tls_session_bucket_t  *bucket;
+
+    if (id_length == 0 || id_length > NXT_TLS_SESSION_ID_LEN) {
+        return;
+    }
+
+    bucket = nxt_tls_session_bucket(cache, id, id_length);
+
+    nxt_thread_spin_lock(&bucket->lock);
+
+    sess = nxt_tls_session_find(cache, bucket, id, id_length);
+
+    if (sess != NULL) {
+        sess->id_length = 0;
+    }
+
+    nxt_thread_spin_unlock(&bucket->lock);
+}
+
+
+static nxt_tls_session_bucket_t *
+nxt_tls_session_bucket(nxt_tls_session_cache_t *cache, const u_char *id,
+    size_t id_length)
+{
+    uint32_t  n;
+
+    n = nxt_murmur_hash2(id, id_length) % cache->nbuckets;
+
+    return (nxt_tls_session_bucket_t *)
+               ((u_char *) cache->buckets
+                + n * (sizeof(nxt_tls_session_bucket_t)
+                       + cache->bucket_size * cache->slot_size));
+}
+
+
+static nxt_tls_session_t *
+nxt_tls_session_find(nxt_tls_session_cache_t *cache,
+    nxt_tls_session_bucket_t *bucket, const u_char *id, size_t id_length)
+{
+    nxt_uint_t         i;
+    nxt_tls_session_t  *sess;
+
+    for (i = 0; i < cache->bucket_size; i++) {
+        sess = nxt_tls_session_slot(cache, bucket, i);
+
+        if (sess->id_length == id_length
+            && memcmp(sess->id, id, id_length) == 0)
+        {
+            return sess;
+        }
+    }
+
+    return NULL;
+}
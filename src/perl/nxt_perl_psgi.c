@@ -117,6 +117,9 @@ NXT_EXPORT nxt_app_module_t  nxt_app_module = {
     0,
     NULL,
     nxt_perl_psgi_start,
+    NULL,
+    NULL,
+    NULL,
 };
 
 const nxt_perl_psgi_io_tab_t nxt_perl_psgi_io_tab_input = {
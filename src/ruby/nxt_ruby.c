@@ -99,6 +99,9 @@ NXT_EXPORT nxt_app_module_t  nxt_app_module = {
     nxt_nitems(nxt_ruby_mounts),
     NULL,
     nxt_ruby_start,
+    NULL,
+    NULL,
+    NULL,
 };
 
 typedef struct {
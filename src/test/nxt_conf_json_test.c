@@ -0,0 +1,287 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_main.h>
+#include <nxt_conf.h>
+#include "nxt_tests.h"
+
+
+#define NXT_CONF_JSON_TEST_RUNS  10
+
+
+static u_char *nxt_conf_json_test_create(u_char *p, nxt_uint_t n);
+static nxt_int_t nxt_conf_json_test_run(nxt_thread_t *thr, nxt_mp_t *mp,
+    u_char *start, u_char *end);
+static nxt_int_t nxt_conf_json_test_invalid(nxt_thread_t *thr, nxt_mp_t *mp);
+
+
+nxt_int_t
+nxt_conf_json_test(nxt_thread_t *thr)
+{
+    u_char      *buf, *end;
+    nxt_mp_t    *mp;
+    nxt_int_t   ret;
+    nxt_uint_t  n;
+
+    mp = nxt_mp_create(1024, 128, 256, 32);
+    if (mp == NULL) {
+        return NXT_ERROR;
+    }
+
+    ret = nxt_conf_json_test_invalid(thr, mp);
+
+    for (n = 10; ret == NXT_OK && n <= 10 * 1000; n *= 10) {
+        buf = nxt_malloc(n * 1024);
+        if (buf == NULL) {
+            ret = NXT_ERROR;
+            break;
+        }
+
+        end = nxt_conf_json_test_create(buf, n);
+
+        ret = nxt_conf_json_test_run(thr, mp, buf, end);
+
+        nxt_free(buf);
+    }
+
+    nxt_mp_destroy(mp);
+
+    if (ret == NXT_OK) {
+        nxt_log_error(NXT_LOG_NOTICE, thr->log, "conf json test passed");
+    }
+
+    return ret;
+}
+
+
+/*
+ * A configuration with "n" listeners, applications, and route steps
+ * in the compact form the configuration is printed in.
+ */
+
+static u_char *
+nxt_conf_json_test_create(u_char *p, nxt_uint_t n)
+{
+    nxt_uint_t  i;
+
+    p = nxt_cpystr(p, (u_char *) "{\"listeners\":{");
+
+    for (i = 0; i < n; i++) {
+        p = nxt_sprintf(p, p + 256,
+                        "%s\"127.0.%ui.%ui:%ui\":{\"pass\":\"routes/main\","
+                        "\"forwarded\":{\"client_ip\":\"X-Forwarded-For\","
+                        "\"source\":[\"10.0.0.0/8\",\"192.168.%ui.0/24\"],"
+                        "\"recursive\":%s}}",
+                        (i != 0) ? "," : "", i / 256, i % 256, 8000 + i % 1000,
+                        i % 256, (i & 1) ? "true" : "false");
+    }
+
+    p = nxt_cpystr(p, (u_char *) "},\"routes\":{\"main\":[");
+
+    for (i = 0; i < n; i++) {
+        p = nxt_sprintf(p, p + 512,
+                        "%s{\"match\":{\"host\":[\"example%ui.com\","
+                        "\"*.example%ui.com\"],\"uri\":\"/api/v%ui/*\","
+                        "\"headers\":{\"X-Test\":\"\\\"quoted\\\\%ui\\\"\"},"
+                        "\"arguments\":{\"id\":\"~^[0-9]+$\"}},"
+                        "\"action\":{\"pass\":\"applications/app%ui\"}}",
+                        (i != 0) ? "," : "", i, i, i % 10, i, i);
+    }
+
+    p = nxt_cpystr(p, (u_char *) "]},\"applications\":{");
+
+    for (i = 0; i < n; i++) {
+        p = nxt_sprintf(p, p + 512,
+                        "%s\"app%ui\":{\"type\":\"python\","
+                        "\"processes\":{\"max\":%ui,\"spare\":0,"
+                        "\"idle_timeout\":2.5},"
+                        "\"path\":\"/srv/app%ui\",\"module\":\"wsgi\","
+                        "\"environment\":{\"ENV\":\"production\","
+                        "\"TOKEN\":\"line\\n\\tvalue\\u001F%ui\"},"
+                        "\"arguments\":[\"--workers\",\"%ui\",null]}",
+                        (i != 0) ? "," : "", i, i % 32, i, i, i % 8);
+    }
+
+    return nxt_cpystr(p, (u_char *) "}}");
+}
+
+
+static nxt_int_t
+nxt_conf_json_test_run(nxt_thread_t *thr, nxt_mp_t *mp, u_char *start,
+    u_char *end)
+{
+    u_char                  *buf, *p;
+    size_t                  size, length;
+    nxt_mp_t                *pool;
+    nxt_int_t               ret;
+    nxt_nsec_t              parse, print, pretty_print, now;
+    nxt_uint_t              i;
+    nxt_conf_value_t        *conf, *pretty_conf;
+    nxt_conf_json_pretty_t  pretty;
+
+    size = end - start;
+
+    ret = NXT_ERROR;
+    buf = NULL;
+    conf = NULL;
+    length = 0;
+
+    pool = nxt_mp_create(1024, 128, 256, 32);
+    if (pool == NULL) {
+        return NXT_ERROR;
+    }
+
+    parse = 0;
+    print = 0;
+    pretty_print = 0;
+
+    for (i = 0; i < NXT_CONF_JSON_TEST_RUNS; i++) {
+        nxt_mp_destroy(pool);
+
+        pool = nxt_mp_create(1024, 128, 256, 32);
+        if (pool == NULL) {
+            return NXT_ERROR;
+        }
+
+        nxt_thread_time_update(thr);
+        now = nxt_thread_monotonic_time(thr);
+
+        conf = nxt_conf_json_parse(pool, start, end, NULL);
+        if (conf == NULL) {
+            nxt_log_alert(thr->log, "conf json test failed: "
+                          "%uz bytes are not parsed", size);
+            goto done;
+        }
+
+        nxt_thread_time_update(thr);
+        parse += nxt_thread_monotonic_time(thr) - now;
+        now = nxt_thread_monotonic_time(thr);
+
+        length = nxt_conf_json_length(conf, NULL);
+
+        buf = nxt_mp_nget(pool, length);
+        if (buf == NULL) {
+            goto done;
+        }
+
+        p = nxt_conf_json_print(buf, conf, NULL);
+
+        nxt_thread_time_update(thr);
+        print += nxt_thread_monotonic_time(thr) - now;
+        now = nxt_thread_monotonic_time(thr);
+
+        if ((size_t) (p - buf) != size || memcmp(buf, start, size) != 0) {
+            nxt_log_alert(thr->log, "conf json test failed: "
+                          "%uz bytes are printed as %uz bytes differently",
+                          size, p - buf);
+            goto done;
+        }
+
+        nxt_memzero(&pretty, sizeof(nxt_conf_json_pretty_t));
+
+        length = nxt_conf_json_length(conf, &pretty);
+
+        buf = nxt_mp_nget(pool, length);
+        if (buf == NULL) {
+            goto done;
+        }
+
+        nxt_memzero(&pretty, sizeof(nxt_conf_json_pretty_t));
+
+        p = nxt_conf_json_print(buf, conf, &pretty);
+
+        nxt_thread_time_update(thr);
+        pretty_print += nxt_thread_monotonic_time(thr) - now;
+
+        if ((size_t) (p - buf) > length) {
+            nxt_log_alert(thr->log, "conf json test failed: "
+                          "pretty printed %uz bytes instead of %uz",
+                          p - buf, length);
+            goto done;
+        }
+
+        length = p - buf;
+    }
+
+    /* The pretty printed configuration is the same. */
+
+    pretty_conf = nxt_conf_json_parse(pool, buf, buf + length, NULL);
+
+    if (pretty_conf != NULL) {
+        buf = nxt_mp_nget(pool, nxt_conf_json_length(pretty_conf, NULL));
+        if (buf == NULL) {
+            goto done;
+        }
+
+        p = nxt_conf_json_print(buf, pretty_conf, NULL);
+    }
+
+    if (pretty_conf == NULL
+        || (size_t) (p - buf) != size || memcmp(buf, start, size) != 0)
+    {
+        nxt_log_alert(thr->log, "conf json test failed: "
+                      "pretty printed configuration differs");
+        goto done;
+    }
+
+    nxt_log_error(NXT_LOG_NOTICE, thr->log,
+                  "conf json bench: %uz bytes, parse %uL us, "
+                  "print %uL us, pretty print %uL us (%uz bytes)",
+                  size, parse / NXT_CONF_JSON_TEST_RUNS / 1000,
+                  print / NXT_CONF_JSON_TEST_RUNS / 1000,
+                  pretty_print / NXT_CONF_JSON_TEST_RUNS / 1000, length);
+
+    ret = NXT_OK;
+
+done:
+
+    nxt_mp_destroy(pool);
+
+    return ret;
+}
+
+
+static nxt_int_t
+nxt_conf_json_test_invalid(nxt_thread_t *thr, nxt_mp_t *mp)
+{
+    u_char      *p, buf[4096];
+    nxt_uint_t  i;
+
+    static const nxt_str_t  invalid[] = {
+        nxt_string("{\"a\":1,\"b\":2,\"a\":3}"),
+        nxt_string("{\"a\":1,\"b\":2,\"\\u0061\":3}"),
+        nxt_string("{\"a\":[1,2,{\"b\":\"c\",\"b\":\"c\"}]}"),
+        nxt_string("{\"a\":\"b\\\"}"),
+        nxt_string("{\"a\":\"\x01\"}"),
+        nxt_string("[1,2 3]"),
+        nxt_string("{\"a\" 1}"),
+    };
+
+    for (i = 0; i < nxt_nitems(invalid); i++) {
+        if (nxt_conf_json_parse_str(mp, &invalid[i]) != NULL) {
+            nxt_log_alert(thr->log, "conf json test failed: "
+                          "invalid \"%V\" is parsed", &invalid[i]);
+            return NXT_ERROR;
+        }
+    }
+
+    /* A duplicate member of a large object. */
+
+    p = nxt_cpystr(buf, (u_char *) "{");
+
+    for (i = 0; i < 200; i++) {
+        p = nxt_sprintf(p, buf + sizeof(buf), "\"m%ui\":%ui,", i, i);
+    }
+
+    p = nxt_cpystr(p, (u_char *) "\"m100\":0}");
+
+    if (nxt_conf_json_parse(mp, buf, p, NULL) != NULL) {
+        nxt_log_alert(thr->log, "conf json test failed: "
+                      "duplicate member of a large object is parsed");
+        return NXT_ERROR;
+    }
+
+    return NXT_OK;
+}
@@ -0,0 +1,246 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_router.h>
+#include <nxt_http.h>
+#include "nxt_tests.h"
+
+
+#define NXT_HTTP_ROUTE_ADDR_TEST_CHECKS  1000
+#define NXT_HTTP_ROUTE_ADDR_TEST_RUNS    (1000 * 1000)
+
+
+typedef struct {
+    uint32_t  net;
+    uint32_t  mask;
+    uint16_t  port_start;
+    uint16_t  port_end;
+    uint8_t   negative;
+} nxt_http_route_addr_test_t;
+
+
+static nxt_int_t nxt_http_route_addr_test_run(nxt_thread_t *thr, nxt_uint_t n);
+static void nxt_http_route_addr_test_sockaddr(nxt_http_route_addr_test_t *tests,
+    nxt_uint_t n, uint32_t *key, nxt_sockaddr_t *sa);
+static nxt_int_t nxt_http_route_addr_test_match(
+    nxt_http_route_addr_test_t *tests, nxt_uint_t n, nxt_sockaddr_t *sa);
+
+
+nxt_int_t
+nxt_http_route_addr_test(nxt_thread_t *thr)
+{
+    nxt_uint_t  n;
+
+    for (n = 10; n <= 100 * 1000; n *= 10) {
+        if (nxt_http_route_addr_test_run(thr, n) != NXT_OK) {
+            return NXT_ERROR;
+        }
+    }
+
+    if (nxt_http_route_addr_test_run(thr, 200 * 1000) != NXT_OK) {
+        return NXT_ERROR;
+    }
+
+    nxt_log_error(NXT_LOG_NOTICE, thr->log, "http route addr test passed");
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_http_route_addr_test_run(nxt_thread_t *thr, nxt_uint_t n)
+{
+    u_char                      *buf, *p;
+    uint32_t                    key, prefix;
+    nxt_mp_t                    *mp;
+    nxt_int_t                   ret, expected;
+    nxt_nsec_t                  start, end;
+    nxt_uint_t                  i, found;
+    nxt_sockaddr_t              sa;
+    nxt_conf_value_t            *cv;
+    nxt_http_route_addr_rule_t  *rule;
+    nxt_http_route_addr_test_t  *tests, *t;
+
+    ret = NXT_ERROR;
+
+    mp = nxt_mp_create(4096, 128, 1024, 64);
+    if (mp == NULL) {
+        return NXT_ERROR;
+    }
+
+    tests = nxt_mp_alloc(mp, n * sizeof(nxt_http_route_addr_test_t));
+    buf = nxt_mp_alloc(mp, n * nxt_length("\"!255.255.255.255/32:65535-65535\",")
+                           + 2);
+
+    if (tests == NULL || buf == NULL) {
+        goto done;
+    }
+
+    /*
+     * Random CIDRs: every 16th one is negative,
+     * every 4th one has a port range.
+     */
+
+    p = buf;
+    *p++ = '[';
+
+    key = 0;
+
+    for (i = 0; i < n; i++) {
+        t = &tests[i];
+
+        key = nxt_murmur_hash2(&key, sizeof(uint32_t));
+        prefix = 8 + key % 25;
+        t->mask = 0xFFFFFFFF << (32 - prefix);
+
+        key = nxt_murmur_hash2(&key, sizeof(uint32_t));
+        t->net = key & t->mask;
+
+        t->negative = (i % 16 == 15);
+
+        if (i % 4 == 0) {
+            t->port_start = key % 4000;
+            t->port_end = t->port_start + 999;
+
+        } else {
+            t->port_start = 0;
+            t->port_end = 65535;
+        }
+
+        p = nxt_sprintf(p, p + 64, "%s\"%s%uD.%uD.%uD.%uD/%uD",
+                        (i != 0) ? "," : "", t->negative ? "!" : "",
+                        t->net >> 24, (t->net >> 16) & 0xFF,
+                        (t->net >> 8) & 0xFF, t->net & 0xFF, prefix);
+
+        if (i % 4 == 0) {
+            p = nxt_sprintf(p, p + 32, ":%uD-%uD",
+                            (uint32_t) t->port_start, (uint32_t) t->port_end);
+        }
+
+        *p++ = '"';
+    }
+
+    *p++ = ']';
+
+    cv = nxt_conf_json_parse(mp, buf, p, NULL);
+    if (cv == NULL) {
+        nxt_log_alert(thr->log, "http route addr test failed: "
+                                "invalid patterns");
+        goto done;
+    }
+
+    rule = nxt_http_route_addr_rule_create(thr->task, mp, cv);
+    if (rule == NULL) {
+        nxt_log_alert(thr->log, "http route addr test failed: "
+                                "rule has not been created");
+        goto done;
+    }
+
+    nxt_memzero(&sa, sizeof(nxt_sockaddr_t));
+    sa.u.sockaddr_in.sin_family = AF_INET;
+
+    key = 0;
+    found = 0;
+
+    for (i = 0; i < NXT_HTTP_ROUTE_ADDR_TEST_CHECKS; i++) {
+        nxt_http_route_addr_test_sockaddr(tests, n, &key, &sa);
+
+        expected = nxt_http_route_addr_test_match(tests, n, &sa);
+
+        if (nxt_http_route_addr_rule(NULL, rule, &sa) != expected) {
+            nxt_log_alert(thr->log, "http route addr test failed: "
+                          "%uz patterns, address %08XD port %uD, "
+                          "expected %i",
+                          n, ntohl(sa.u.sockaddr_in.sin_addr.s_addr),
+                          (uint32_t) ntohs(sa.u.sockaddr_in.sin_port),
+                          expected);
+            goto done;
+        }
+
+        found += expected;
+    }
+
+    nxt_thread_time_update(thr);
+    start = nxt_thread_monotonic_time(thr);
+
+    for (i = 0; nxt_fast_path(i < NXT_HTTP_ROUTE_ADDR_TEST_RUNS); i++) {
+        sa.u.sockaddr_in.sin_addr.s_addr = nxt_murmur_hash2(&i, sizeof(i));
+
+        found += nxt_http_route_addr_rule(NULL, rule, &sa);
+    }
+
+    nxt_thread_time_update(thr);
+    end = nxt_thread_monotonic_time(thr);
+
+    nxt_log_error(NXT_LOG_NOTICE, thr->log,
+                  "http route addr bench: %uz patterns, %uL ns per lookup, "
+                  "%ui found",
+                  n, (end - start) / NXT_HTTP_ROUTE_ADDR_TEST_RUNS, found);
+
+    ret = NXT_OK;
+
+done:
+
+    nxt_mp_destroy(mp);
+
+    return ret;
+}
+
+
+/*
+ * Half of the addresses are taken from random patterns, so that they
+ * are matched, the others are random.
+ */
+
+static void
+nxt_http_route_addr_test_sockaddr(nxt_http_route_addr_test_t *tests,
+    nxt_uint_t n, uint32_t *key, nxt_sockaddr_t *sa)
+{
+    uint32_t                    addr;
+    nxt_http_route_addr_test_t  *t;
+
+    *key = nxt_murmur_hash2(key, sizeof(uint32_t));
+    addr = *key;
+
+    if (addr & 1) {
+        t = &tests[addr % n];
+
+        *key = nxt_murmur_hash2(key, sizeof(uint32_t));
+        addr = t->net | (*key & ~t->mask);
+    }
+
+    sa->u.sockaddr_in.sin_addr.s_addr = htonl(addr);
+    sa->u.sockaddr_in.sin_port = htons(*key % 5000);
+}
+
+
+static nxt_int_t
+nxt_http_route_addr_test_match(nxt_http_route_addr_test_t *tests, nxt_uint_t n,
+    nxt_sockaddr_t *sa)
+{
+    uint32_t    addr;
+    in_port_t   port;
+    nxt_uint_t  i;
+    nxt_bool_t  found;
+
+    addr = ntohl(sa->u.sockaddr_in.sin_addr.s_addr);
+    port = ntohs(sa->u.sockaddr_in.sin_port);
+
+    found = 0;
+
+    for (i = 0; i < n; i++) {
+        if ((addr & tests[i].mask) == tests[i].net
+            && port >= tests[i].port_start && port <= tests[i].port_end)
+        {
+            if (tests[i].negative) {
+                return 0;
+            }
+
+            found = 1;
+        }
+    }
+
+    return found;
+}
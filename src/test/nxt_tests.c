@@ -98,6 +98,10 @@ main(int argc, char **argv)
         return 1;
     }
 
+    if (nxt_timer_test(thr, 1000 * 1000) != NXT_OK) {
+        return 1;
+    }
+
     if (nxt_mp_test(thr, 100, 40000, 128 - 1) != NXT_OK) {
         return 1;
     }
@@ -166,6 +170,14 @@ main(int argc, char **argv)
         return 1;
     }
 
+    if (nxt_http_route_addr_test(thr) != NXT_OK) {
+        return 1;
+    }
+
+    if (nxt_conf_json_test(thr) != NXT_OK) {
+        return 1;
+    }
+
 #if (NXT_HAVE_CLONE_NEWUSER)
     if (nxt_clone_creds_test(thr) != NXT_OK) {
         return 1;
@@ -38,6 +38,7 @@ nxt_int_t nxt_msec_diff_test(nxt_thread_t *thr, nxt_msec_less_t);
 
 nxt_int_t nxt_rbtree_test(nxt_thread_t *thr, nxt_uint_t n);
 nxt_int_t nxt_rbtree1_test(nxt_thread_t *thr, nxt_uint_t n);
+nxt_int_t nxt_timer_test(nxt_thread_t *thr, nxt_uint_t n);
 
 #if (NXT_TEST_RTDTSC)
 
@@ -65,6 +66,8 @@ nxt_int_t nxt_utf8_test(nxt_thread_t *thr);
 nxt_int_t nxt_http_parse_test(nxt_thread_t *thr);
 nxt_int_t nxt_strverscmp_test(nxt_thread_t *thr);
 nxt_int_t nxt_base64_test(nxt_thread_t *thr);
+nxt_int_t nxt_http_route_addr_test(nxt_thread_t *thr);
+nxt_int_t nxt_conf_json_test(nxt_thread_t *thr);
 nxt_int_t nxt_clone_creds_test(nxt_thread_t *thr);
 
 
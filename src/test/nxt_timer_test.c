@@ -0,0 +1,223 @@
+
+/*
+ * Copyright (C) NGINX, Inc.
+ */
+
+#include <nxt_main.h>
+#include "nxt_tests.h"
+
+
+/*
+ * The test compares the rbtree and the timing wheel: timers are added,
+ * then updated as keepalive timers are, a half of them is deleted, and
+ * the rest are expired.
+ */
+
+typedef struct {
+    nxt_timer_t  timer;
+    nxt_uint_t   fired;
+} nxt_timer_test_t;
+
+
+static nxt_int_t nxt_timer_test_run(nxt_thread_t *thr, nxt_uint_t n,
+    nxt_bool_t coarse);
+static void nxt_timer_test_handler(nxt_task_t *task, void *obj, void *data);
+
+
+static nxt_msec_t  nxt_timer_test_now;
+static nxt_uint_t  nxt_timer_test_errors;
+
+
+nxt_int_t
+nxt_timer_test(nxt_thread_t *thr, nxt_uint_t n)
+{
+    nxt_thread_time_update(thr);
+
+    nxt_log_error(NXT_LOG_NOTICE, thr->log, "timer test started: %ui", n);
+
+    if (nxt_timer_test_run(thr, n, 0) != NXT_OK) {
+        return NXT_ERROR;
+    }
+
+    if (nxt_timer_test_run(thr, n, 1) != NXT_OK) {
+        return NXT_ERROR;
+    }
+
+    nxt_log_error(NXT_LOG_NOTICE, thr->log, "timer test passed");
+
+    return NXT_OK;
+}
+
+
+static nxt_int_t
+nxt_timer_test_run(nxt_thread_t *thr, nxt_uint_t n, nxt_bool_t coarse)
+{
+    void                *obj, *data;
+    uint32_t            key;
+    nxt_int_t           ret;
+    nxt_msec_t          end;
+    nxt_nsec_t          start, added, updated, deleted, expired;
+    nxt_uint_t          i;
+    nxt_task_t          *task;
+    nxt_work_handler_t  handler;
+    nxt_timer_test_t    *items;
+    nxt_event_engine_t  *engine;
+
+    items = nxt_zalloc(n * sizeof(nxt_timer_test_t));
+    if (items == NULL) {
+        return NXT_ERROR;
+    }
+
+    engine = nxt_zalloc(sizeof(nxt_event_engine_t));
+    if (engine == NULL) {
+        nxt_free(items);
+        return NXT_ERROR;
+    }
+
+    ret = NXT_ERROR;
+
+    engine->task.thread = thr;
+    engine->task.log = thr->log;
+
+    nxt_work_queue_cache_create(&engine->work_queue_cache, 0);
+    engine->fast_work_queue.cache = &engine->work_queue_cache;
+    nxt_work_queue_name(&engine->fast_work_queue, "fast");
+
+    if (nxt_timers_init(&engine->timers, 4 * 32) != NXT_OK) {
+        goto fail;
+    }
+
+    nxt_timer_test_now = 1000;
+    nxt_timer_test_errors = 0;
+
+    engine->timers.now = nxt_timer_test_now;
+
+    for (i = 0; i < n; i++) {
+        items[i].timer.work_queue = &engine->fast_work_queue;
+        items[i].timer.handler = nxt_timer_test_handler;
+        items[i].timer.task = &engine->task;
+        items[i].timer.log = thr->log;
+        items[i].timer.bias = NXT_TIMER_DEFAULT_BIAS;
+        items[i].timer.coarse = coarse;
+    }
+
+    /* Keepalive timeouts are spread from 5 to 65 seconds. */
+
+    key = 0;
+
+    nxt_thread_time_update(thr);
+    start = nxt_thread_monotonic_time(thr);
+
+    for (i = 0; i < n; i++) {
+        key = nxt_murmur_hash2(&key, sizeof(uint32_t));
+
+        nxt_timer_add(engine, &items[i].timer, 5000 + key % 60000);
+    }
+
+    (void) nxt_timer_find(engine);
+
+    nxt_thread_time_update(thr);
+    added = nxt_thread_monotonic_time(thr);
+
+    nxt_timer_test_now += 500;
+    nxt_timer_expire(engine, nxt_timer_test_now);
+
+    for (i = 0; i < n; i++) {
+        key = nxt_murmur_hash2(&key, sizeof(uint32_t));
+
+        nxt_timer_add(engine, &items[i].timer, 5000 + key % 60000);
+    }
+
+    (void) nxt_timer_find(engine);
+
+    nxt_thread_time_update(thr);
+    updated = nxt_thread_monotonic_time(thr);
+
+    for (i = 0; i < n; i += 2) {
+        (void) nxt_timer_delete(engine, &items[i].timer);
+    }
+
+    (void) nxt_timer_find(engine);
+
+    nxt_thread_time_update(thr);
+    deleted = nxt_thread_monotonic_time(thr);
+
+    end = nxt_timer_test_now + 70000;
+
+    while (nxt_msec_diff(nxt_timer_test_now, end) < 0) {
+        nxt_timer_test_now += nxt_min(nxt_timer_find(engine), 100);
+
+        nxt_timer_expire(engine, nxt_timer_test_now);
+
+        while (engine->fast_work_queue.head != NULL) {
+            handler = nxt_work_queue_pop(&engine->fast_work_queue, &task,
+                                         &obj, &data);
+            handler(task, obj, data);
+        }
+    }
+
+    nxt_thread_time_update(thr);
+    expired = nxt_thread_monotonic_time(thr);
+
+    for (i = 0; i < n; i++) {
+        if (items[i].fired != (i & 1)) {
+            nxt_log_alert(thr->log, "timer test failed: timer %ui fired %ui",
+                          i, items[i].fired);
+            goto fail;
+        }
+    }
+
+    if (nxt_timer_test_errors != 0) {
+        nxt_log_alert(thr->log, "timer test failed: %ui timers expired "
+                      "out of time", nxt_timer_test_errors);
+        goto fail;
+    }
+
+    nxt_log_error(NXT_LOG_NOTICE, thr->log,
+                  "timer test %s: add %0.3fs, update %0.3fs, "
+                  "delete %0.3fs, expire %0.3fs",
+                  coarse ? "wheel" : "rbtree",
+                  (added - start) / 1000000000.0,
+                  (updated - added) / 1000000000.0,
+                  (deleted - updated) / 1000000000.0,
+                  (expired - deleted) / 1000000000.0);
+
+    ret = NXT_OK;
+
+fail:
+
+    nxt_free(engine->timers.changes);
+    nxt_work_queue_cache_destroy(&engine->work_queue_cache);
+
+    nxt_free(engine);
+    nxt_free(items);
+
+    return ret;
+}
+
+
+static void
+nxt_timer_test_handler(nxt_task_t *task, void *obj, void *data)
+{
+    int32_t           delta;
+    nxt_timer_t       *timer;
+    nxt_timer_test_t  *item;
+
+    timer = obj;
+    item = nxt_timer_data(timer, nxt_timer_test_t, timer);
+
+    item->fired++;
+
+    /*
+     * A timer may expire earlier within its bias or later within
+     * a wheel tick and a step of the test.
+     */
+
+    delta = nxt_msec_diff(nxt_timer_test_now, timer->time);
+
+    if (delta < -(int32_t) timer->bias
+        || delta > NXT_TIMER_WHEEL_TICK + 100)
+    {
+        nxt_timer_test_errors++;
+    }
+}
@@ -0,0 +1,12 @@
+import os
+import time
+
+
+def application(environ, start_response):
+    time.sleep(float(environ.get('HTTP_X_DELAY', 0)))
+
+    start_response(
+        '200', [('Content-Length', '0'), ('X-Pid', str(os.getpid()))]
+    )
+
+    return []
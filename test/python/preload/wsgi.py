@@ -0,0 +1,28 @@
+import os
+
+loaded = os.getpid()
+forked = []
+before = []
+parent = []
+
+os.register_at_fork(
+    before=lambda: before.append(os.getpid()),
+    after_in_parent=lambda: parent.append(os.getpid()),
+    after_in_child=lambda: forked.append(os.getpid()),
+)
+
+
+def application(environ, start_response):
+    start_response(
+        '200',
+        [
+            ('Content-Length', '0'),
+            ('X-Pid', str(os.getpid())),
+            ('X-Loaded', str(loaded)),
+            ('X-Forked', ','.join(str(pid) for pid in forked)),
+            ('X-Before', str(len(before))),
+            ('X-Parent', str(len(parent))),
+        ],
+    )
+
+    return []
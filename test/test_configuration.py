@@ -1,3 +1,4 @@
+import os
 import socket
 
 import pytest
@@ -297,6 +298,53 @@ def test_listeners_port_release():
             assert 'success' in resp, 'port release'
 
 
+def test_listeners_reuseport(system):
+    if system != 'Linux':
+        pytest.skip('requires /proc/net/tcp')
+
+    def listen_inodes():
+        inodes = []
+
+        with open('/proc/net/tcp') as f:
+            for line in f.readlines()[1:]:
+                fields = line.split()
+
+                # Local address 127.0.0.1:7080 in the LISTEN state.
+                if fields[1] == '0100007F:1BA8' and fields[3] == '0A':
+                    inodes.append(fields[9])
+
+        return sorted(inodes)
+
+    conf = {
+        "listeners": {"127.0.0.1:7080": {"pass": "routes", "reuseport": True}},
+        "routes": [{"action": {"return": 200}}],
+        "applications": {},
+    }
+
+    assert 'success' in client.conf(conf)
+
+    inodes = listen_inodes()
+    assert len(inodes) == os.cpu_count(), 'sockets'
+
+    for _ in range(10):
+        assert client.get()['status'] == 200, 'reuseport'
+
+    conf["routes"] = [{"action": {"return": 204}}]
+
+    assert 'success' in client.conf(conf)
+    assert listen_inodes() == inodes, 'sockets kept'
+    assert client.get()['status'] == 204, 'reconfigured'
+
+    assert 'success' in client.conf_delete('listeners/127.0.0.1:7080')
+    assert listen_inodes() == [], 'sockets closed'
+
+    assert 'success' in client.conf(
+        {"pass": "routes"}, 'listeners/127.0.0.1:7080'
+    )
+    assert len(listen_inodes()) == 1, 'reuseport disabled'
+    assert client.get()['status'] == 204, 'reuseport disabled status'
+
+
 def test_json_application_name_large():
     name = "X" * 1024 * 1024
 
@@ -447,6 +495,111 @@ def test_json_application_many2():
     assert 'success' in client.conf(conf)
 
 
+def test_json_transaction():
+    assert 'success' in client.conf(
+        {
+            "listeners": {"*:8080": {"pass": "routes"}},
+            "routes": [{"action": {"return": 200}}],
+            "applications": {},
+        }
+    )
+
+    assert 'success' in client.conf_patch(
+        [
+            {
+                "method": "PUT",
+                "path": "/listeners/*:8081",
+                "value": {"pass": "routes"},
+            },
+            {
+                "method": "POST",
+                "path": "/routes",
+                "value": {"action": {"return": 204}},
+            },
+            {"method": "DELETE", "path": "/listeners/*:8080"},
+            {
+                "method": "PUT",
+                "path": "/routes/0/match",
+                "value": {"uri": "/a"},
+            },
+        ]
+    ), 'transaction'
+
+    assert client.conf_get() == {
+        "listeners": {"*:8081": {"pass": "routes"}},
+        "routes": [
+            {"match": {"uri": "/a"}, "action": {"return": 200}},
+            {"action": {"return": 204}},
+        ],
+        "applications": {},
+    }, 'transaction applied'
+
+    assert 'success' in client.conf_patch(
+        [
+            {"method": "DELETE", "path": "/"},
+            {"method": "PUT", "path": "/listeners", "value": {}},
+        ]
+    ), 'transaction whole'
+    assert client.conf_get() == {"listeners": {}}, 'transaction whole applied'
+
+
+def test_json_transaction_invalid():
+    conf = {
+        "listeners": {"*:8080": {"pass": "routes"}},
+        "routes": [{"action": {"return": 200}}],
+        "applications": {},
+    }
+
+    assert 'success' in client.conf(conf)
+
+    def check(ops, error, message):
+        resp = client.conf_patch(ops)
+
+        assert resp['error'] == error, message
+        assert client.conf_get() == conf, f'{message} not applied'
+
+    check({}, 'Invalid transaction.', 'object')
+    check([], 'Invalid transaction.', 'empty')
+    check([{"method": "GET", "path": "/"}], 'Invalid transaction.', 'get')
+    check(
+        [{"method": "DELETE", "path": "/routes", "value": []}],
+        'Invalid transaction.',
+        'delete value',
+    )
+    check([{"method": "PUT", "path": "/routes"}], 'Invalid transaction.', 'put')
+    check(
+        [{"method": "PUT", "path": "routes", "value": []}],
+        'Invalid transaction.',
+        'relative path',
+    )
+    check(
+        [
+            {"method": "DELETE", "path": "/listeners/*:8080"},
+            {"method": "DELETE", "path": "/listeners/*:8080"},
+        ],
+        'Value doesn\'t exist.',
+        'not found',
+    )
+    check(
+        [{"method": "POST", "path": "/listeners", "value": {}}],
+        'Method isn\'t allowed.',
+        'not allowed',
+    )
+    check(
+        [
+            {"method": "DELETE", "path": "/routes"},
+            {"method": "PUT", "path": "/routes", "value": []},
+            {"method": "PUT", "path": "/listeners/*:8080/pass", "value": "x"},
+        ],
+        'Invalid configuration.',
+        'invalid configuration',
+    )
+
+    assert 'error' in client.conf_patch(
+        [{"method": "DELETE", "path": "/routes"}], 'listeners'
+    ), 'sub-path'
+
+
 def test_unprivileged_user_error(require, skip_alert):
     require({'privileged_user': False})
 
@@ -0,0 +1,148 @@
+import os
+import re
+import signal
+import subprocess
+
+import pytest
+from unit.http import HTTP1
+from unit.option import option
+from unit.utils import public_dir
+from unit.utils import waitforfiles
+
+client = HTTP1()
+
+
+@pytest.fixture
+def unitd():
+    # A separate unitd instance, since the engine is set on start.
+
+    temp_dir = f'{option.temp_dir}/io_uring'
+    os.mkdir(temp_dir)
+    os.mkdir(f'{temp_dir}/state')
+    public_dir(temp_dir)
+
+    builddir = f'{option.current_dir}/build'
+    control_sock = f'{temp_dir}/control.unit.sock'
+    log_file = f'{temp_dir}/unit.log'
+
+    with open(log_file, 'w') as log:
+        process = subprocess.Popen(
+            [
+                f'{builddir}/sbin/unitd',
+                '--no-daemon',
+                '--engine',
+                'io_uring',
+                '--modulesdir',
+                f'{builddir}/lib/unit/modules',
+                '--statedir',
+                f'{temp_dir}/state',
+                '--pid',
+                f'{temp_dir}/unit.pid',
+                '--log',
+                log_file,
+                '--control',
+                f'unix:{control_sock}',
+                '--tmpdir',
+                temp_dir,
+            ],
+            stderr=log,
+        )
+
+    try:
+        if not waitforfiles(control_sock):
+            pytest.skip('io_uring engine is not built')
+
+        with open(log_file, 'r') as f:
+            if 'io_uring engine is not available' in f.read():
+                pytest.skip('io_uring is not supported by the kernel')
+
+        yield {
+            'dir': temp_dir,
+            'sock': control_sock,
+            'log': log_file,
+            'pid': process.pid,
+        }
+
+    finally:
+        process.send_signal(signal.SIGQUIT)
+        process.wait(15)
+
+
+def conf(unitd, body):
+    return client.put(
+        url='/config',
+        sock_type='unix',
+        addr=unitd['sock'],
+        body=body,
+    )['body']
+
+
+def test_io_uring(unitd):
+    share = f'{unitd["dir"]}/share'
+    os.mkdir(share)
+
+    data = os.urandom(512 * 1024).hex()
+
+    with open(f'{share}/file', 'w') as f:
+        f.write(data)
+
+    assert 'success' in conf(
+        unitd,
+        f'''{{
+            "listeners": {{"127.0.0.1:7095": {{"pass": "routes"}}}},
+            "routes": [
+                {{
+                    "match": {{"uri": "/file"}},
+                    "action": {{"share": "{share}$uri"}}
+                }},
+                {{"action": {{"return": 204}}}}
+            ]
+        }}''',
+    )
+
+    # the router threads poll with io_uring instead of epoll
+
+    output = subprocess.check_output(['ps', 'ax', '-O', 'ppid']).decode()
+    router = re.search(fr'(\d+)\s+{unitd["pid"]}.*unit: router', output)
+    assert router is not None, 'router'
+
+    fds = f'/proc/{router.group(1)}/fd'
+    links = [os.readlink(f'{fds}/{fd}') for fd in os.listdir(fds)]
+
+    assert 'anon_inode:[io_uring]' in links, 'io_uring'
+    assert 'anon_inode:[eventpoll]' not in links, 'no epoll'
+
+    # accept
+
+    for _ in range(50):
+        assert client.get(port=7095)['status'] == 204
+
+    # keep-alive, request bodies
+
+    body = '0123456789' * 10000
+
+    def post(connection):
+        return (
+            f'POST / HTTP/1.1\r\nHost: localhost\r\n'
+            f'Content-Length: {len(body)}\r\n'
+            f'Connection: {connection}\r\n\r\n{body}'
+        )
+
+    resp = client.http(
+        (post('keep-alive') * 10 + post('close')).encode(),
+        port=7095,
+        raw=True,
+        raw_resp=True,
+    )
+    assert resp.count('HTTP/1.1 204') == 11
+
+    # sendfile
+
+    resp = client.get(port=7095, url='/file')
+    assert resp['status'] == 200
+    assert resp['body'] == data
+
+    with open(unitd['log'], 'r') as f:
+        log = f.read()
+
+    assert re.search(r'\[(alert|crit)\]', log) is None, 'no alerts'
@@ -196,6 +196,69 @@ def test_python_application_ctx_iter_atexit(wait_for_record):
     assert wait_for_record(r'RuntimeError') is not None, 'ctx iter atexit'
 
 
+def test_python_application_queue_size():
+    client.load('delayed', processes=1, limits={"queue": {"size": 1}})
+
+    assert client.get()['status'] == 200, 'init'
+
+    socks = []
+    for _ in range(2):
+        socks.append(
+            client.get(
+                headers={
+                    'Host': 'localhost',
+                    'X-Delay': '1',
+                    'Connection': 'close',
+                },
+                no_recv=True,
+            )
+        )
+
+        time.sleep(0.2)
+
+    resp = client.get()
+    assert resp['status'] == 503, 'queue full'
+    assert resp['headers']['Retry-After'] == '1', 'queue full retry after'
+
+    for sock in socks:
+        assert client.recvall(sock).decode().startswith('HTTP/1.1 200')
+        sock.close()
+
+    assert client.get()['status'] == 200, 'queue drained'
+
+
+def test_python_application_queue_wait():
+    client.load('delayed', processes=1, limits={"queue": {"wait": 500}})
+
+    assert client.get()['status'] == 200, 'init'
+
+    sock = client.get(
+        headers={
+            'Host': 'localhost',
+            'X-Delay': '2',
+            'Connection': 'close',
+        },
+        no_recv=True,
+    )
+
+    time.sleep(0.2)
+
+    start = time.time()
+    resp = client.get()
+    assert resp['status'] == 503, 'queue wait timeout'
+    assert resp['headers']['Retry-After'] == '1', 'queue wait retry after'
+    assert time.time() - start < 1.5, 'queue wait timeout time'
+
+    sock.close()
+
+    assert 'error' in client.conf(
+        {"size": -1}, 'applications/delayed/limits/queue'
+    ), 'negative size'
+    assert 'error' in client.conf(
+        {"wait": -1}, 'applications/delayed/limits/queue'
+    ), 'negative wait'
+
+
 def test_python_keepalive_body():
     client.load('mirror')
 
@@ -896,6 +959,89 @@ def test_python_application_path_invalid():
     check_path('["/blah", []]')
 
 
+def test_python_application_preload():
+    client.load('preload', processes=2, preload=True)
+
+    loaded = set()
+    for _ in range(10):
+        headers = client.get()['headers']
+
+        pid = headers['X-Pid']
+        assert headers['X-Loaded'] != pid, 'loaded in prototype'
+        assert headers['X-Forked'] == pid, 'at fork hook'
+
+        # The prototype ran "before" for this fork and "after_in_parent"
+        # for each previous one.
+
+        assert int(headers['X-Before']) == int(headers['X-Parent']) + 1
+
+        loaded.add(headers['X-Loaded'])
+
+    assert len(loaded) == 1, 'single prototype'
+
+    client.load('preload')
+
+    headers = client.get()['headers']
+    assert headers['X-Loaded'] == headers['X-Pid'], 'loaded in worker'
+    assert headers['X-Forked'] == '', 'no at fork hook'
+
+    assert 'error' in client.conf('1', 'applications/preload/preload')
+
+
+def test_python_application_affinity():
+    client.load('pid', processes=4)
+
+    assert 'success' in client.conf(
+        [
+            {
+                "action": {
+                    "pass": "applications/pid",
+                    "affinity": "$header_x_tenant",
+                }
+            }
+        ],
+        'routes',
+    )
+    assert 'success' in client.conf('"routes"', 'listeners/*:7080/pass')
+
+    def pid(tenant):
+        return client.get(
+            headers={
+                'Host': 'localhost',
+                'X-Tenant': tenant,
+                'Connection': 'close',
+            }
+        )['headers']['X-Pid']
+
+    sticky = {}
+    for tenant in 'abcdefgh':
+        pids = {pid(tenant) for _ in range(5)}
+        assert len(pids) == 1, f'sticky {tenant}'
+
+        sticky[tenant] = pids.pop()
+
+    assert len(set(sticky.values())) > 1, 'spread'
+
+    # busy process falls back to the shared queue
+
+    sock = client.get(
+        headers={
+            'Host': 'localhost',
+            'X-Tenant': 'a',
+            'X-Delay': '1',
+            'Connection': 'close',
+        },
+        no_recv=True,
+    )
+
+    time.sleep(0.3)
+
+    assert pid('a') != sticky['a'], 'busy fallback'
+    assert client.recvall(sock).decode().startswith('HTTP/1.1 200')
+
+    assert pid('a') == sticky['a'], 'sticky again'
+
+
 def test_python_application_threads():
     client.load('threads', threads=4)
 
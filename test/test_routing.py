@@ -698,6 +698,228 @@ def test_routes_match_uri_normalize():
     assert client.get(url='/%62%6c%61%68')['status'] == 200, 'normalize'
 
 
+def test_routes_match_many_steps():
+    assert 'success' in client.conf(
+        [
+            {"match": {"uri": "/a*", "method": "POST"}, "action": {"return": 201}},
+            {
+                "match": {"host": "example.com", "uri": "/a/b"},
+                "action": {"return": 202},
+            },
+            {"match": {"uri": ["/a/b*", "/x"]}, "action": {"return": 203}},
+            {
+                "match": {"host": ["www.example.com", "example.org"]},
+                "action": {"return": 204},
+            },
+            {"match": {"uri": "*c"}, "action": {"return": 205}},
+            {
+                "match": {"host": "!example.com", "uri": "/a"},
+                "action": {"return": 206},
+            },
+            {"match": {"uri": "/"}, "action": {"return": 207}},
+            {"match": {"host": "example.com"}, "action": {"return": 208}},
+            {"match": {"uri": "/b*"}, "action": {"return": 209}},
+        ],
+        'routes',
+    ), 'many steps configure'
+
+    def check(host, url, status, method='GET'):
+        assert (
+            client.http(
+                method,
+                url=url,
+                headers={'Host': host, 'Connection': 'close'},
+            )['status']
+            == status
+        ), f'{method} {host} {url}'
+
+    check('localhost', '/a/b', 203)
+    check('localhost', '/a/b', 201, 'POST')
+    check('example.com', '/a/b', 202)
+    check('example.com', '/a/bc', 203)
+    check('example.org', '/zzz', 204)
+    check('www.example.com', '/a/b', 203)
+    check('localhost', '/zc', 205)
+    check('localhost', '/a', 206)
+    check('example.com', '/a', 208)
+    check('localhost', '/', 207)
+    check('example.com', '/b', 208)
+    check('localhost', '/bar', 209)
+    check('localhost', '/x', 203)
+    check('localhost', '/x/', 404)
+    check('localhost', '/zzz', 404)
+
+
+def test_routes_match_uri_many_patterns():
+    pad = [f'/pad{i}*' for i in range(16)]
+
+    def uri(patterns, url, status):
+        route_match({"uri": pad + patterns})
+        assert client.get(url=url)['status'] == status, (patterns, url)
+
+    uri(["/api/v1/*"], '/api/v1/users', 200)
+    uri(["/api/v1/*"], '/api/v2/users', 404)
+    uri(["/api/v1/*"], '/API/v1/users', 404)
+    uri(["/api"], '/api', 200)
+    uri(["/api"], '/api/', 404)
+    uri(["*.php"], '/index.php', 200)
+    uri(["*.php"], '/index.php5', 404)
+    uri(["*/admin*"], '/site/admin/login', 200)
+    uri(["*/admin*"], '/site/Admin/login', 404)
+    uri(["*/a*/b*/c*"], '/x/a/y/b/z/c', 200)
+    uri(["*/a*/b*/c*"], '/x/c/y/b/z/a', 404)
+    uri(["*sh*sh*"], '/shsh', 200)
+    uri(["*sh*sh*"], '/shs', 404)
+    uri(["/a*z", "*.php"], '/abz', 200)
+    uri(["/a*z"], '/abc', 404)
+    uri(["*"], '/anything', 200)
+    uri(["*.php", "!/pad0/*"], '/pad0/index.php', 404)
+    uri(["*.php", "!*/admin*"], '/index.php', 200)
+    uri(["*.php", "!*/admin*"], '/admin/index.php', 404)
+    uri(["!/pad0/*"], '/pad0/', 404)
+    uri(["!/pad0/*"], '/pad/', 404)
+
+    route_match({"uri": [f'!/pad{i}*' for i in range(16)]})
+    assert client.get(url='/pad0')['status'] == 404, 'negative'
+    assert client.get(url='/pad')['status'] == 200, 'negative 2'
+
+
+def test_routes_match_headers_many_patterns():
+    route_match(
+        {
+            "headers": {
+                "x-blah": [f'pad{i}*' for i in range(16)]
+                + ["*Gecko*", "Mozilla/*", "*bot", "!*crawler*"]
+            }
+        }
+    )
+
+    def blah(value, status):
+        assert (
+            client.get(
+                headers={
+                    "Host": "localhost",
+                    "X-blah": value,
+                    "Connection": "close",
+                }
+            )['status']
+            == status
+        ), value
+
+    blah('like gecko', 200)
+    blah('mozilla/5.0', 200)
+    blah('GoogleBot', 200)
+    blah('PAD3', 200)
+    blah('bots', 404)
+    blah('some crawler bot', 404)
+    blah('Mozilla', 404)
+
+
+def test_routes_match_many_hosts():
+    steps = [
+        {
+            "match": {"host": f"tenant{i}.example.com"},
+            "action": {"return": 201},
+        }
+        for i in range(50)
+    ]
+
+    steps += [
+        {
+            "match": {"host": "*.tenant3.example.com"},
+            "action": {"return": 202},
+        },
+        {
+            "match": {"host": ["*.example.org", "a*.b.com"]},
+            "action": {"return": 203},
+        },
+        {"match": {"host": "*3.example.com"}, "action": {"return": 204}},
+        {
+            "match": {"host": "*.example.com", "uri": "/a"},
+            "action": {"return": 205},
+        },
+        {"match": {"host": "w*.example.com"}, "action": {"return": 206}},
+        {"match": {"uri": "/b"}, "action": {"return": 207}},
+        {"match": {"host": "*.example.com"}, "action": {"return": 208}},
+    ]
+
+    assert 'success' in client.conf(steps, 'routes'), 'many hosts configure'
+
+    def check(host, status, url='/'):
+        assert (
+            client.get(
+                url=url,
+                headers={'Host': host, 'Connection': 'close'},
+            )['status']
+            == status
+        ), f'{host} {url}'
+
+    check('tenant7.example.com', 201)
+    check('TENANT49.example.com:8080', 201)
+    check('x.tenant3.example.com', 202)
+    check('example.org', 404)
+    check('www.example.org', 203)
+    check('ab.b.com', 203)
+    check('b.b.com', 404)
+    check('tenant53.example.com', 204)
+    check('3.example.com', 204)
+    check('z.example.com', 205, '/a')
+    check('www.example.com', 206)
+    check('www.example.com', 205, '/a')
+    check('localhost', 207, '/b')
+    check('z.example.com', 207, '/b')
+    check('z.example.com', 208)
+    check('example.com', 404)
+
+
+def test_routes_match_cache():
+    def steps(status):
+        return [
+            {
+                "match": {"host": f"h{i}.com", "uri": "/a*"},
+                "action": {"return": status + i},
+            }
+            for i in range(8)
+        ] + [
+            {"match": {"method": "POST"}, "action": {"return": 290}},
+            {"match": {"uri": "/b*"}, "action": {"return": 291}},
+        ]
+
+    def check(host, url, status, method='GET'):
+        for _ in range(3):
+            assert (
+                client.http(
+                    method,
+                    url=url,
+                    headers={'Host': host, 'Connection': 'close'},
+                )['status']
+                == status
+            ), f'{method} {host} {url}'
+
+    assert 'success' in client.conf(steps(200), 'routes'), 'configure'
+
+    check('h1.com', '/a', 201)
+    check('h1.com', '/ab', 201)
+    check('h1.com', '/ba', 291)
+    check('h7.com', '/a', 207)
+    check('h8.com', '/a', 290, 'POST')
+    check('h8.com', '/a', 404)
+
+    assert 'success' in client.conf(steps(210), 'routes'), 'reconfigure'
+
+    check('h1.com', '/a', 211)
+    check('h7.com', '/a', 217)
+    check('h8.com', '/a', 290, 'POST')
+    check('h8.com', '/a', 404)
+
+    assert 'success' in client.conf(
+        {"X-Test": "1"}, 'routes/9/match/headers'
+    ), 'headers'
+
+    check('h8.com', '/b', 404)
+    check('h1.com', '/a', 211)
+
+
 def test_routes_match_empty_array():
     route_match({"uri": []})
 
@@ -1821,6 +2043,46 @@ def test_routes_source_cidr_ipv6():
     assert client.get(port=7081)['status'] == 404, '0 ipv4'
 
 
+def test_routes_source_many():
+    assert 'success' in client.conf(
+        {
+            "*:7080": {"pass": "routes"},
+            "[::1]:7081": {"pass": "routes"},
+        },
+        'listeners',
+    ), 'source listeners configure'
+
+    def get_ipv6():
+        return client.get(sock_type='ipv6', port=7081)
+
+    def source(addrs, status, status_ipv6):
+        pad = [f'10.0.{i}.0/24' for i in range(10)] + [
+            f'2001:db8::{i}' for i in range(10)
+        ]
+
+        if all(addr.startswith('!') for addr in addrs):
+            pad = [f'!{addr}' for addr in pad]
+
+        route_match({"source": pad + addrs})
+        assert client.get()['status'] == status, addrs
+        assert get_ipv6()['status'] == status_ipv6, addrs
+
+    source(["127.0.0.1"], 200, 404)
+    source(["::1"], 404, 200)
+    source(["127.0.0.0-127.0.0.5"], 200, 404)
+    source(["126.255.255.254-127.0.0.0"], 404, 404)
+    source(["::-::2"], 404, 200)
+    source(["127.0.0.0/8", "!127.0.0.1"], 404, 404)
+    source(["0.0.0.0/1", "!127.0.0.0/9"], 404, 404)
+    source(["0.0.0.0/1", "!128.0.0.0/1"], 200, 404)
+    source(["!127.0.0.2", "!::2"], 200, 200)
+    source(["!127.0.0.0/24"], 404, 200)
+    source(["*:1024-65535"], 200, 200)
+    source(["127.0.0.1:1024-65535"], 200, 404)
+    source(["127.0.0.1:0-1023"], 404, 404)
+    source(["::/0", "!*:1024-65535"], 404, 404)
+
+
 def test_routes_source_unix(temp_dir):
     addr = f'{temp_dir}/sock'
 
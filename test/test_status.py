@@ -146,6 +146,31 @@ def test_status_connections():
     check_connections(3, 0, 0, 3)
 
 
+def test_status_counters():
+    assert 'success' in client.conf(
+        {
+            "listeners": {"*:7080": {"pass": "routes"}},
+            "routes": [{"action": {"return": 200}}],
+            "applications": {},
+        },
+    )
+
+    for _ in range(3):
+        assert client.get()['status'] == 200
+
+    status = client.conf_get('/status')
+
+    assert client.conf_get('/status/connections') == status['connections']
+    assert client.conf_get('/status/connections/closed') == (
+        status['connections']['closed']
+    )
+    assert client.conf_get('/status/requests') == status['requests']
+    assert client.conf_get('/status/requests/total') == (
+        status['requests']['total']
+    )
+    assert 'error' in client.conf_get('/status/requests/blah')
+
+
 def test_status_applications():
     def check_applications(expert):
         apps = list(client.conf_get('/status/applications').keys()).sort()
@@ -216,6 +241,150 @@ def test_status_applications():
     check_application('delayed', 0, 0, 0, 0)
 
 
+def test_status_applications_scaling():
+    conf = app_default("delayed")
+    conf['processes'] = {
+        "spare": 0,
+        "max": 1,
+        "idle_timeout": 1,
+        "target_latency": 100,
+    }
+
+    assert 'success' in client.conf(
+        {
+            "listeners": {"*:7080": {"pass": "applications/delayed"}},
+            "applications": {"delayed": conf},
+        },
+    )
+
+    scaling = '/status/applications/delayed/scaling'
+
+    assert client.conf_get(scaling) == {
+        'target': 0,
+        'queued': 0,
+        'latency': 0,
+        'scale_ups': 0,
+        'scale_downs': 0,
+    }
+
+    # second request waits in queue longer than target latency
+
+    socks = []
+    for _ in range(2):
+        sock = client.get(
+            headers={
+                'Host': 'localhost',
+                'X-Delay': '1',
+                'Connection': 'close',
+            },
+            start=True,
+            no_recv=True,
+        )
+        socks.append(sock)
+
+    time.sleep(0.5)
+
+    status = client.conf_get(scaling)
+    assert status['queued'] == 1, 'queued'
+    assert status['target'] == 1, 'target'
+    assert status['scale_ups'] == 1, 'scale up'
+    assert status['latency'] >= 100, 'latency'
+
+    for sock in socks:
+        client.get(sock=sock)
+
+    # process outlives idle_timeout while target holds it
+
+    time.sleep(2)
+
+    assert (
+        client.conf_get('/status/applications/delayed/processes/running') == 1
+    ), 'held by target'
+    assert client.conf_get(f'{scaling}/queued') == 0, 'queue drained'
+
+    # target drops after calm period and idle process exits
+
+    time.sleep(5)
+
+    status = client.conf_get(scaling)
+    assert status['target'] == 0, 'target down'
+    assert status['scale_downs'] == 1, 'scale down'
+    assert (
+        client.conf_get('/status/applications/delayed/processes/running') == 0
+    ), 'idle process stopped'
+
+    assert 'error' in client.conf(
+        '-1', 'applications/delayed/processes/target_latency'
+    ), 'negative target_latency'
+
+
+def test_status_applications_priority():
+    conf = app_default("delayed")
+    conf['processes'] = {"spare": 0, "max": 1}
+
+    assert 'success' in client.conf(
+        {
+            "listeners": {"*:7080": {"pass": "routes"}},
+            "routes": [
+                {
+                    "match": {"headers": {"X-Priority": "high"}},
+                    "action": {
+                        "pass": "applications/delayed",
+                        "priority": "high",
+                    },
+                },
+                {
+                    "match": {"headers": {"X-Priority": "low"}},
+                    "action": {
+                        "pass": "applications/delayed",
+                        "priority": "low",
+                    },
+                },
+                {"action": {"pass": "applications/delayed"}},
+            ],
+            "applications": {"delayed": conf},
+        },
+    )
+
+    queue = '/status/applications/delayed/queue'
+
+    assert client.conf_get(queue) == {'error': 'Invalid path.'}, 'no lanes'
+
+    def req(priority, delay):
+        return client.get(
+            headers={
+                'Host': 'localhost',
+                'X-Priority': priority,
+                'X-Delay': delay,
+                'Connection': 'close',
+            },
+            start=True,
+            no_recv=True,
+        )
+
+    socks = [req('normal', '1')]
+    time.sleep(0.3)
+
+    socks.extend([req('low', '1'), req('low', '1')])
+    socks.extend([req('high', '0'), req('high', '0')])
+    time.sleep(0.3)
+
+    assert client.conf_get(queue) == {'high': 2, 'normal': 0, 'low': 2}
+
+    # high lane drains before low lane once the process is free
+
+    time.sleep(1)
+
+    assert client.conf_get(queue) == {'high': 0, 'normal': 0, 'low': 1}
+
+    for sock in socks:
+        assert client.get(sock=sock)['status'] == 200
+
+    assert 'error' in client.conf(
+        '"urgent"', 'routes/0/action/priority'
+    ), 'invalid priority'
+
+
 def test_status_proxy():
     assert 'success' in client.conf(
         {
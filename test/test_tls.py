@@ -1,11 +1,18 @@
 import io
+import json
+import os
+import signal
+import socket
 import ssl
 import subprocess
 import time
+from pathlib import Path
 
 import pytest
+from conftest import pid_by_name
 from unit.applications.tls import ApplicationTLS
 from unit.option import option
+from unit.utils import waitforfiles
 
 prerequisites = {'modules': {'python': 'any', 'openssl': 'any'}}
 
@@ -187,6 +194,97 @@ def test_tls_certificate_update():
     ), 'update certificate'
 
 
+def test_tls_certificate_removed(temp_dir):
+    # A separate unitd instance is restarted with the same state directory.
+
+    client.certificate('default', False)
+
+    state = f'{temp_dir}/stored'
+    os.mkdir(state)
+
+    sock = f'{state}/control.unit.sock'
+    log_file = f'{state}/unit.log'
+
+    def start():
+        with open(log_file, 'w') as log:
+            process = subprocess.Popen(
+                [
+                    f'{option.current_dir}/build/sbin/unitd',
+                    '--no-daemon',
+                    '--modulesdir',
+                    f'{option.current_dir}/build/lib/unit/modules',
+                    '--statedir',
+                    state,
+                    '--pid',
+                    f'{state}/unit.pid',
+                    '--log',
+                    log_file,
+                    '--control',
+                    f'unix:{sock}',
+                    '--tmpdir',
+                    temp_dir,
+                ],
+                stderr=log,
+            )
+
+        assert waitforfiles(sock), 'start'
+
+        return process
+
+    def stop(process):
+        process.send_signal(signal.SIGQUIT)
+        process.wait(15)
+
+    def listeners():
+        return client.getjson(
+            url='/config/listeners', sock_type='unix', addr=sock
+        )['body']
+
+    process = start()
+
+    with open(f'{temp_dir}/default.key', 'rb') as k, open(
+        f'{temp_dir}/default.crt', 'rb'
+    ) as c:
+        client.put(
+            url='/certificates/default',
+            body=k.read() + c.read(),
+            sock_type='unix',
+            addr=sock,
+        )
+
+    assert 'success' in client.put(
+        url='/config',
+        body=json.dumps(
+            {
+                "listeners": {
+                    "*:7082": {
+                        "pass": "routes",
+                        "tls": {"certificate": "default"},
+                    }
+                },
+                "routes": [{"action": {"return": 200}}],
+            }
+        ),
+        sock_type='unix',
+        addr=sock,
+    )['body']
+
+    stop(process)
+
+    process = start()
+    assert '*:7082' in listeners(), 'stored configuration'
+    stop(process)
+
+    os.remove(f'{state}/certs/default')
+
+    process = start()
+    assert listeners() == {}, 'certificate removed'
+    stop(process)
+
+    with open(log_file, 'r') as f:
+        assert 'Certificate "default" is not found' in f.read(), 'log'
+
+
 @pytest.mark.skip('not yet')
 def test_tls_certificate_key_incorrect():
     client.load('empty')
@@ -702,3 +800,768 @@ def test_tls_multi_listener():
     assert client.get_ssl()['status'] == 200, 'listener #1'
 
     assert client.get_ssl(port=7081)['status'] == 200, 'listener #2'
+
+
+def test_tls_handshake_threads():
+    client.load('empty')
+
+    client.certificate()
+
+    add_tls()
+
+    assert 'tls' not in client.conf_get('/status'), 'no tls status'
+
+    assert 'error' in client.conf(
+        {"tls": {"handshake_threads": -1}}, 'settings'
+    )
+    assert 'error' in client.conf(
+        {"tls": {"handshake_threads": 257}}, 'settings'
+    )
+    assert 'success' in client.conf(
+        {"tls": {"handshake_threads": 2}}, 'settings'
+    )
+
+    for _ in range(5):
+        sock = socket.create_connection(('127.0.0.1', 7080))
+
+        # The first handshake step finds no ClientHello and runs in place.
+        time.sleep(0.1)
+
+        sock = client._default_context.wrap_socket(sock)
+
+        assert client.get(sock=sock)['status'] == 200, 'offloaded'
+
+    handshakes = client.conf_get('/status/tls/handshakes')
+
+    assert handshakes['queued'] == 0, 'queued'
+    assert handshakes['offloaded'] >= 5, 'offloaded'
+
+    assert 'success' in client.conf_delete('settings/tls')
+    assert 'tls' not in client.conf_get('/status'), 'tls status removed'
+    assert client.get_ssl()['status'] == 200, 'in place'
+
+
+def test_tls_handshake_threads_reconfigure():
+    client.load('empty')
+
+    client.certificate()
+
+    add_tls()
+
+    def threads():
+        return len(os.listdir(f'/proc/{pid_by_name("unit: router")}/task'))
+
+    def offloaded_handshakes(count):
+        for _ in range(count):
+            sock = socket.create_connection(('127.0.0.1', 7080))
+            time.sleep(0.1)
+
+            sock = client._default_context.wrap_socket(sock)
+
+            assert client.get(sock=sock)['status'] == 200
+
+    initial = threads()
+
+    assert 'success' in client.conf(
+        {"tls": {"handshake_threads": 4}}, 'settings'
+    )
+
+    offloaded_handshakes(3)
+    assert threads() > initial, 'pool threads'
+
+    # The pool is destroyed after the previous listeners are released.
+
+    assert 'success' in client.conf({"handshake_threads": 0}, 'settings/tls')
+    assert 'tls' not in client.conf_get('/status'), 'no tls status'
+
+    for _ in range(50):
+        if threads() == initial:
+            break
+
+        time.sleep(0.1)
+
+    assert threads() == initial, 'pool destroyed'
+    assert client.get_ssl()['status'] == 200, 'in place'
+
+    assert 'success' in client.conf(
+        {"tls": {"handshake_threads": 1}}, 'settings'
+    )
+
+    offloaded_handshakes(2)
+
+    handshakes = client.conf_get('/status/tls/handshakes')
+    assert handshakes['offloaded'] >= 2, 'new pool'
+
+
+def ktls_stat():
+    stat = {}
+
+    with open('/proc/net/tls_stat', 'r') as f:
+        for line in f:
+            name, value = line.split()
+            stat[name] = int(value)
+
+    return stat
+
+
+def check_ktls():
+    # The "tls" upper layer protocol is loaded on the first use.
+
+    server = socket.create_server(('127.0.0.1', 0))
+    sock = socket.create_connection(server.getsockname())
+
+    try:
+        sock.setsockopt(socket.SOL_TCP, 31, b'tls')  # TCP_ULP
+
+    except OSError:
+        pytest.skip('kTLS is not supported by the kernel')
+
+    finally:
+        sock.close()
+        server.close()
+
+
+def test_tls_ktls(temp_dir):
+    client.certificate()
+
+    data = '0123456789' * 100000
+
+    with open(f'{temp_dir}/index.html', 'w', encoding='utf-8') as f:
+        f.write(data)
+
+    assert 'error' in client.conf(
+        {"certificate": "default", "ktls": "on"}, 'listeners/*:7080/tls'
+    ), 'ktls invalid'
+
+    check_ktls()
+
+    assert 'success' in client.conf(
+        {
+            "listeners": {
+                "*:7080": {
+                    "pass": "routes",
+                    "tls": {"certificate": "default", "ktls": True},
+                }
+            },
+            "routes": [{"action": {"share": f'{temp_dir}$uri'}}],
+            "applications": {},
+        }
+    )
+
+    stat = ktls_stat()
+
+    (resp, sock) = client.get_ssl(
+        headers={'Host': 'localhost', 'Connection': 'keep-alive'},
+        start=True,
+        read_timeout=1,
+    )
+
+    assert resp['status'] == 200, 'keepalive 1 status'
+    assert resp['body'] == data, 'keepalive 1 body'
+
+    # The kernel encrypts records of the connection.
+
+    def ktls_tx(stat):
+        return stat.get('TlsTxSw', 0) + stat.get('TlsTxDevice', 0)
+
+    assert ktls_tx(ktls_stat()) > ktls_tx(stat), 'ktls enabled'
+
+    resp = client.get_ssl(
+        headers={'Host': 'localhost', 'Connection': 'close'}, sock=sock
+    )
+
+    assert resp['status'] == 200, 'keepalive 2 status'
+    assert resp['body'] == data, 'keepalive 2 body'
+
+
+def test_tls_session_cache_reconfigure():
+    client.load('empty')
+
+    client.certificate()
+
+    def set_cache(cache_size):
+        assert 'success' in client.conf(
+            {
+                "pass": "applications/empty",
+                "tls": {
+                    "certificate": "default",
+                    "session": {"cache_size": cache_size},
+                },
+            },
+            'listeners/*:7080',
+        )
+
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    ctx.check_hostname = False
+    ctx.verify_mode = ssl.CERT_NONE
+    ctx.maximum_version = ssl.TLSVersion.TLSv1_2
+    ctx.options |= ssl.OP_NO_TICKET
+
+    def connect(session=None):
+        sock = ctx.wrap_socket(
+            socket.create_connection(('127.0.0.1', 7080)), session=session
+        )
+
+        session, reused = sock.session, sock.session_reused
+        sock.close()
+
+        return session, reused
+
+    set_cache(10)
+
+    sess, reused = connect()
+    assert not reused, 'new session'
+
+    _, reused = connect(sess)
+    assert reused, 'cached session'
+
+    assert 'success' in client.conf({"http": {"idle_timeout": 30}}, 'settings')
+
+    _, reused = connect(sess)
+    assert reused, 'cached session after reconfiguration'
+
+    set_cache(20)
+
+    _, reused = connect(sess)
+    assert not reused, 'new cache'
+
+
+def test_tls_reconfigure_unchanged():
+    client.load('empty')
+
+    client.certificate()
+
+    def set_tls(timeout):
+        assert 'success' in client.conf(
+            {
+                "pass": "applications/empty",
+                "tls": {
+                    "certificate": "default",
+                    "session": {"tickets": True, "timeout": timeout},
+                },
+            },
+            'listeners/*:7080',
+        )
+
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    ctx.check_hostname = False
+    ctx.verify_mode = ssl.CERT_NONE
+    ctx.maximum_version = ssl.TLSVersion.TLSv1_2
+
+    def connect(session=None):
+        sock = ctx.wrap_socket(
+            socket.create_connection(('127.0.0.1', 7080)), session=session
+        )
+
+        session, reused = sock.session, sock.session_reused
+        sock.close()
+
+        return session, reused
+
+    set_tls(300)
+
+    sess, reused = connect()
+    assert not reused, 'new session'
+
+    _, reused = connect(sess)
+    assert reused, 'ticket'
+
+    # The ticket keys are random, so a ticket is accepted only
+    # if the TLS configuration of the listener has been kept.
+
+    assert 'success' in client.conf({"http": {"idle_timeout": 30}}, 'settings')
+
+    _, reused = connect(sess)
+    assert reused, 'ticket after reconfiguration'
+
+    assert 'success' in client.conf(
+        {"pass": "applications/empty", "tls": {"certificate": "default"}},
+        'listeners/*:7081',
+    )
+
+    _, reused = connect(sess)
+    assert reused, 'ticket after new listener'
+
+    set_tls(600)
+
+    _, reused = connect(sess)
+    assert not reused, 'new ticket keys'
+
+
+def tls_records(size, count=1, delay=0):
+    # Returns lengths of application data records sent in response to
+    # each request, the records are parsed before decryption.
+
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    ctx.check_hostname = False
+    ctx.verify_mode = ssl.CERT_NONE
+
+    incoming = ssl.MemoryBIO()
+    outgoing = ssl.MemoryBIO()
+    tls = ctx.wrap_bio(incoming, outgoing)
+
+    sock = socket.create_connection(('127.0.0.1', 7080))
+    sock.settimeout(5)
+
+    raw = b''
+
+    def recv():
+        nonlocal raw
+
+        chunk = sock.recv(65536)
+        raw += chunk
+        incoming.write(chunk)
+
+        return chunk
+
+    while True:
+        try:
+            tls.do_handshake()
+            break
+
+        except ssl.SSLWantReadError:
+            sock.sendall(outgoing.read())
+            recv()
+
+    sock.sendall(outgoing.read())
+
+    starts = []
+    bodies = []
+
+    for i in range(count):
+        if i > 0:
+            time.sleep(delay)
+
+        starts.append(len(raw))
+
+        tls.write(
+            b'GET / HTTP/1.1\r\nHost: localhost\r\n'
+            + (b'Connection: close\r\n' if i == count - 1 else b'')
+            + b'\r\n'
+        )
+        sock.sendall(outgoing.read())
+
+        resp = b''
+
+        while len(resp.partition(b'\r\n\r\n')[2]) < size:
+            try:
+                resp += tls.read(65536)
+
+            except ssl.SSLWantReadError:
+                assert recv(), 'response'
+
+        bodies.append(resp.partition(b'\r\n\r\n')[2].decode())
+
+    sock.close()
+
+    starts.append(len(raw))
+
+    records = [[] for _ in range(count)]
+    offset = 0
+
+    while offset + 5 <= len(raw):
+        length = int.from_bytes(raw[offset + 3 : offset + 5], 'big')
+
+        # application data
+
+        if raw[offset] == 23:
+            for i, start in enumerate(starts[:-1]):
+                if start <= offset < starts[i + 1]:
+                    records[i].append(length)
+
+        offset += 5 + length
+
+    return bodies, records
+
+
+def test_tls_records(temp_dir):
+    client.certificate()
+
+    data = '0123456789' * 100000
+
+    with open(f'{temp_dir}/index.html', 'w', encoding='utf-8') as f:
+        f.write(data)
+
+    assert 'success' in client.conf(
+        {
+            "listeners": {
+                "*:7080": {
+                    "pass": "routes",
+                    "tls": {"certificate": "default", "records": {}},
+                }
+            },
+            "routes": [{"action": {"share": f'{temp_dir}$uri'}}],
+            "applications": {},
+        }
+    )
+
+    def check_records(records):
+        assert 'success' in client.conf(records, 'listeners/*:7080/tls/records')
+
+        (resp, sock) = client.get_ssl(
+            headers={'Host': 'localhost', 'Connection': 'keep-alive'},
+            start=True,
+            read_timeout=1,
+        )
+
+        assert resp['status'] == 200, 'keepalive 1 status'
+        assert resp['body'] == data, 'keepalive 1 body'
+
+        resp = client.get_ssl(
+            headers={'Host': 'localhost', 'Connection': 'close'}, sock=sock
+        )
+
+        assert resp['status'] == 200, 'keepalive 2 status'
+        assert resp['body'] == data, 'keepalive 2 body'
+
+    check_records({})
+
+    def check_sizes(records, initial_size, max_size, threshold):
+        # up to 256 bytes of record overhead
+
+        large = [i for i, r in enumerate(records) if r > initial_size + 256]
+
+        # session tickets may be sent before the response
+
+        assert threshold <= large[0] <= threshold + 2, 'initial records'
+        assert max(records) > max_size - 256, 'records grow'
+        assert max(records) <= max_size + 256, 'max_size'
+
+    # the second response is sent after the connection was idle
+
+    bodies, records = tls_records(len(data), 2, 1.5)
+
+    assert bodies == [data, data], 'records bodies'
+    check_sizes(records[0], 1369, 16384, 40)
+    check_sizes(records[1], 1369, 16384, 40)
+
+    check_records({"initial_size": 512, "threshold": 0})
+
+    check_records(
+        {
+            "initial_size": 1000,
+            "max_size": 4096,
+            "threshold": 10,
+            "idle_timeout": 60000,
+        }
+    )
+
+    bodies, records = tls_records(len(data), 2, 0.5)
+
+    assert bodies == [data, data], 'records bodies 2'
+    check_sizes(records[0], 1000, 4096, 10)
+    assert records[1][1] > 1000 + 256, 'not idle'
+
+    check_records(
+        {
+            "initial_size": 1000,
+            "max_size": 4096,
+            "threshold": 10,
+            "idle_timeout": 0,
+        }
+    )
+
+    assert 'error' in client.conf(
+        {"initial_size": 100}, 'listeners/*:7080/tls/records'
+    ), 'initial_size small'
+    assert 'error' in client.conf(
+        {"max_size": 16385}, 'listeners/*:7080/tls/records'
+    ), 'max_size large'
+    assert 'error' in client.conf(
+        {"threshold": -1}, 'listeners/*:7080/tls/records'
+    ), 'threshold negative'
+    assert 'error' in client.conf(
+        {"idle_timeout": "1"}, 'listeners/*:7080/tls/records'
+    ), 'idle_timeout string'
+
+
+def test_tls_early_data(temp_dir):
+    client.load('header_fields')
+
+    client.certificate()
+
+    assert 'success' in client.conf(
+        {
+            "pass": "applications/header_fields",
+            "tls": {
+                "certificate": "default",
+                "session": {"tickets": True},
+                "early_data": {},
+            },
+        },
+        'listeners/*:7080',
+    )
+
+    def s_client(stdin, *args):
+        return subprocess.run(
+            [
+                'openssl',
+                's_client',
+                '-connect',
+                '127.0.0.1:7080',
+                '-tls1_3',
+                '-ign_eof',
+                *args,
+            ],
+            input=stdin.encode(),
+            stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT,
+            timeout=10,
+        ).stdout.decode(errors='replace')
+
+    def request(method):
+        return (
+            f'{method} / HTTP/1.1\r\nHost: localhost\r\n'
+            'Content-Length: 0\r\nCustom-Header: early\r\n'
+            'Connection: close\r\n\r\n'
+        )
+
+    sess = f'{temp_dir}/sess.pem'
+
+    def early_data(method):
+        with open(f'{temp_dir}/early.txt', 'w') as f:
+            f.write(request(method))
+
+        s_client(request('GET'), '-sess_out', sess)
+
+        return s_client(
+            '', '-sess_in', sess, '-early_data', f'{temp_dir}/early.txt'
+        )
+
+    out = s_client(request('GET'), '-sess_out', sess)
+    assert 'HTTP/1.1 200' in out, 'full handshake'
+    assert 'HTTP_EARLY_DATA' not in out, 'full handshake no early data'
+
+    out = early_data('GET')
+    assert 'Early data was accepted' in out, 'early data accepted'
+    assert 'HTTP/1.1 200' in out, 'early data status'
+    assert 'HTTP_EARLY_DATA' in out, 'early data header'
+
+    out = early_data('POST')
+    assert 'Early data was accepted' in out, 'early data unsafe accepted'
+    assert 'HTTP/1.1 425 Too Early' in out, 'early data unsafe'
+
+    assert 'error' in client.conf(
+        {"max_size": 0}, 'listeners/*:7080/tls/early_data'
+    ), 'max_size invalid'
+
+
+def test_tls_early_data_replay(temp_dir, findall, wait_for_record):
+    client.load('empty')
+
+    client.certificate()
+
+    assert 'success' in client.conf(
+        {
+            "pass": "applications/empty",
+            "tls": {
+                "certificate": "default",
+                "session": {"tickets": True},
+                "early_data": {},
+            },
+        },
+        'listeners/*:7080',
+    )
+
+    assert 'success' in client.conf(
+        f'"{temp_dir}/access.log"', 'access_log'
+    ), 'access_log configure'
+
+    sess = f'{temp_dir}/sess.pem'
+
+    with open(f'{temp_dir}/early.txt', 'w') as f:
+        f.write('GET /replay HTTP/1.1\r\nHost: localhost\r\n\r\n')
+
+    subprocess.run(
+        [
+            'openssl',
+            's_client',
+            '-connect',
+            '127.0.0.1:7080',
+            '-tls1_3',
+            '-sess_out',
+            sess,
+        ],
+        input=b'GET / HTTP/1.1\r\nHost: localhost\r\n\r\n',
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL,
+        timeout=10,
+    )
+
+    # The client sends early data along with ClientHello, so the first
+    # flight is captured without a server and then sent to Unit twice.
+
+    server = socket.create_server(('127.0.0.1', 0))
+    port = server.getsockname()[1]
+
+    s_client = subprocess.Popen(
+        [
+            'openssl',
+            's_client',
+            '-connect',
+            f'127.0.0.1:{port}',
+            '-tls1_3',
+            '-sess_in',
+            sess,
+            '-early_data',
+            f'{temp_dir}/early.txt',
+        ],
+        stdin=subprocess.PIPE,
+        stdout=subprocess.DEVNULL,
+        stderr=subprocess.DEVNULL,
+    )
+
+    conn, _ = server.accept()
+    conn.settimeout(1)
+
+    flight = b''
+
+    try:
+        while True:
+            data = conn.recv(4096)
+
+            if not data:
+                break
+
+            flight += data
+
+    except socket.timeout:
+        pass
+
+    conn.close()
+    server.close()
+    s_client.kill()
+    s_client.wait()
+
+    assert len(flight) > 0, 'first flight'
+
+    def replay():
+        sock = socket.create_connection(('127.0.0.1', 7080))
+        sock.sendall(flight)
+        sock.settimeout(1)
+
+        try:
+            while sock.recv(4096):
+                pass
+
+        except socket.timeout:
+            pass
+
+        sock.close()
+
+    replay()
+
+    assert wait_for_record(r'"GET /replay', 'access.log'), 'early data'
+
+    replay()
+
+    assert len(findall(r'"GET /replay', 'access.log')) == 1, 'replay rejected'
+
+
+def test_tls_ocsp(temp_dir):
+    client.load('empty')
+
+    client.certificate('root', False)
+
+    req('localhost')
+
+    generate_ca_conf()
+
+    ca(cert='root', out='localhost')
+
+    with open(f'{temp_dir}/localhost-root.crt', 'wb') as crt, open(
+        f'{temp_dir}/localhost.crt', 'rb'
+    ) as end, open(f'{temp_dir}/root.crt', 'rb') as root:
+        crt.write(end.read() + root.read())
+
+    assert 'success' in client.certificate_load('localhost-root', 'localhost')
+
+    Path(f'{temp_dir}/ocsp').mkdir()
+
+    assert 'success' in client.conf(
+        {
+            "pass": "applications/empty",
+            "tls": {
+                "certificate": "localhost-root",
+                "ocsp": {"responses": f'{temp_dir}/ocsp', "refresh": 1},
+            },
+        },
+        'listeners/*:7080',
+    )
+
+    def s_client(port=7080):
+        return subprocess.run(
+            [
+                'openssl',
+                's_client',
+                '-connect',
+                f'127.0.0.1:{port}',
+                '-status',
+            ],
+            input=b'',
+            stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT,
+            timeout=10,
+        ).stdout.decode(errors='replace')
+
+    assert 'OCSP response: no response sent' in s_client(), 'no response'
+
+    def openssl(*args):
+        subprocess.check_output(
+            ['openssl', 'ocsp', *args], stderr=subprocess.STDOUT
+        )
+
+    openssl(
+        '-issuer',
+        f'{temp_dir}/root.crt',
+        '-cert',
+        f'{temp_dir}/localhost.crt',
+        '-reqout',
+        f'{temp_dir}/ocsp.req',
+    )
+    openssl(
+        '-index',
+        f'{temp_dir}/certindex',
+        '-rsigner',
+        f'{temp_dir}/root.crt',
+        '-rkey',
+        f'{temp_dir}/root.key',
+        '-CA',
+        f'{temp_dir}/root.crt',
+        '-ndays',
+        '1',
+        '-reqin',
+        f'{temp_dir}/ocsp.req',
+        '-respout',
+        f'{temp_dir}/ocsp/localhost-root',
+    )
+
+    # the response is read by the router, not by a handshake
+
+    time.sleep(1.1)
+
+    os.remove(f'{temp_dir}/ocsp/localhost-root')
+
+    out = s_client()
+    assert 'OCSP Response Status: successful' in out, 'response'
+    assert 'Cert Status: good' in out, 'response status'
+
+    # the response is shared by listeners with the same certificate
+
+    assert 'success' in client.conf(
+        {
+            "pass": "applications/empty",
+            "tls": {
+                "certificate": "localhost-root",
+                "ocsp": {"responses": f'{temp_dir}/ocsp', "refresh": 1},
+            },
+        },
+        'listeners/*:7081',
+    )
+
+    out = s_client(7081)
+    assert 'OCSP Response Status: successful' in out, 'response shared'
+
+    assert 'error' in client.conf(
+        {"refresh": 0}, 'listeners/*:7080/tls/ocsp'
+    ), 'refresh invalid'
@@ -1,3 +1,4 @@
+import socket
 import ssl
 import subprocess
 
@@ -237,6 +238,72 @@ def test_tls_sni_wildcard():
     check_cert('www.alt.example.ru', bundles['localhost.com']['subj'], ctx)
 
 
+def test_tls_sni_many():
+    bundles = {
+        f"host{i}.com": {
+            "subj": f"host{i}.com",
+            "alt_names": [f"*.host{i}.com"],
+        }
+        for i in range(8)
+    }
+    ctx = config_bundles(bundles)
+    add_tls(list(bundles))
+
+    for _ in range(2):
+        for b in bundles:
+            check_cert(f'www.{b}', bundles[b]['subj'], ctx)
+
+    add_tls(list(reversed(bundles)))
+
+    for b in bundles:
+        check_cert(f'www.{b}', bundles[b]['subj'], ctx)
+
+    check_cert('www.host.com', bundles['host7.com']['subj'], ctx)
+
+
+def test_tls_sni_session():
+    bundles = {
+        "default": {"subj": "default", "alt_names": ["default"]},
+        "localhost.com": {"subj": "localhost.com", "alt_names": []},
+    }
+    ctx = config_bundles(bundles)
+    ctx.maximum_version = ssl.TLSVersion.TLSv1_2
+
+    assert 'success' in client.conf(
+        {
+            "pass": "routes",
+            "tls": {
+                "certificate": ["default", "localhost.com"],
+                "session": {"cache_size": 10},
+            },
+        },
+        'listeners/*:7080',
+    )
+
+    def connect(session=None):
+        sock = ctx.wrap_socket(
+            socket.create_connection(('127.0.0.1', 7080)),
+            server_hostname='localhost.com',
+            session=session,
+        )
+
+        subject = sock.getpeercert()['subject'][0][0][1]
+        reused = sock.session_reused
+        session = sock.session
+
+        sock.close()
+
+        return subject, reused, session
+
+    subject, reused, session = connect()
+    assert subject == 'localhost.com', 'sni'
+    assert not reused, 'new session'
+
+    subject, reused, _ = connect(session)
+    assert subject == 'localhost.com', 'sni resumed'
+    assert reused, 'session reused'
+
+
 def test_tls_sni_duplicated_bundle():
     bundles = {
         "localhost.com": {
@@ -48,6 +48,7 @@ class ApplicationPython(ApplicationProto):
             'home',
             'limits',
             'path',
+            'preload',
             'protocol',
             'targets',
             'threads',
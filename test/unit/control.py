@@ -46,6 +46,10 @@ class Control(HTTP1):
     def conf_post(self, conf, url):
         return self.post(**self._get_args(url, conf))['body']
 
+    @args_handler
+    def conf_patch(self, conf, url):
+        return self.patch(**self._get_args(url, conf))['body']
+
     def _get_args(self, url, conf=None):
         args = {
             'url': url,
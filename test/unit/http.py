@@ -169,6 +169,9 @@ class HTTP1:
     def head(self, **kwargs):
         return self.http('HEAD', **kwargs)
 
+    def patch(self, **kwargs):
+        return self.http('PATCH', **kwargs)
+
     def post(self, **kwargs):
         return self.http('POST', **kwargs)
 